@@ -0,0 +1,160 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    audioevents.cpp
+        Detect errors and silence in the audio of a subchannel
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#include <cmath>
+#include <string>
+#include "audioevents.hpp"
+
+using namespace std;
+
+struct debounce_t {
+    // Duration of the condition before the event starts
+    size_t start_frames;
+    // Duration without the condition before the event ends
+    size_t end_frames;
+};
+
+// In 24ms ETI frames, indexed by audio_event_e
+static const debounce_t debounce[num_audio_events] = {
+    {0, 42},    // CRC
+    {0, 42},    // RS
+    {0, 42},    // DECODER
+    {84, 42},   // SILENCE
+};
+
+const char* audio_event_to_string(audio_event_e event)
+{
+    switch (event) {
+        case audio_event_e::CRC: return "crc";
+        case audio_event_e::RS: return "rs";
+        case audio_event_e::DECODER: return "decoder";
+        case audio_event_e::SILENCE: return "silence";
+    }
+    return "unknown";
+}
+
+bool audio_levels_silent(const audio_levels_t& levels)
+{
+    const double threshold = 32768.0 * pow(10.0, silence_threshold_dB / 20.0);
+    return levels.left.rms() < threshold and levels.right.rms() < threshold;
+}
+
+void AudioEventDetector::update(audio_event_e event, bool present)
+{
+    const size_t ix = (size_t)event;
+    state_t& s = m_state[ix];
+    audio_event_statistics_t& stats = m_stats[ix];
+
+    if (present) {
+        stats.occurrences++;
+
+        if (not s.run) {
+            s.run = true;
+            s.run_frame = m_frame;
+            s.run_tist = m_tist;
+            s.run_occurrences = 0;
+        }
+        s.run_occurrences++;
+        s.clear = false;
+
+        if (not s.active and m_frame - s.run_frame >= debounce[ix].start_frames) {
+            s.active = true;
+            stats.events++;
+            stats.active = true;
+            emit(event, false, s.run_frame, s.run_tist, s);
+        }
+    }
+    else if (s.active) {
+        if (not s.clear) {
+            s.clear = true;
+            s.clear_frame = m_frame;
+            s.clear_tist = m_tist;
+        }
+
+        if (m_frame - s.clear_frame >= debounce[ix].end_frames) {
+            stats.frames += s.clear_frame - s.run_frame;
+            stats.active = false;
+            emit(event, true, s.clear_frame, s.clear_tist, s);
+            s = state_t();
+        }
+    }
+    else {
+        // Too short to be an event
+        s.run = false;
+    }
+}
+
+audio_events_statistics_t AudioEventDetector::get_statistics() const
+{
+    audio_events_statistics_t stats = m_stats;
+    for (size_t ix = 0; ix < num_audio_events; ix++) {
+        if (m_state[ix].active) {
+            stats[ix].frames += m_frame - m_state[ix].run_frame;
+        }
+    }
+    return stats;
+}
+
+// Time stamp in ms, empty if the frame had none
+static string tist_to_string(uint32_t tist)
+{
+    char s[16] = "";
+    if (tist != tist_none) {
+        snprintf(s, sizeof(s), "%.3f", tist / 16384.0);
+    }
+    return s;
+}
+
+void AudioEventDetector::emit(audio_event_e event, bool end,
+        size_t frame, uint32_t tist, const state_t& s)
+{
+    const string tist_ms = tist_to_string(tist);
+    const double duration = 0.024 * (frame - s.run_frame);
+    const char *tist_print = tist_ms.empty() ? "none" : tist_ms.c_str();
+
+    if (end) {
+        printf("Subchannel %d: %s event end at frame %zu, TIST %s, "
+                "%.3f s, %zu occurrences\n",
+                subchid, audio_event_to_string(event), frame,
+                tist_print, duration, s.run_occurrences);
+    }
+    else {
+        printf("Subchannel %d: %s event start at frame %zu, TIST %s\n",
+                subchid, audio_event_to_string(event), frame, tist_print);
+    }
+
+    if (m_events_fd) {
+        // A single call, because the decoders of several threads share the file
+        if (end) {
+            fprintf(m_events_fd, "%d,%s,end,%zu,%s,%.3f,%zu\n",
+                    subchid, audio_event_to_string(event), frame,
+                    tist_ms.c_str(), duration, s.run_occurrences);
+        }
+        else {
+            fprintf(m_events_fd, "%d,%s,start,%zu,%s,,\n",
+                    subchid, audio_event_to_string(event), frame,
+                    tist_ms.c_str());
+        }
+    }
+}
+
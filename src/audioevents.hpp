@@ -0,0 +1,118 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    audioevents.hpp
+        Detect errors and silence in the audio of a subchannel
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <array>
+#include "audiolevels.hpp"
+
+enum class audio_event_e {
+    CRC,        // DAB+ AU CRC errors, or DAB audio frames with a wrong CRC
+    RS,         // DAB+ superframes with uncorrectable errors
+    DECODER,    // Errors from the AAC decoder
+    SILENCE,    // Level below silence_threshold_dB
+};
+
+const size_t num_audio_events = 4;
+
+const char* audio_event_to_string(audio_event_e event);
+
+// Level below which audio counts as silent, in dB relative to full scale
+const int silence_threshold_dB = -60;
+
+// True if all channels of the audio are below silence_threshold_dB
+bool audio_levels_silent(const audio_levels_t& levels);
+
+// Value of the TIST field of ETI frames that carry no timestamp
+const uint32_t tist_none = 0xFFFFFF;
+
+struct audio_event_statistics_t {
+    size_t events = 0;      // Including the one in progress
+    size_t frames = 0;      // Duration of the events, in 24ms ETI frames
+    bool active = false;    // An event is in progress
+
+    /* Superframes, or DAB audio frames, that had the error or were
+     * silent, also outside of events */
+    size_t occurrences = 0;
+};
+
+typedef std::array<audio_event_statistics_t, num_audio_events>
+    audio_events_statistics_t;
+
+/* AudioEventDetector is told for every superframe or audio frame which
+ * errors it had, and whether it was silent. It debounces them into events
+ * that start and end at ETI frames: an error event starts with the first
+ * error and ends after about 1s without errors, a silence event needs
+ * about 2s of silence and ends after about 1s of audio. Events are
+ * printed, and written as CSV lines to the events file if there is one.
+ */
+class AudioEventDetector {
+    public:
+        // Number and TIST of the ETI frame being decoded
+        void set_frame(size_t frame_number, uint32_t tist) {
+            m_frame = frame_number;
+            m_tist = tist & 0xFFFFFF;
+        }
+
+        // Write the events as CSV lines to fd, unless it is nullptr
+        void set_events_file(FILE *fd) { m_events_fd = fd; }
+
+        /* Report whether the superframe or audio frame that has just
+         * been decoded had the error, or was silent */
+        void update(audio_event_e event, bool present);
+
+        // The events in progress last until the current frame
+        audio_events_statistics_t get_statistics(void) const;
+
+        int subchid = -1;
+
+    private:
+        struct state_t {
+            // The condition is present since run_frame
+            bool run = false;
+            size_t run_frame = 0;
+            uint32_t run_tist = tist_none;
+            size_t run_occurrences = 0;
+
+            // The event is active, and absent since clear_frame
+            bool active = false;
+            bool clear = false;
+            size_t clear_frame = 0;
+            uint32_t clear_tist = tist_none;
+        };
+
+        // Print and write the start or the end of an event
+        void emit(audio_event_e event, bool end, size_t frame,
+                uint32_t tist, const state_t& s);
+
+        size_t m_frame = 0;
+        uint32_t m_tist = tist_none;
+        FILE *m_events_fd = nullptr;
+
+        std::array<state_t, num_audio_events> m_state;
+        audio_events_statistics_t m_stats;
+};
+
@@ -0,0 +1,278 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    audiolevels.cpp
+        Accumulate level statistics of decoded audio
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include "audiolevels.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define AUDIOLEVELS_X86_SIMD 1
+#  include <immintrin.h>
+#else
+#  define AUDIOLEVELS_X86_SIMD 0
+#endif
+
+using namespace std;
+
+void channel_levels_t::add(const channel_levels_t& other)
+{
+    num_samples += other.num_samples;
+    sum_abs += other.sum_abs;
+    sum_squares += other.sum_squares;
+    peak = max(peak, other.peak);
+    num_clipped += other.num_clipped;
+}
+
+double channel_levels_t::mean_abs() const
+{
+    return num_samples ? (double)sum_abs / num_samples : 0;
+}
+
+double channel_levels_t::rms() const
+{
+    return num_samples ? sqrt((double)sum_squares / num_samples) : 0;
+}
+
+/* The kernels add the samples at even indices to even, and those at odd
+ * indices to odd, which are the left and right channels of stereo audio.
+ * They do not update num_samples. */
+typedef void (*levels_kernel_t)(channel_levels_t& even, channel_levels_t& odd,
+        const int16_t *samples, size_t num_samples);
+
+static void accumulate_scalar(channel_levels_t& even, channel_levels_t& odd,
+        const int16_t *samples, size_t num_samples)
+{
+    channel_levels_t *channels[2] = {&even, &odd};
+
+    for (size_t i = 0; i < num_samples; i++) {
+        channel_levels_t& ch = *channels[i % 2];
+        const int16_t s = samples[i];
+        const int16_t abs_s = (s == INT16_MIN) ? INT16_MAX : abs(s);
+
+        ch.sum_abs += abs_s;
+        ch.sum_squares += (int32_t)s * s;
+        ch.peak = max(ch.peak, abs_s);
+        if (s == INT16_MAX or s == INT16_MIN) {
+            ch.num_clipped++;
+        }
+    }
+}
+
+#if AUDIOLEVELS_X86_SIMD
+/* The vector kernels keep the sums of absolute values and the clip counts
+ * in 32-bit lanes, and move them to the 64-bit totals after at most
+ * block_iterations vectors, before they could overflow. The squares can
+ * reach 2^30 and go to 64-bit lanes immediately. */
+static const size_t block_iterations = 16384;
+
+__attribute__((target("sse2")))
+static void accumulate_sse2(channel_levels_t& even, channel_levels_t& odd,
+        const int16_t *samples, size_t num_samples)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones_even = _mm_set_epi16(0, 1, 0, 1, 0, 1, 0, 1);
+    const __m128i ones_odd = _mm_set_epi16(1, 0, 1, 0, 1, 0, 1, 0);
+    const __m128i mask_even = _mm_set_epi16(0, -1, 0, -1, 0, -1, 0, -1);
+    const __m128i full_pos = _mm_set1_epi16(INT16_MAX);
+    const __m128i full_neg = _mm_set1_epi16(INT16_MIN);
+
+    __m128i peak = zero;
+    __m128i sq_even = zero;
+    __m128i sq_odd = zero;
+
+    size_t i = 0;
+    while (num_samples - i >= 8) {
+        __m128i abs_even = zero;
+        __m128i abs_odd = zero;
+        __m128i clip_even = zero;
+        __m128i clip_odd = zero;
+
+        const size_t block_end = i + 8 * min(
+                (num_samples - i) / 8, block_iterations);
+
+        for (; i < block_end; i += 8) {
+            const __m128i x = _mm_loadu_si128((const __m128i*)(samples + i));
+
+            // max(x, -x), where -(-32768) saturates to 32767
+            const __m128i a = _mm_max_epi16(x, _mm_subs_epi16(zero, x));
+            peak = _mm_max_epi16(peak, a);
+
+            abs_even = _mm_add_epi32(abs_even, _mm_madd_epi16(a, ones_even));
+            abs_odd = _mm_add_epi32(abs_odd, _mm_madd_epi16(a, ones_odd));
+
+            const __m128i sqe = _mm_madd_epi16(x, _mm_and_si128(x, mask_even));
+            const __m128i sqo = _mm_madd_epi16(x, _mm_andnot_si128(mask_even, x));
+            sq_even = _mm_add_epi64(sq_even, _mm_add_epi64(
+                        _mm_unpacklo_epi32(sqe, zero),
+                        _mm_unpackhi_epi32(sqe, zero)));
+            sq_odd = _mm_add_epi64(sq_odd, _mm_add_epi64(
+                        _mm_unpacklo_epi32(sqo, zero),
+                        _mm_unpackhi_epi32(sqo, zero)));
+
+            // Lanes at full scale are -1
+            const __m128i clip = _mm_or_si128(
+                    _mm_cmpeq_epi16(x, full_pos),
+                    _mm_cmpeq_epi16(x, full_neg));
+            clip_even = _mm_sub_epi32(clip_even, _mm_madd_epi16(clip, ones_even));
+            clip_odd = _mm_sub_epi32(clip_odd, _mm_madd_epi16(clip, ones_odd));
+        }
+
+        uint32_t lanes[4];
+        _mm_storeu_si128((__m128i*)lanes, abs_even);
+        even.sum_abs += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        _mm_storeu_si128((__m128i*)lanes, abs_odd);
+        odd.sum_abs += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        _mm_storeu_si128((__m128i*)lanes, clip_even);
+        even.num_clipped += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        _mm_storeu_si128((__m128i*)lanes, clip_odd);
+        odd.num_clipped += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+
+    uint64_t sq[2];
+    _mm_storeu_si128((__m128i*)sq, sq_even);
+    even.sum_squares += sq[0] + sq[1];
+    _mm_storeu_si128((__m128i*)sq, sq_odd);
+    odd.sum_squares += sq[0] + sq[1];
+
+    int16_t peaks[8];
+    _mm_storeu_si128((__m128i*)peaks, peak);
+    for (int lane = 0; lane < 8; lane += 2) {
+        even.peak = max(even.peak, peaks[lane]);
+        odd.peak = max(odd.peak, peaks[lane + 1]);
+    }
+
+    // i is even, the parity of the remaining samples is unchanged
+    accumulate_scalar(even, odd, samples + i, num_samples - i);
+}
+
+__attribute__((target("avx2")))
+static void accumulate_avx2(channel_levels_t& even, channel_levels_t& odd,
+        const int16_t *samples, size_t num_samples)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones_even = _mm256_set1_epi32(0x00000001);
+    const __m256i ones_odd = _mm256_set1_epi32(0x00010000);
+    const __m256i mask_even = _mm256_set1_epi32(0x0000FFFF);
+    const __m256i full_pos = _mm256_set1_epi16(INT16_MAX);
+    const __m256i full_neg = _mm256_set1_epi16(INT16_MIN);
+
+    __m256i peak = zero;
+    __m256i sq_even = zero;
+    __m256i sq_odd = zero;
+
+    size_t i = 0;
+    while (num_samples - i >= 16) {
+        __m256i abs_even = zero;
+        __m256i abs_odd = zero;
+        __m256i clip_even = zero;
+        __m256i clip_odd = zero;
+
+        const size_t block_end = i + 16 * min(
+                (num_samples - i) / 16, block_iterations);
+
+        for (; i < block_end; i += 16) {
+            const __m256i x = _mm256_loadu_si256((const __m256i*)(samples + i));
+
+            const __m256i a = _mm256_max_epi16(x, _mm256_subs_epi16(zero, x));
+            peak = _mm256_max_epi16(peak, a);
+
+            abs_even = _mm256_add_epi32(abs_even, _mm256_madd_epi16(a, ones_even));
+            abs_odd = _mm256_add_epi32(abs_odd, _mm256_madd_epi16(a, ones_odd));
+
+            const __m256i sqe = _mm256_madd_epi16(x, _mm256_and_si256(x, mask_even));
+            const __m256i sqo = _mm256_madd_epi16(x, _mm256_andnot_si256(mask_even, x));
+            sq_even = _mm256_add_epi64(sq_even, _mm256_add_epi64(
+                        _mm256_unpacklo_epi32(sqe, zero),
+                        _mm256_unpackhi_epi32(sqe, zero)));
+            sq_odd = _mm256_add_epi64(sq_odd, _mm256_add_epi64(
+                        _mm256_unpacklo_epi32(sqo, zero),
+                        _mm256_unpackhi_epi32(sqo, zero)));
+
+            const __m256i clip = _mm256_or_si256(
+                    _mm256_cmpeq_epi16(x, full_pos),
+                    _mm256_cmpeq_epi16(x, full_neg));
+            clip_even = _mm256_sub_epi32(clip_even, _mm256_madd_epi16(clip, ones_even));
+            clip_odd = _mm256_sub_epi32(clip_odd, _mm256_madd_epi16(clip, ones_odd));
+        }
+
+        uint32_t lanes[8];
+        _mm256_storeu_si256((__m256i*)lanes, abs_even);
+        for (int l = 0; l < 8; l++) even.sum_abs += lanes[l];
+        _mm256_storeu_si256((__m256i*)lanes, abs_odd);
+        for (int l = 0; l < 8; l++) odd.sum_abs += lanes[l];
+        _mm256_storeu_si256((__m256i*)lanes, clip_even);
+        for (int l = 0; l < 8; l++) even.num_clipped += lanes[l];
+        _mm256_storeu_si256((__m256i*)lanes, clip_odd);
+        for (int l = 0; l < 8; l++) odd.num_clipped += lanes[l];
+    }
+
+    uint64_t sq[4];
+    _mm256_storeu_si256((__m256i*)sq, sq_even);
+    even.sum_squares += sq[0] + sq[1] + sq[2] + sq[3];
+    _mm256_storeu_si256((__m256i*)sq, sq_odd);
+    odd.sum_squares += sq[0] + sq[1] + sq[2] + sq[3];
+
+    int16_t peaks[16];
+    _mm256_storeu_si256((__m256i*)peaks, peak);
+    for (int lane = 0; lane < 16; lane += 2) {
+        even.peak = max(even.peak, peaks[lane]);
+        odd.peak = max(odd.peak, peaks[lane + 1]);
+    }
+
+    accumulate_scalar(even, odd, samples + i, num_samples - i);
+}
+#endif
+
+static levels_kernel_t select_levels_kernel()
+{
+#if AUDIOLEVELS_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return accumulate_avx2;
+    }
+    else if (__builtin_cpu_supports("sse2")) {
+        return accumulate_sse2;
+    }
+#endif
+    return accumulate_scalar;
+}
+
+static const levels_kernel_t levels_kernel = select_levels_kernel();
+
+void audio_levels_accumulate(audio_levels_t& levels,
+        const int16_t *samples, size_t num_samples, int channels)
+{
+    if (channels == 2) {
+        levels_kernel(levels.left, levels.right, samples, num_samples);
+        levels.left.num_samples += (num_samples + 1) / 2;
+        levels.right.num_samples += num_samples / 2;
+    }
+    else if (channels == 1) {
+        channel_levels_t odd;
+        levels_kernel(levels.left, odd, samples, num_samples);
+        levels.left.add(odd);
+        levels.left.num_samples += num_samples;
+    }
+}
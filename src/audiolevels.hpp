@@ -0,0 +1,65 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    audiolevels.hpp
+        Accumulate level statistics of decoded audio
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Level statistics of one audio channel, accumulated over some time.
+ * Absolute sample values saturate at 32767, so that -32768 counts as a
+ * full-scale sample like 32767. */
+struct channel_levels_t {
+    uint64_t num_samples = 0;
+    uint64_t sum_abs = 0;
+    uint64_t sum_squares = 0;
+    int16_t peak = 0;
+
+    // Samples at full scale, either positive or negative
+    uint64_t num_clipped = 0;
+
+    void add(const channel_levels_t& other);
+
+    // Mean absolute sample value, 0 without samples
+    double mean_abs(void) const;
+
+    // Root mean square sample value, 0 without samples
+    double rms(void) const;
+};
+
+struct audio_levels_t {
+    channel_levels_t left;
+    channel_levels_t right; // unused for mono audio
+
+    void add(const audio_levels_t& other) {
+        left.add(other.left);
+        right.add(other.right);
+    }
+};
+
+/* Add num_samples samples of interleaved audio with the given number of
+ * channels (1 or 2) to levels. Uses SSE2 or AVX2 when the CPU supports
+ * them. */
+void audio_levels_accumulate(audio_levels_t& levels,
+        const int16_t *samples, size_t num_samples, int channels);
+
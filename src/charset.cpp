@@ -25,6 +25,8 @@
 
 #include "charset.hpp"
 #include <algorithm>
+#include <array>
+#include <cstring>
 
 /**********************************************/
 /************* BIG FAT WARNING ****************/
@@ -59,20 +61,111 @@ static const char* utf8_encoded_EBU_Latin[CHARSET_TABLE_ENTRIES] = {
 
 using namespace std;
 
+struct utf8_char_t {
+    char bytes[4];
+    uint8_t len;
+};
+
+// Precomputed UTF-8 encoding for each of the 256 EBU Latin code points,
+// NUL being replaced by ⁇
+static const array<utf8_char_t, 256> ebu_to_utf8_table = []() {
+    array<utf8_char_t, 256> table;
+    for (size_t c = 0; c < table.size(); c++) {
+        const char *utf8_char = (c >= CHARSET_TABLE_OFFSET) ?
+            utf8_encoded_EBU_Latin[c - CHARSET_TABLE_OFFSET] : "⁇";
+        table[c].len = strlen(utf8_char);
+        memcpy(table[c].bytes, utf8_char, table[c].len);
+    }
+    return table;
+}();
+
+void convert_ebu_to_utf8(const uint8_t *ebu, size_t len, std::string& utf8)
+{
+    // Size the output first, so that we write it in one go
+    size_t utf8_len = 0;
+    for (size_t i = 0; i < len; i++) {
+        utf8_len += ebu_to_utf8_table[ebu[i]].len;
+    }
+
+    utf8.resize(utf8_len);
+    char *out = &utf8[0];
+
+    if (utf8_len == len) {
+        // Only single-byte characters
+        for (size_t i = 0; i < len; i++) {
+            out[i] = ebu_to_utf8_table[ebu[i]].bytes[0];
+        }
+    }
+    else {
+        for (size_t i = 0; i < len; i++) {
+            const auto& c = ebu_to_utf8_table[ebu[i]];
+            memcpy(out, c.bytes, c.len);
+            out += c.len;
+        }
+    }
+}
+
 std::string convert_ebu_to_utf8(const std::string& str)
 {
     string utf8_str;
-    for (const uint8_t c : str) {
-        // Table offset because NUL is not represented
-        if (c >= CHARSET_TABLE_OFFSET) {
-            string utf8_char(utf8_encoded_EBU_Latin[c - CHARSET_TABLE_OFFSET]);
-            utf8_str += utf8_char;
+    convert_ebu_to_utf8(reinterpret_cast<const uint8_t*>(str.data()),
+            str.size(), utf8_str);
+    return utf8_str;
+}
+
+static inline size_t ucs2_utf8_len(uint16_t c)
+{
+    return (c < 0x80) ? 1 : (c < 0x800) ? 2 : 3;
+}
+
+static inline bool is_surrogate(uint16_t c)
+{
+    return c >= 0xD800 and c <= 0xDFFF;
+}
+
+bool convert_ucs2_to_utf8(const uint8_t *ucs2, size_t len_bytes, std::string& utf8)
+{
+    const size_t num_chars = len_bytes / 2;
+
+    // Surrogates cannot appear in UCS-2, they get replaced by ⁇ which
+    // also takes three bytes
+    bool valid = true;
+    size_t utf8_len = 0;
+    for (size_t i = 0; i < num_chars; i++) {
+        const uint16_t c = ucs2[2*i] << 8 | ucs2[2*i+1];
+        valid &= not is_surrogate(c);
+        utf8_len += ucs2_utf8_len(c);
+    }
+
+    utf8.resize(utf8_len);
+    char *out = &utf8[0];
+
+    if (utf8_len == num_chars) {
+        // Only ASCII characters
+        for (size_t i = 0; i < num_chars; i++) {
+            out[i] = ucs2[2*i+1];
+        }
+        return true;
+    }
+
+    for (size_t i = 0; i < num_chars; i++) {
+        uint16_t c = ucs2[2*i] << 8 | ucs2[2*i+1];
+        if (c < 0x80) {
+            *out++ = c;
+        }
+        else if (c < 0x800) {
+            *out++ = 0xC0 | (c >> 6);
+            *out++ = 0x80 | (c & 0x3F);
         }
         else {
-            utf8_str += "⁇";
+            if (is_surrogate(c)) {
+                c = 0x2047;
+            }
+            *out++ = 0xE0 | (c >> 12);
+            *out++ = 0x80 | ((c >> 6) & 0x3F);
+            *out++ = 0x80 | (c & 0x3F);
         }
     }
 
-    return utf8_str;
+    return valid;
 }
-
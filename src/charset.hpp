@@ -33,3 +33,15 @@
  *  Invalid input characters are converted to ⁇ (unicode U+2047).
  */
 std::string convert_ebu_to_utf8(const std::string& str);
+
+/*! Convert len EBU Latin bytes into the utf8 string, replacing
+ *  its contents. Same conversion as above, without temporaries.
+ */
+void convert_ebu_to_utf8(const uint8_t *ebu, size_t len, std::string& utf8);
+
+/*! Convert a big-endian UCS-2 byte stream to UTF-8, replacing the contents
+ *  of utf8. A trailing odd byte is ignored. Surrogate code units are
+ *  invalid in UCS-2 and are converted to ⁇ (unicode U+2047).
+ *  Returns false if the input contained invalid characters.
+ */
+bool convert_ucs2_to_utf8(const uint8_t *ucs2, size_t len_bytes, std::string& utf8);
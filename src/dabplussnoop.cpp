@@ -30,6 +30,7 @@
 #include <cassert>
 #include <sstream>
 #include <algorithm>
+#include <array>
 #include <vector>
 #include <stdexcept>
 #include "dabplussnoop.hpp"
@@ -47,20 +48,176 @@ extern "C" {
 #  define DPS_DEBUG 0
 #endif
 
+// Number of consecutive misplaced superframes tolerated while locked
+#define DPS_MAX_LOCK_MISSES 3
+
 using namespace std;
 
+// A superframe spans five 24ms logical frames
+static const size_t frames_per_superframe = 5;
+
+void SuperframeBuffer::set_superframe_len(size_t superframe_len)
+{
+    m_superframe_len = superframe_len;
+    m_capacity = 2 * superframe_len;
+    m_buf.resize(m_capacity + superframe_len);
+    m_start = 0;
+    m_fill = 0;
+}
+
+size_t SuperframeBuffer::push(const uint8_t *data, size_t len)
+{
+    len = std::min(len, m_capacity - m_fill);
+
+    size_t pos = (m_start + m_fill) % m_capacity;
+    size_t done = 0;
+    while (done < len) {
+        const size_t n = std::min(len - done, m_capacity - pos);
+        memcpy(&m_buf[pos], data + done, n);
+
+        if (pos < m_superframe_len) {
+            const size_t n_mirror = std::min(n, m_superframe_len - pos);
+            memcpy(&m_buf[m_capacity + pos], data + done, n_mirror);
+        }
+
+        done += n;
+        pos = (pos + n) % m_capacity;
+    }
+
+    m_fill += len;
+    return len;
+}
+
+uint8_t* SuperframeBuffer::at(size_t offset)
+{
+    assert(offset < m_fill);
+    return &m_buf[(m_start + offset) % m_capacity];
+}
+
+void SuperframeBuffer::consume(size_t len)
+{
+    assert(len <= m_fill);
+    m_start = (m_start + len) % m_capacity;
+    m_fill -= len;
+}
+
 void DabPlusSnoop::push(uint8_t* streamdata, size_t streamsize)
 {
-    // Try to decode audio
-    size_t original_size = m_data.size();
-    m_data.resize(original_size + streamsize);
-    memcpy(&m_data[original_size], streamdata, streamsize);
+    if (m_subchannel_index == 0) {
+        // Superframe size unknown
+        return;
+    }
 
     const size_t sf_len = m_subchannel_index * 120;
-    while (seek_valid_firecode() and decode()) {
-        // We have been able to decode the AUs, now flush vector
-        m_data.erase(m_data.begin(), m_data.begin() + sf_len);;
+
+    /* Whenever the decode loop stops, less than one superframe remains
+     * in the buffer, which has space for two. A push larger than one
+     * superframe gets handled in several steps. */
+    while (streamsize > 0) {
+        const size_t pushed = m_superframe_buffer.push(streamdata, streamsize);
+        streamdata += pushed;
+        streamsize -= pushed;
+        m_bytes_received += pushed;
+
+        if (not m_locked) {
+            m_bytes_unlocked += pushed;
+        }
+
+        // Try to decode audio
+        while (m_locked or seek_valid_firecode()) {
+            if (m_superframe_buffer.size() < sf_len) {
+                break;
+            }
+
+            const auto status = decode();
+
+            if (not m_locked) {
+                if (status == superframe_status_e::FIRECODE_ERROR or
+                        status == superframe_status_e::RS_ERROR) {
+                    // Not a superframe after all, keep searching
+                    m_superframe_buffer.consume(1);
+                    continue;
+                }
+
+                lock();
+            }
+
+            if (status == superframe_status_e::FIRECODE_ERROR) {
+                /* A firecode elsewhere in the data means that the
+                 * superframes have moved, e.g. because data got lost. A
+                 * corrupt header alone is tolerated a few times. */
+                size_t other_firecode = 0;
+                const bool moved = find_valid_firecode(1, other_firecode);
+
+                if (moved or ++m_lock_misses > DPS_MAX_LOCK_MISSES) {
+                    printf(DPS_PREFIX " subchannel %d lost superframe sync\n",
+                            subchid);
+                    m_sync_stats.num_unlocks++;
+                    m_locked = false;
+                    m_bytes_unlocked = m_superframe_buffer.size();
+
+                    // Search again, starting with the data we just rejected
+                    continue;
+                }
+            }
+            else {
+                m_lock_misses = 0;
+            }
+
+            if (status == superframe_status_e::DECODED) {
+                m_sync_stats.superframes_decoded++;
+                m_utilisation.add(
+                        superframe_utilisation(m_superframe.data()),
+                        frames_per_superframe);
+            }
+            else {
+                m_sync_stats.superframes_skipped++;
+                utilisation_t skipped;
+                skipped.unknown = sf_len;
+                m_utilisation.add(skipped, frames_per_superframe);
+            }
+
+            // Each check only tells about the superframes it was done on
+            if (status == superframe_status_e::RS_ERROR) {
+                m_sync_stats.rs_uncorrectable++;
+                events.update(audio_event_e::RS, true);
+            }
+            else if (status != superframe_status_e::FIRECODE_ERROR) {
+                m_sync_stats.rs_corrected_bytes += m_rs_corrected;
+                m_sync_stats.aus += m_aus_checked;
+                m_sync_stats.au_crc_errors += m_au_crc_errors;
+                events.update(audio_event_e::RS, false);
+                events.update(audio_event_e::CRC,
+                        status == superframe_status_e::AU_CRC_ERROR);
+            }
+
+            // Drop the superframe, the next one follows immediately
+            m_superframe_buffer.consume(sf_len);
+        }
+    }
+}
+
+void DabPlusSnoop::lock()
+{
+    const size_t sf_len = m_subchannel_index * 120;
+
+    // Count until the end of the superframe we locked on
+    const size_t bytes_to_lock =
+        m_bytes_unlocked - m_superframe_buffer.size() + sf_len;
+
+    // A superframe lasts 120ms
+    const double time_to_lock_ms = 120.0 * bytes_to_lock / sf_len;
+
+    printf(DPS_PREFIX " subchannel %d superframe sync locked after %.0f ms\n",
+            subchid, time_to_lock_ms);
+
+    if (m_sync_stats.num_locks == 0) {
+        m_sync_stats.time_to_first_lock_ms = time_to_lock_ms;
     }
+    m_sync_stats.num_locks++;
+
+    m_locked = true;
+    m_lock_misses = 0;
 }
 
 audio_statistics_t DabPlusSnoop::get_audio_statistics(void) const
@@ -69,18 +226,13 @@ audio_statistics_t DabPlusSnoop::get_audio_statistics(void) const
 }
 
 // Idea and some code taken from Xpadxpert
-bool DabPlusSnoop::seek_valid_firecode()
+bool DabPlusSnoop::find_valid_firecode(size_t start, size_t& position)
 {
-    if (m_data.size() < 10) {
-        // Not enough data
-        return false;
-    }
+    const size_t data_size = m_superframe_buffer.size();
 
-    bool crc_ok = false;
     size_t i;
-
-    for (i = 0; i < m_data.size() - 10; i++) {
-        uint8_t* b = &m_data[i];
+    for (i = start; i + 10 < data_size; i++) {
+        uint8_t* b = m_superframe_buffer.at(i);
 
         // the three bytes after the firecode must not be zero
         // (simple plausibility check to avoid sync in zero byte region)
@@ -89,243 +241,353 @@ bool DabPlusSnoop::seek_valid_firecode()
             uint16_t calculated_firecode = firecode_crc(b+2, 9);
 
             if (header_firecode == calculated_firecode) {
-                crc_ok = true;
-                break;
+                position = i;
+                return true;
             }
         }
     }
 
+    position = i;
+    return false;
+}
+
+bool DabPlusSnoop::seek_valid_firecode()
+{
+    if (m_superframe_buffer.size() < 10) {
+        // Not enough data
+        return false;
+    }
+
+    size_t i = 0;
+    const bool crc_ok = find_valid_firecode(0, i);
+
+    // erase elements before the header, or all those we checked
+    m_superframe_buffer.consume(i);
+
     if (crc_ok) {
 #if DPS_DEBUG
         printf(DPS_PREFIX " Found valid FireCode at %zu\n", i);
 #endif
-        //erase elements before the header
-        m_data.erase(m_data.begin(), m_data.begin() + i);
         return true;
     }
     else {
 #if DPS_DEBUG
         printf(DPS_PREFIX " No valid FireCode found\n");
 #endif
-
-        m_data.clear();
         return false;
     }
 }
 
-bool DabPlusSnoop::decode()
+DabPlusSnoop::superframe_status_e DabPlusSnoop::decode()
 {
 #if DPS_DEBUG
-    printf(DPS_PREFIX " We have %zu bytes of data\n", m_data.size());
+    printf(DPS_PREFIX " We have %zu bytes of data\n", m_superframe_buffer.size());
 #endif
 
     const size_t sf_len = m_subchannel_index * 120;
-    if (m_subchannel_index && m_data.size() >= sf_len) {
-        std::vector<uint8_t> b(sf_len);
-        std::copy(m_data.begin(), m_data.begin() + sf_len, b.begin());
+    if (m_subchannel_index == 0 or m_superframe_buffer.size() < sf_len) {
+        throw logic_error("DabPlusSnoop: decode called without superframe");
+    }
 
-        RSDecoder rs_dec;
-        int rs_errors = rs_dec.DecodeSuperframe(b, m_subchannel_index);
+    // Correct a copy, the superframe might not be one after all
+    memcpy(m_superframe.data(), m_superframe_buffer.at(0), sf_len);
+    uint8_t *b = m_superframe.data();
 
-        if (rs_errors == -1) {
-            // Uncorrectable errors, flush our buffer
-            m_data.clear();
-            return false;
-        }
-        else if (rs_errors > 0) {
-            printf("RS Decoder for subchannel %d: %d corrected errors\n",
-                    subchid, rs_errors);
-        }
+    m_rs_corrected = 0;
+    m_aus_checked = 0;
+    m_au_crc_errors = 0;
 
-        // -- Parse he_aac_super_frame
-        // ---- Parse he_aac_super_frame_header
-        // ------ Parse firecode and audio params
-        uint16_t header_firecode = (b[0] << 8) | b[1];
-        uint8_t  audio_params    = b[2];
-        int rfa                  = (audio_params & 0x80) ? true : false;
-        m_dac_rate               = (audio_params & 0x40) ? true : false;
-        m_sbr_flag               = (audio_params & 0x20) ? true : false;
-        m_aac_channel_mode       = (audio_params & 0x10) ? true : false;
-        m_ps_flag                = (audio_params & 0x08) ? true : false;
-        m_mpeg_surround_config   = (audio_params & 0x07);
-
-        int num_aus = 0;
-        if (!m_dac_rate && m_sbr_flag) num_aus = 2;
-        // AAC core sampling rate 16 kHz
-        else if (m_dac_rate && m_sbr_flag) num_aus = 3;
-        //  AAC core sampling rate 24 kHz
-        else if (!m_dac_rate && !m_sbr_flag) num_aus = 4;
-        // AAC core sampling rate 32 kHz
-        else if (m_dac_rate && !m_sbr_flag) num_aus = 6;
-        // AAC core sampling rate 48 kHz
+    int rs_errors = m_rs_decoder.DecodeSuperframe(b, m_subchannel_index);
 
-#if DPS_DEBUG
-        printf( DPS_INDENT DPS_PREFIX "\n"
-                DPS_INDENT "\tfirecode           0x%x\n"
-                DPS_INDENT "\trfa                  %d\n"
-                DPS_INDENT "\tdac_rate             %d\n"
-                DPS_INDENT "\tsbr_flag             %d\n"
-                DPS_INDENT "\taac_channel_mode     %d\n"
-                DPS_INDENT "\tps_flag              %d\n"
-                DPS_INDENT "\tmpeg_surround_config %d\n"
-                DPS_INDENT "\tnum_aus              %d\n",
-                header_firecode, rfa, m_dac_rate, m_sbr_flag,
-                m_aac_channel_mode, m_ps_flag, m_mpeg_surround_config,
-                num_aus);
-#else
-        // Avoid "unused variable" warning
-        (void)header_firecode;
-        (void)rfa;
-#endif
+    uint16_t header_firecode = (b[0] << 8) | b[1];
+    if (header_firecode != firecode_crc(b+2, 9)) {
+        return superframe_status_e::FIRECODE_ERROR;
+    }
 
+    if (rs_errors == -1) {
+        // Uncorrectable errors, skip this superframe
+        return superframe_status_e::RS_ERROR;
+    }
+    else if (rs_errors > 0) {
+        printf("RS Decoder for subchannel %d: %d corrected errors\n",
+                subchid, rs_errors);
+        m_rs_corrected = rs_errors;
+    }
 
-        // ------ Parse au_start
-        auto au_starts = b.begin() + 3;
+    // -- Parse he_aac_super_frame
+    // ---- Parse he_aac_super_frame_header
+    // ------ Parse audio params
+    uint8_t  audio_params    = b[2];
+    int rfa                  = (audio_params & 0x80) ? true : false;
+    m_dac_rate               = (audio_params & 0x40) ? true : false;
+    m_sbr_flag               = (audio_params & 0x20) ? true : false;
+    m_aac_channel_mode       = (audio_params & 0x10) ? true : false;
+    m_ps_flag                = (audio_params & 0x08) ? true : false;
+    m_mpeg_surround_config   = (audio_params & 0x07);
+
+    int num_aus = 0;
+    if (!m_dac_rate && m_sbr_flag) num_aus = 2;
+    // AAC core sampling rate 16 kHz
+    else if (m_dac_rate && m_sbr_flag) num_aus = 3;
+    //  AAC core sampling rate 24 kHz
+    else if (!m_dac_rate && !m_sbr_flag) num_aus = 4;
+    // AAC core sampling rate 32 kHz
+    else if (m_dac_rate && !m_sbr_flag) num_aus = 6;
+    // AAC core sampling rate 48 kHz
 
-        vector<uint8_t> au_start_nibbles(0);
+#if DPS_DEBUG
+    printf( DPS_INDENT DPS_PREFIX "\n"
+            DPS_INDENT "\tfirecode           0x%x\n"
+            DPS_INDENT "\trfa                  %d\n"
+            DPS_INDENT "\tdac_rate             %d\n"
+            DPS_INDENT "\tsbr_flag             %d\n"
+            DPS_INDENT "\taac_channel_mode     %d\n"
+            DPS_INDENT "\tps_flag              %d\n"
+            DPS_INDENT "\tmpeg_surround_config %d\n"
+            DPS_INDENT "\tnum_aus              %d\n",
+            header_firecode, rfa, m_dac_rate, m_sbr_flag,
+            m_aac_channel_mode, m_ps_flag, m_mpeg_surround_config,
+            num_aus);
+#else
+    // Avoid "unused variable" warning
+    (void)rfa;
+#endif
 
-        /* Each AU_START is encoded in three nibbles.
-         * When we have n AUs, we have n-1 au_start values. */
-        for (int i = 0; i < (num_aus-1)*3; i++) {
-            if (i % 2 == 0) {
-                char nibble = au_starts[i/2] >> 4;
 
-                au_start_nibbles.push_back( nibble );
-            }
-            else {
-                char nibble = au_starts[i/2] & 0x0F;
+    // ------ Parse au_start
+    const uint8_t *au_starts = b + 3;
 
-                au_start_nibbles.push_back( nibble );
-            }
+    // At most 6 AUs, 5 au_start values
+    uint8_t au_start_nibbles[15];
 
+    /* Each AU_START is encoded in three nibbles.
+     * When we have n AUs, we have n-1 au_start values. */
+    for (int i = 0; i < (num_aus-1)*3; i++) {
+        if (i % 2 == 0) {
+            au_start_nibbles[i] = au_starts[i/2] >> 4;
         }
+        else {
+            au_start_nibbles[i] = au_starts[i/2] & 0x0F;
+        }
+    }
 
 
-        vector<int> au_start(num_aus);
+    // One more entry for the end of the last AU
+    std::array<int, 7> au_start;
 
-        if (num_aus == 2)
-            au_start[0] = 5;
-        else if (num_aus == 3)
-            au_start[0] = 6;
-        else if (num_aus == 4)
-            au_start[0] = 8;
-        else if (num_aus == 6)
-            au_start[0] = 11;
+    if (num_aus == 2)
+        au_start[0] = 5;
+    else if (num_aus == 3)
+        au_start[0] = 6;
+    else if (num_aus == 4)
+        au_start[0] = 8;
+    else if (num_aus == 6)
+        au_start[0] = 11;
 
 
-        int nib = 0;
-        for (int au = 1; au < num_aus; au++) {
-            au_start[au] = au_start_nibbles[nib]   << 8 | \
-                           au_start_nibbles[nib+1] << 4 | \
-                           au_start_nibbles[nib+2];
+    int nib = 0;
+    for (int au = 1; au < num_aus; au++) {
+        au_start[au] = au_start_nibbles[nib]   << 8 | \
+                       au_start_nibbles[nib+1] << 4 | \
+                       au_start_nibbles[nib+2];
 
-            nib += 3;
-        }
+        nib += 3;
+    }
 
 #if DPS_DEBUG
-        printf(DPS_INDENT DPS_PREFIX " AU start\n");
-        for (int au = 0; au < num_aus; au++) {
-            printf(DPS_INDENT "\tAU[%d] %d 0x%x\n", au,
-                    au_start[au],
-                    au_start[au]);
-        }
+    printf(DPS_INDENT DPS_PREFIX " AU start\n");
+    for (int au = 0; au < num_aus; au++) {
+        printf(DPS_INDENT "\tAU[%d] %d 0x%x\n", au,
+                au_start[au],
+                au_start[au]);
+    }
 #endif
 
-        return extract_au(au_start);
+    if (extract_au(b, au_start, num_aus)) {
+        if (m_integrity_only) {
+            return superframe_status_e::DECODED;
+        }
+
+        analyse_pad(b);
+
+        // Errors from the AAC decoder do not affect the superframe sync
+        const bool decoded = analyse_au(b);
+        events.update(audio_event_e::DECODER, not decoded);
+
+        const auto& levels = m_faad_decoder.get_decoded_levels();
+        if (decoded and levels.left.num_samples > 0) {
+            events.update(audio_event_e::SILENCE, audio_levels_silent(levels));
+        }
+        return superframe_status_e::DECODED;
     }
     else {
-        return false;
+        return superframe_status_e::AU_CRC_ERROR;
     }
 }
 
-bool DabPlusSnoop::extract_au(vector<int> au_start)
+bool DabPlusSnoop::extract_au(const uint8_t *sf,
+        std::array<int, 7>& au_start, int num_aus)
 {
-    vector<vector<uint8_t> > aus(au_start.size());
-
     // The last entry of au_start must the end of valid
     // AU data. We stop at m_subchannel_index * 110 because
     // what comes after is RS parity
-    au_start.push_back(m_subchannel_index * 110);
+    au_start[num_aus] = m_subchannel_index * 110;
+
+    for (int au = 0; au < num_aus; au++) {
+        if (au_start[au+1] < au_start[au] + 2) {
+            printf(DPS_INDENT DPS_PREFIX
+                    "Invalid start for au %d: %d\n", au + 1, au_start[au+1]);
+            return false;
+        }
+    }
 
     bool all_crc_ok = true;
 
-    for (size_t au = 0; au < aus.size(); au++)
+    // The AUs stay in the superframe, and are only referenced
+    m_aus.clear();
+
+    for (int au = 0; au < num_aus; au++)
     {
+        au_span_t span;
+        span.offset = au_start[au];
+        span.length = au_start[au+1] - au_start[au] - 2;
+
 #if DPS_DEBUG
         printf(DPS_PREFIX DPS_INDENT
-                "Copy au %zu of size %d\n",
-                au,
-                au_start[au+1] - au_start[au]-2 );
+                "AU %d of size %zu\n", au, span.length);
 #endif
 
-        aus[au].resize(au_start[au+1] - au_start[au]-2);
-        std::copy(
-                m_data.begin() + au_start[au],
-                m_data.begin() + au_start[au+1]-2,
-                aus[au].begin() );
-
         /* Check CRC */
-        uint16_t au_crc = m_data[au_start[au+1]-2] << 8 | \
-                          m_data[au_start[au+1]-1];
+        const uint8_t *au_data = sf + span.offset;
+        uint16_t au_crc = au_data[span.length] << 8 | \
+                          au_data[span.length + 1];
 
         uint16_t calc_crc = 0xFFFF;
-        for (vector<uint8_t>::iterator au_data = aus[au].begin();
-                au_data != aus[au].end();
-                ++au_data) {
-            calc_crc = update_crc_ccitt(calc_crc, *au_data);
+        for (size_t i = 0; i < span.length; i++) {
+            calc_crc = update_crc_ccitt(calc_crc, au_data[i]);
         }
         calc_crc =~ calc_crc;
 
         if (calc_crc != au_crc) {
             printf(DPS_INDENT DPS_PREFIX
-                    "Erroneous CRC for au %zu: 0x%04x vs 0x%04x\n",
+                    "Erroneous CRC for au %d: 0x%04x vs 0x%04x\n",
                     au, calc_crc, au_crc);
 
             all_crc_ok = false;
+            m_au_crc_errors++;
         }
-    }
 
-    if (all_crc_ok) {
-        return analyse_au(aus);
-    }
-    else {
-        //discard faulty superframe (to be improved to correct/conceal)
-        m_data.clear();
-        return false;
+        m_aus_checked++;
+        m_aus.push_back(span);
     }
+
+    //faulty superframes get skipped (to be improved to correct/conceal)
+    return all_crc_ok;
 }
 
-bool DabPlusSnoop::analyse_au(vector<vector<uint8_t> >& aus)
+bool DabPlusSnoop::analyse_au(uint8_t *sf)
 {
-    stringstream ss_filename;
+    if (!m_faad_decoder.is_initialised()) {
+        stringstream ss_filename;
 
-    if (m_write_to_wav_file) {
-        ss_filename << "stream-" << subchid;
-    }
+        if (m_write_to_wav_file and not m_output_basename.empty()) {
+            ss_filename << m_output_basename;
+        }
+        else if (m_write_to_wav_file) {
+            ss_filename << "stream-" << subchid;
+        }
 
-    if (!m_faad_decoder.is_initialised()) {
-        m_faad_decoder.open(ss_filename.str(), m_ps_flag,
+        m_faad_decoder.open(ss_filename.str(), m_write_raw_pcm, m_ps_flag,
                 m_aac_channel_mode, m_dac_rate, m_sbr_flag,
                 m_mpeg_surround_config);
     }
 
-    return m_faad_decoder.decode(aus);
+    return m_faad_decoder.decode(sf, m_aus);
+}
+
+/* Find the PAD in the data_stream_element at the start of an AU of len
+ * bytes. The PAD is at pad_start, and is pad_len bytes long */
+static bool find_pad(const uint8_t *data, size_t len,
+        size_t& pad_start, size_t& pad_len)
+{
+    // data_stream_element: id_syn_ele 4, instance tag, align flag
+    if (len < 2 or (data[0] >> 5) != 4) {
+        return false;
+    }
+
+    pad_start = 2;
+    pad_len = data[1];
+    if (pad_len == 255) {
+        if (len < 3) {
+            return false;
+        }
+        pad_len += data[2];
+        pad_start++;
+    }
+
+    // X-PAD followed by the two F-PAD bytes
+    return pad_len >= 2 and pad_start + pad_len <= len;
+}
+
+void DabPlusSnoop::analyse_pad(const uint8_t *sf)
+{
+    // A superframe lasts 120ms, and is at the start of the buffer
+    const size_t sf_len = m_subchannel_index * 120;
+    const double sf_time = 0.12 *
+        (m_bytes_received - m_superframe_buffer.size()) / sf_len;
+
+    for (size_t i = 0; i < m_aus.size(); i++) {
+        const auto& au = m_aus[i];
+        const uint8_t *data = sf + au.offset;
+        pad.set_time(sf_time + 0.12 * i / m_aus.size());
+
+        size_t pad_start = 0;
+        size_t pad_len = 0;
+        if (find_pad(data, au.length, pad_start, pad_len)) {
+            pad.process(data + pad_start, pad_len - 2,
+                    data + pad_start + pad_len - 2);
+        }
+    }
 }
 
-StreamSnoop::StreamSnoop(StreamSnoop&& other)
+utilisation_t DabPlusSnoop::superframe_utilisation(const uint8_t *sf) const
 {
-    dps = move(other.dps);
-    m_raw_data_stream_fd = other.m_raw_data_stream_fd;
-    other.m_raw_data_stream_fd = nullptr;
-    m_dump_to_file = other.m_dump_to_file;
-    other.m_dump_to_file = false;
+    utilisation_t bytes;
+
+    // RS parity, header with the AU starts, and the AU CRCs
+    bytes.overhead = m_subchannel_index * 10;
+    if (not m_aus.empty()) {
+        bytes.overhead += m_aus[0].offset + 2 * m_aus.size();
+    }
+
+    for (const auto& au : m_aus) {
+        const uint8_t *data = sf + au.offset;
+
+        size_t dse_len = 0;
+        size_t pad_start = 0;
+        size_t pad_len = 0;
+        if (find_pad(data, au.length, pad_start, pad_len)) {
+            dse_len = pad_start + pad_len;
+        }
+
+        bytes.pad += dse_len;
+        const size_t fill = count_zero_fill(data + dse_len, au.length - dse_len);
+        bytes.padding += fill;
+        bytes.payload += au.length - dse_len - fill;
+    }
+
+    return bytes;
 }
 
-StreamSnoop::~StreamSnoop()
+void StreamSnoop::set_mot_dump_directory(const string& directory)
 {
-    if (m_raw_data_stream_fd) {
-        fclose(m_raw_data_stream_fd);
+    string prefix;
+    if (not directory.empty()) {
+        prefix = directory + "/mot-" + to_string(m_subchid) + "-";
     }
+    dps.pad.set_mot_dump_prefix(prefix);
+    mp2.pad.set_mot_dump_prefix(prefix);
+    pkt.set_mot_dump_prefix(prefix);
 }
 
 void StreamSnoop::push(uint8_t* streamdata, size_t streamsize)
@@ -334,26 +596,74 @@ void StreamSnoop::push(uint8_t* streamdata, size_t streamsize)
         throw logic_error("StreamSnoop not properly initialised");
     }
 
-    // First dump to subchannel file (superframe+parity word)
-    if (m_dump_to_file and m_raw_data_stream_fd == nullptr) {
-        stringstream dump_filename;
-        dump_filename << "stream-" << m_subchid << ".dab";
+    if (m_format == audio_format_e::UNKNOWN or
+            m_format == audio_format_e::DABPLUS) {
+        dps.push(streamdata, streamsize);
+    }
 
-        m_raw_data_stream_fd = fopen(dump_filename.str().c_str(), "w");
+    if (m_format == audio_format_e::UNKNOWN or
+            m_format == audio_format_e::MP2) {
+        mp2.push(streamdata, streamsize);
+    }
 
-        if (m_raw_data_stream_fd == nullptr) {
-            perror("File open failed");
-        }
+    if (m_format == audio_format_e::UNKNOWN or
+            m_format == audio_format_e::PACKET) {
+        pkt.push(streamdata, streamsize);
     }
 
-    if (m_raw_data_stream_fd) {
-        fwrite(streamdata, streamsize, 1, m_raw_data_stream_fd);
+    if (m_format == audio_format_e::UNKNOWN or
+            m_format == audio_format_e::MP2) {
+        utilisation_t bytes;
+        bytes.padding = count_zero_fill(streamdata, streamsize);
+        bytes.payload = streamsize - bytes.padding;
+        m_zero_fill_utilisation.add(bytes, 1);
     }
 
-    dps.push(streamdata, streamsize);
+    if (m_format == audio_format_e::UNKNOWN) {
+        if (dps.get_sync_statistics().num_locks > 0) {
+            m_format = audio_format_e::DABPLUS;
+        }
+        else if (mp2.num_frames() >= mp2_frames_to_detect) {
+            m_format = audio_format_e::MP2;
+        }
+        else if (pkt.num_valid_packets() >= packets_to_detect) {
+            m_format = audio_format_e::PACKET;
+        }
+    }
 }
 
 audio_statistics_t StreamSnoop::get_audio_statistics(void) const
 {
+    if (m_format == audio_format_e::MP2) {
+        return mp2.get_audio_statistics();
+    }
     return dps.get_audio_statistics();
 }
+
+utilisation_statistics_t StreamSnoop::get_utilisation_statistics(void) const
+{
+    switch (m_format) {
+        case audio_format_e::DABPLUS:
+            return dps.get_utilisation_statistics();
+        case audio_format_e::PACKET:
+            return pkt.get_utilisation_statistics();
+        default:
+            return m_zero_fill_utilisation.get_statistics();
+    }
+}
+
+pad_statistics_t StreamSnoop::get_pad_statistics(void) const
+{
+    if (m_format == audio_format_e::MP2) {
+        return mp2.pad.get_statistics();
+    }
+    return dps.pad.get_statistics();
+}
+
+audio_events_statistics_t StreamSnoop::get_event_statistics(void) const
+{
+    if (m_format == audio_format_e::MP2) {
+        return mp2.events.get_statistics();
+    }
+    return dps.events.get_statistics();
+}
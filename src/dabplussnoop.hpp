@@ -76,31 +76,140 @@ he_aac_super_frame(subchannel_index)
 #include <string>
 #include <sstream>
 #include <vector>
+#include <array>
+#include "audioevents.hpp"
 #include "faad_decoder.hpp"
+#include "mp2snoop.hpp"
+#include "packetsnoop.hpp"
+#include "paddecoder.hpp"
+#include "rsdecoder.hpp"
+#include "utilisation.hpp"
 
 #pragma once
 
+/* Fixed-capacity FIFO holding the subchannel data until a complete
+ * superframe is available. The ring holds two superframes, and its first
+ * superframe_len bytes are mirrored after its end, so that any span of up to
+ * superframe_len bytes is contiguous in memory, wherever it starts. Consuming
+ * data only moves the read position, nothing is ever shifted.
+ */
+class SuperframeBuffer {
+    public:
+        // Reallocates the ring and discards its contents
+        void set_superframe_len(size_t superframe_len);
+
+        /* Append as much of data as fits into the ring.
+         * Returns the number of bytes accepted. */
+        size_t push(const uint8_t *data, size_t len);
+
+        /* Pointer to the byte at offset from the read position, valid
+         * for superframe_len contiguous bytes */
+        uint8_t* at(size_t offset);
+
+        void consume(size_t len);
+        void clear(void) { m_fill = 0; }
+        size_t size(void) const { return m_fill; }
+
+    private:
+        std::vector<uint8_t> m_buf;
+        size_t m_capacity = 0;
+        size_t m_superframe_len = 0;
+        size_t m_start = 0;
+        size_t m_fill = 0;
+};
+
+struct superframe_sync_statistics_t {
+    size_t superframes_decoded = 0;
+    size_t superframes_skipped = 0; // RS or AU CRC errors while in sync
+
+    // Integrity of the superframes received while in sync
+    size_t rs_corrected_bytes = 0;
+    size_t rs_uncorrectable = 0;    // Superframes
+    size_t aus = 0;                 // AUs whose CRC was checked
+    size_t au_crc_errors = 0;
+
+    size_t num_locks = 0;
+    size_t num_unlocks = 0;
+
+    // Time from start until the first lock, -1 if never locked
+    double time_to_first_lock_ms = -1;
+};
+
 // DabPlusSnoop is responsible for decoding DAB+ audio
 class DabPlusSnoop {
     public:
         void set_subchannel_index(unsigned subchannel_index) {
-            m_subchannel_index = subchannel_index;
+            if (m_subchannel_index != subchannel_index) {
+                m_subchannel_index = subchannel_index;
+                m_superframe_buffer.set_superframe_len(subchannel_index * 120);
+                m_superframe.resize(subchannel_index * 120);
+                m_locked = false;
+                m_bytes_unlocked = 0;
+            }
         }
 
         void enable_wav_file_output(bool enable) {
             m_write_to_wav_file = enable;
         }
 
+        // Name of the audio file without extension, instead of stream-N
+        void set_output_basename(const std::string& basename) {
+            m_output_basename = basename;
+        }
+
+        // Write headerless PCM instead of a wav file
+        void enable_raw_pcm_output(bool enable) {
+            m_write_raw_pcm = enable;
+        }
+
+        /* Stop after the AU CRCs, without decoding the PAD and the audio.
+         * Only the sync, integrity and utilisation statistics are kept. */
+        void enable_integrity_only(bool enable) {
+            m_integrity_only = enable;
+        }
+
+        // Write the loudness time series of the subchannel to fd
+        void set_loudness_series_file(FILE *fd) {
+            m_faad_decoder.set_loudness_series_file(fd, subchid);
+        }
+
+        // Write the properties of every AU as CSV lines to fd
+        void set_au_statistics_file(FILE *fd) {
+            m_faad_decoder.set_au_statistics_file(fd);
+        }
+
         void push(uint8_t* streamdata, size_t streamsize);
 
         audio_statistics_t get_audio_statistics(void) const;
 
+        aac_statistics_t get_aac_statistics(void) const {
+            return m_faad_decoder.get_aac_statistics();
+        }
+
+        superframe_sync_statistics_t get_sync_statistics(void) const {
+            return m_sync_stats;
+        }
+
+        // Of the superframes received while in sync
+        utilisation_statistics_t get_utilisation_statistics(void) const {
+            return m_utilisation.get_statistics();
+        }
+
         int subchid = -1;
 
+        PadDecoder pad;
+
+        // Errors and silence of the superframes decoded while in sync
+        AudioEventDetector events;
+
     private:
         /* Data needed for FAAD */
         FaadDecoder m_faad_decoder;
+        RSDecoder m_rs_decoder;
         bool m_write_to_wav_file = false;
+        std::string m_output_basename;
+        bool m_write_raw_pcm = false;
+        bool m_integrity_only = false;
 
         bool m_ps_flag = false;
         bool m_aac_channel_mode = false;
@@ -108,32 +217,94 @@ class DabPlusSnoop {
         bool m_sbr_flag = false;
         int  m_mpeg_surround_config = false;
 
+        /* Superframe synchronisation. Once a superframe has been decoded,
+         * the following ones are expected back to back, and only the
+         * firecode at the expected position is checked. Some
+         * consecutive firecode errors are tolerated before the lock is
+         * given up and the data is scanned byte by byte again. */
+        bool m_locked = false;
+        int m_lock_misses = 0;
+        size_t m_bytes_unlocked = 0; // Received since the lock was lost
+        size_t m_bytes_received = 0; // Since the start, gives the time
+        superframe_sync_statistics_t m_sync_stats;
+        UtilisationTracker m_utilisation;
+
+        // Checks of the last superframe given to decode()
+        int m_rs_corrected = 0;
+        size_t m_aus_checked = 0;
+        size_t m_au_crc_errors = 0;
+
+        enum class superframe_status_e {
+            DECODED,
+            FIRECODE_ERROR, // Superframe not where it was expected
+            RS_ERROR,       // Uncorrectable errors
+            AU_CRC_ERROR,
+        };
+
         /* Functions */
 
+        /* Search for a valid superframe header from start. Returns true and
+         * its position if found, otherwise false and the position up to
+         * which the data has been checked */
+        bool find_valid_firecode(size_t start, size_t& position);
         bool seek_valid_firecode(void);
-        bool decode(void);
-        bool extract_au(std::vector<int> au_start);
-        bool analyse_au(std::vector<std::vector<uint8_t> >& aus);
+        superframe_status_e decode(void);
+        void lock(void);
+        /* Check the AUs of the superframe sf, and set m_aus.
+         * au_start must contain one free entry after the last AU */
+        bool extract_au(const uint8_t *sf,
+                std::array<int, 7>& au_start, int num_aus);
+        bool analyse_au(uint8_t *sf);
+
+        // Pass the data_stream_element at the start of each AU to pad
+        void analyse_pad(const uint8_t *sf);
+
+        // Split the decoded superframe sf into payload, PAD and overhead
+        utilisation_t superframe_utilisation(const uint8_t *sf) const;
+
+        // The AUs of the current superframe
+        std::vector<au_span_t> m_aus;
 
         unsigned m_subchannel_index = 0;
-        std::vector<uint8_t> m_data;
+        SuperframeBuffer m_superframe_buffer;
+
+        /* The superframe given to decode(), corrected by the RS decoder.
+         * The received data stays untouched, so that a candidate that gets
+         * rejected does not leave miscorrected bytes behind for the next
+         * search. */
+        std::vector<uint8_t> m_superframe;
+};
+
+enum class audio_format_e {
+    UNKNOWN,
+    DABPLUS,
+    MP2,
+    PACKET, // Packet mode data
 };
 
-// StreamSnoop is responsible for saving msc data into files,
-// and calling DabPlusSnoop's decode routine if it's a DAB+ subchannel
+// StreamSnoop is responsible for calling DabPlusSnoop's decode routine
+// if it's a DAB+ subchannel,
+// Mp2Snoop's if it's a DAB subchannel, or PacketSnoop's for packet mode
+// data. The format is detected from the data: all are fed until
+// DabPlusSnoop locks to a superframe, Mp2Snoop has found some frames, or
+// PacketSnoop some packets with a correct CRC.
 class StreamSnoop {
     public:
         StreamSnoop(int subchid, bool dump_to_file) :
             dps(),
             m_subchid(subchid),
-            m_raw_data_stream_fd(nullptr),
             m_dump_to_file(dump_to_file) {
                 dps.subchid = subchid;
+                dps.pad.subchid = subchid;
+                mp2.pad.subchid = subchid;
+                dps.events.subchid = subchid;
+                mp2.events.subchid = subchid;
                 dps.enable_wav_file_output(dump_to_file);
             }
-        ~StreamSnoop();
-        StreamSnoop(StreamSnoop&& other);
 
+        // Not movable like its FaadDecoder, streams are constructed in place
+        StreamSnoop(StreamSnoop&& other) = delete;
+        StreamSnoop& operator=(StreamSnoop&& other) = delete;
         StreamSnoop(const StreamSnoop& other) = delete;
         StreamSnoop& operator=(const StreamSnoop& other) = delete;
 
@@ -142,16 +313,86 @@ class StreamSnoop {
             dps.set_subchannel_index(subchannel_index);
         }
 
+        void set_loudness_series_file(FILE *fd)
+        {
+            dps.set_loudness_series_file(fd);
+        }
+
+        void enable_raw_pcm_output(bool enable)
+        {
+            dps.enable_raw_pcm_output(enable);
+        }
+
+        void enable_integrity_only(bool enable)
+        {
+            dps.enable_integrity_only(enable);
+        }
+
+        // Number and TIST of the ETI frame whose data is pushed next
+        void set_frame(size_t frame_number, uint32_t tist)
+        {
+            dps.events.set_frame(frame_number, tist);
+            mp2.events.set_frame(frame_number, tist);
+        }
+
+        // Write the audio events to fd as CSV lines
+        void set_events_file(FILE *fd)
+        {
+            dps.events.set_events_file(fd);
+            mp2.events.set_events_file(fd);
+        }
+
+        // Write the MOT objects to directory, unless it is empty
+        void set_mot_dump_directory(const std::string& directory);
+
         void push(uint8_t* streamdata, size_t streamsize);
 
         audio_statistics_t get_audio_statistics(void) const;
 
+        superframe_sync_statistics_t get_sync_statistics(void) const
+        {
+            return dps.get_sync_statistics();
+        }
+
+        mp2_statistics_t get_mp2_statistics(void) const
+        {
+            return mp2.get_statistics();
+        }
+
+        packet_statistics_t get_packet_statistics(void) const
+        {
+            return pkt.get_statistics();
+        }
+
+        utilisation_statistics_t get_utilisation_statistics(void) const;
+
+        pad_statistics_t get_pad_statistics(void) const;
+
+        audio_events_statistics_t get_event_statistics(void) const;
+
+        audio_format_e get_format(void) const { return m_format; }
+
+        /* The subchannel data is to be written to a file, and the DAB+
+         * audio to stream-N.wav */
+        bool dump_to_file(void) const { return m_dump_to_file; }
+
         int stream_index = -1;
 
     private:
+        // Frames needed to recognise a DAB subchannel
+        static const size_t mp2_frames_to_detect = 3;
+
+        // Packets needed to recognise a packet mode subchannel
+        static const size_t packets_to_detect = 8;
+
         DabPlusSnoop dps;
+        Mp2Snoop mp2;
+        PacketSnoop pkt;
+
+        // Zero fill of the subchannels that are neither DAB+ nor packet mode
+        UtilisationTracker m_zero_fill_utilisation;
+        audio_format_e m_format = audio_format_e::UNKNOWN;
         int m_subchid = -1;
-        FILE* m_raw_data_stream_fd;
         bool m_dump_to_file;
 };
 
@@ -0,0 +1,173 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    decoderpool.cpp
+        Decode several subchannels in parallel on worker threads
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#include <cstring>
+#include <stdexcept>
+#include "decoderpool.hpp"
+
+using namespace std;
+
+DecoderPool::DecoderPool(size_t num_workers)
+{
+    if (num_workers == 0) {
+        throw invalid_argument("DecoderPool needs at least one worker");
+    }
+
+    for (size_t i = 0; i < num_workers; i++) {
+        m_workers.emplace_back(make_unique<worker_t>());
+        worker_t& worker = *m_workers.back();
+        worker.thread = thread(&DecoderPool::worker_loop, this, ref(worker));
+    }
+}
+
+DecoderPool::~DecoderPool()
+{
+    finish();
+}
+
+void DecoderPool::push(StreamSnoop& snoop, unsigned subchannel_index,
+        size_t frame_number, uint32_t tist,
+        const uint8_t *streamdata, size_t streamsize)
+{
+    if (m_finished) {
+        throw logic_error("DecoderPool: push after finish");
+    }
+
+    if (streamsize > max_stream_size) {
+        throw invalid_argument("DecoderPool: stream data too large");
+    }
+
+    auto it = m_streams.find(&snoop);
+    if (it == m_streams.end()) {
+        auto stream = make_unique<stream_t>();
+        stream->snoop = &snoop;
+        stream->frames.resize(queue_length);
+
+        worker_t *worker = m_workers[m_next_worker].get();
+        m_next_worker = (m_next_worker + 1) % m_workers.size();
+
+        {
+            lock_guard<mutex> lock(worker->mutex);
+            worker->streams.push_back(stream.get());
+        }
+
+        it = m_streams.emplace(&snoop,
+                make_pair(move(stream), worker)).first;
+    }
+
+    stream_t& stream = *it->second.first;
+    worker_t& worker = *it->second.second;
+
+    const size_t head = stream.head.load(memory_order_relaxed);
+    if (head - stream.tail.load(memory_order_acquire) == queue_length) {
+        // The worker is behind, and has been notified already
+        unique_lock<mutex> lock(stream.mutex);
+        stream.producer_waiting = true;
+
+        // Sequentially consistent with the store of tail and the load of
+        // producer_waiting in decode_pending, so that no wakeup gets lost
+        stream.cv.wait(lock, [&]{ return head - stream.tail.load() < queue_length; });
+        stream.producer_waiting = false;
+    }
+
+    frame_t& frame = stream.frames[head % queue_length];
+    frame.subchannel_index = subchannel_index;
+    frame.frame_number = frame_number;
+    frame.tist = tist;
+    frame.size = streamsize;
+    memcpy(frame.data, streamdata, streamsize);
+    stream.head.store(head + 1, memory_order_release);
+
+    {
+        lock_guard<mutex> lock(worker.mutex);
+        worker.pending = true;
+    }
+    worker.cv.notify_one();
+}
+
+void DecoderPool::finish()
+{
+    if (m_finished) {
+        return;
+    }
+    m_finished = true;
+
+    for (auto& worker : m_workers) {
+        {
+            lock_guard<mutex> lock(worker->mutex);
+            worker->stop = true;
+        }
+        worker->cv.notify_one();
+    }
+
+    for (auto& worker : m_workers) {
+        worker->thread.join();
+    }
+}
+
+void DecoderPool::worker_loop(worker_t& worker)
+{
+    vector<stream_t*> streams;
+
+    bool stop = false;
+    while (not stop) {
+        {
+            unique_lock<mutex> lock(worker.mutex);
+            worker.cv.wait(lock, [&]{ return worker.pending or worker.stop; });
+            worker.pending = false;
+
+            // Once stop is set, nothing more gets pushed, and this is
+            // the last pass over the queues
+            stop = worker.stop;
+
+            // Streams only ever get added
+            if (streams.size() != worker.streams.size()) {
+                streams = worker.streams;
+            }
+        }
+
+        for (auto stream : streams) {
+            decode_pending(*stream);
+        }
+    }
+}
+
+void DecoderPool::decode_pending(stream_t& stream)
+{
+    size_t tail = stream.tail.load(memory_order_relaxed);
+    const size_t head = stream.head.load(memory_order_acquire);
+
+    for (; tail != head; tail++) {
+        frame_t& frame = stream.frames[tail % queue_length];
+        stream.snoop->set_subchannel_index(frame.subchannel_index);
+        stream.snoop->set_frame(frame.frame_number, frame.tist);
+        stream.snoop->push(frame.data, frame.size);
+
+        stream.tail.store(tail + 1);
+
+        if (stream.producer_waiting) {
+            lock_guard<mutex> lock(stream.mutex);
+            stream.cv.notify_one();
+        }
+    }
+}
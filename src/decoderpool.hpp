@@ -0,0 +1,117 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    decoderpool.hpp
+        Decode several subchannels in parallel on worker threads
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "dabplussnoop.hpp"
+
+/* Every StreamSnoop given to the pool is pinned to one of the workers, which
+ * does all its decoding. The stream data of each subchannel goes through a
+ * single-producer single-consumer queue of ETI frame payloads, so that the
+ * thread reading the ETI file never waits for a decoder, unless the queue is
+ * full.
+ *
+ * All StreamSnoop functions may only be called from the thread that owns
+ * the pool once finish() has returned.
+ */
+class DecoderPool {
+    public:
+        DecoderPool(size_t num_workers);
+        ~DecoderPool();
+
+        DecoderPool(const DecoderPool& other) = delete;
+        DecoderPool& operator=(const DecoderPool& other) = delete;
+
+        /* Queue the data of one ETI frame for the subchannel decoded by snoop.
+         * The worker sets the subchannel index, and the number and TIST of
+         * the frame before decoding it. Blocks
+         * while the queue of this subchannel is full, until the worker has
+         * decoded a frame of it.
+         * Must always be called from the same thread. */
+        void push(StreamSnoop& snoop, unsigned subchannel_index,
+                size_t frame_number, uint32_t tist,
+                const uint8_t *streamdata, size_t streamsize);
+
+        // Wait until all queued data is decoded, and stop the workers
+        void finish(void);
+
+    private:
+        // Largest possible sub-channel stream in an ETI frame
+        static const size_t max_stream_size = 684 * 8;
+
+        // Frames per queue, about 1.5s of audio
+        static const size_t queue_length = 64;
+
+        struct frame_t {
+            unsigned subchannel_index = 0;
+            size_t frame_number = 0;
+            uint32_t tist = 0;
+            size_t size = 0;
+            uint8_t data[max_stream_size];
+        };
+
+        struct stream_t {
+            StreamSnoop *snoop = nullptr;
+            std::vector<frame_t> frames;
+
+            // Number of frames written and read so far
+            std::atomic<size_t> head{0};
+            std::atomic<size_t> tail{0};
+
+            /* The producer waits on cv while the queue is full. The worker
+             * only takes the mutex to notify it when producer_waiting is
+             * set, which is checked after every advance of tail. */
+            std::mutex mutex;
+            std::condition_variable cv;
+            std::atomic<bool> producer_waiting{false};
+        };
+
+        struct worker_t {
+            std::thread thread;
+
+            std::mutex mutex;
+            std::condition_variable cv;
+            bool pending = false;
+            bool stop = false;
+            std::vector<stream_t*> streams;
+        };
+
+        void worker_loop(worker_t& worker);
+        static void decode_pending(stream_t& stream);
+
+        bool m_finished = false;
+        std::vector<std::unique_ptr<worker_t> > m_workers;
+        size_t m_next_worker = 0;
+
+        // Only used by the producer
+        std::map<StreamSnoop*, std::pair<std::unique_ptr<stream_t>, worker_t*> > m_streams;
+};
+
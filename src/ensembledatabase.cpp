@@ -27,10 +27,9 @@
 
 */
 
-#include <locale>
-#include <codecvt>
 #include <iomanip>
 #include <sstream>
+#include <algorithm>
 #include "ensembledatabase.hpp"
 #include "charset.hpp"
 #include "utils.hpp"
@@ -39,104 +38,136 @@ namespace ensemble_database {
 
 using namespace std;
 
-static string ucs2toutf8(const uint8_t *ucs2, size_t len_bytes)
-{
-    std::wstring_convert<std::codecvt_utf8<wchar_t>> ucsconv;
-
-    wstring ucs2label;
-
-    for (size_t i = 0; i < len_bytes-1; i+=2) {
-        ucs2label += (wchar_t)(ucs2[i] * 256uL + ucs2[i+1]);
-    }
-
-    // Can throw range_error
-    return ucsconv.to_bytes(ucs2label);
-}
-
-std::string label_t::label() const
+static void to_utf8(charset_e charset, const uint8_t *data, size_t len, string& utf8)
 {
     switch (charset) {
         case charset_e::COMPLETE_EBU_LATIN:
-            return convert_ebu_to_utf8(string(label_bytes.begin(), label_bytes.end()));
+            convert_ebu_to_utf8(data, len, utf8);
+            return;
         case charset_e::UTF8:
-            return string(label_bytes.begin(), label_bytes.end());
+            utf8.assign(data, data + len);
+            return;
         case charset_e::UCS2:
-            try {
-                return ucs2toutf8(label_bytes.data(), label_bytes.size());
-            }
-            catch (const range_error&) {
-                return "";
-            }
+            convert_ucs2_to_utf8(data, len, utf8);
+            return;
         case charset_e::UNDEFINED:
             throw logic_error("charset undefined");
     }
     throw logic_error("invalid charset " + to_string((int)charset));
 }
 
-std::string label_t::shortlabel() const
+void label_t::set_fig1_label(const vector<uint8_t>& label_bytes,
+        uint16_t shortlabel_flag, charset_e charset)
+{
+    if (m_label_bytes != label_bytes or
+            m_shortlabel_flag != shortlabel_flag or
+            m_charset != charset) {
+        m_label_bytes = label_bytes;
+        m_shortlabel_flag = shortlabel_flag;
+        m_charset = charset;
+        m_fig1_cache_valid = false;
+    }
+}
+
+void label_t::update_fig1_cache() const
 {
-    string shortlabel;
-    for (size_t i = 0; i < label_bytes.size(); ++i) {
-        if (shortlabel_flag & 0x8000 >> i) {
-            shortlabel += static_cast<char>(label_bytes[i]);
+    if (m_fig1_cache_valid) {
+        return;
+    }
+
+    to_utf8(m_charset, m_label_bytes.data(), m_label_bytes.size(), m_label_utf8);
+
+    uint8_t shortlabel[16];
+    size_t shortlabel_len = 0;
+    for (size_t i = 0; i < m_label_bytes.size() and i < sizeof(shortlabel); ++i) {
+        if (m_shortlabel_flag & 0x8000 >> i) {
+            shortlabel[shortlabel_len++] = m_label_bytes[i];
         }
     }
+    to_utf8(m_charset, shortlabel, shortlabel_len, m_shortlabel_utf8);
 
-    switch (charset) {
-        case charset_e::COMPLETE_EBU_LATIN:
-            return convert_ebu_to_utf8(shortlabel);
-        case charset_e::UTF8:
-            return shortlabel;
-        case charset_e::UCS2:
-            try {
-                return ucs2toutf8((const uint8_t*)shortlabel.data(), shortlabel.size());
-            }
-            catch (const range_error&) {
-                return "";
-            }
-        case charset_e::UNDEFINED:
-            throw logic_error("charset undefined");
+    m_fig1_cache_valid = true;
+}
+
+const std::string& label_t::label() const
+{
+    update_fig1_cache();
+    return m_label_utf8;
+}
+
+const std::string& label_t::shortlabel() const
+{
+    update_fig1_cache();
+    return m_shortlabel_utf8;
+}
+
+void label_t::set_toggle_flag(uint8_t toggle_flag)
+{
+    if (m_toggle_flag != toggle_flag) {
+        m_segments.clear();
+        m_extended_label_charset = charset_e::UNDEFINED;
+        m_toggle_flag = toggle_flag;
+        m_fig2_cache_valid = false;
     }
-    throw logic_error("invalid charset " + to_string((int)charset));
 }
 
-string label_t::assemble() const
+void label_t::set_extended_label_header(size_t segment_count, charset_e charset)
 {
-    vector<uint8_t> segments_cat;
-    for (size_t i = 0; i < segment_count; i++) {
-        if (segments.count(i) == 0) {
-            return "";
-        }
-        else {
-            const auto& s = segments.at(i);
-            copy(s.begin(), s.end(), back_inserter(segments_cat));
-        }
+    if (m_segment_count != segment_count or
+            m_extended_label_charset != charset) {
+        m_segment_count = segment_count;
+        m_extended_label_charset = charset;
+        m_fig2_cache_valid = false;
     }
+}
 
-    switch (extended_label_charset) {
-        case charset_e::COMPLETE_EBU_LATIN:
-            // FIG2 doesn't allow EBU, use FIG1 for those
-            return "";
-        case charset_e::UTF8:
-            return string(segments_cat.begin(), segments_cat.end());
-        case charset_e::UCS2:
-            try {
-                return ucs2toutf8(segments_cat.data(), segments_cat.size());
-            }
-            catch (const range_error&) {
-                return "";
-            }
-        case charset_e::UNDEFINED:
-            return "";
+void label_t::set_segment(int segment_index, const uint8_t *data, size_t len)
+{
+    auto& segment = m_segments[segment_index];
+    if (segment.size() != len or not equal(segment.begin(), segment.end(), data)) {
+        segment.assign(data, data + len);
+        m_fig2_cache_valid = false;
     }
-    throw logic_error("invalid extended label charset " + to_string((int)extended_label_charset));
 }
 
-string label_t::assembly_state() const
+void label_t::update_fig2_cache() const
 {
+    // The assembly state shows the segment bytes depending on verbosity
+    if (m_fig2_cache_valid and m_assembly_state_verbosity == get_verbosity()) {
+        return;
+    }
+
+    m_assembled_utf8.clear();
+
+    bool all_segments_received = true;
+    size_t total_len = 0;
+    for (size_t i = 0; i < m_segment_count; i++) {
+        const auto s = m_segments.find(i);
+        if (s == m_segments.end()) {
+            all_segments_received = false;
+            break;
+        }
+        total_len += s->second.size();
+    }
+
+    // FIG2 doesn't allow EBU, use FIG1 for those
+    if (all_segments_received and
+            (m_extended_label_charset == charset_e::UTF8 or
+             m_extended_label_charset == charset_e::UCS2)) {
+        vector<uint8_t> segments_cat;
+        segments_cat.reserve(total_len);
+        for (size_t i = 0; i < m_segment_count; i++) {
+            const auto& s = m_segments.at(i);
+            segments_cat.insert(segments_cat.end(), s.begin(), s.end());
+        }
+
+        to_utf8(m_extended_label_charset,
+                segments_cat.data(), segments_cat.size(), m_assembled_utf8);
+    }
+
     stringstream ss;
     ss << "(";
-    for (const auto& s : segments) {
+    for (const auto& s : m_segments) {
         ss << s.first;
         if (get_verbosity() > 1) {
             ss << "[";
@@ -148,9 +179,9 @@ string label_t::assembly_state() const
         ss << ",";
     }
 
-    ss << "count=" << segment_count << ",";
+    ss << "count=" << m_segment_count << ",";
     ss << "charset=";
-    switch (extended_label_charset) {
+    switch (m_extended_label_charset) {
         case charset_e::COMPLETE_EBU_LATIN:
             throw logic_error("invalid extended label LATIN charset");
         case charset_e::UTF8:
@@ -164,8 +195,22 @@ string label_t::assembly_state() const
             break;
     }
     ss << ")";
+    m_assembly_state = ss.str();
+
+    m_assembly_state_verbosity = get_verbosity();
+    m_fig2_cache_valid = true;
+}
+
+const string& label_t::assemble() const
+{
+    update_fig2_cache();
+    return m_assembled_utf8;
+}
 
-    return ss.str();
+const string& label_t::assembly_state() const
+{
+    update_fig2_cache();
+    return m_assembly_state;
 }
 
 component_t& service_t::get_component_by_subchannel(uint32_t subchannel_id)
@@ -260,4 +305,34 @@ subchannel_t& ensemble_t::get_or_create_subchannel(uint8_t subchannel_id)
     return subchannels.back();
 }
 
+packet_component_t& ensemble_t::get_packet_component(uint8_t subchannel_id,
+        uint16_t packet_address)
+{
+    for (auto& component : packet_components) {
+        if (component.subchId == subchannel_id and
+                component.packet_address == packet_address) {
+            return component;
+        }
+    }
+
+    throw not_found("Packet component at address " +
+            to_string(packet_address) + " of subchannel " +
+            to_string(subchannel_id) + " not found");
+}
+
+packet_component_t& ensemble_t::get_or_create_packet_component(uint16_t scid)
+{
+    for (auto& component : packet_components) {
+        if (component.scid == scid) {
+            return component;
+        }
+    }
+
+    // not found
+    packet_component_t new_component;
+    new_component.scid = scid;
+    packet_components.push_back(new_component);
+    return packet_components.back();
+}
+
 }
@@ -49,28 +49,66 @@ enum class charset_e {
     UNDEFINED,
 };
 
-struct label_t {
-    // FIG 1 Label and shortlabel, in raw form
-    std::vector<uint8_t> label_bytes;
-    uint16_t shortlabel_flag;
-    charset_e charset = charset_e::COMPLETE_EBU_LATIN;
-
-    // Returns a utf-8 encoded shortlabel
-    std::string shortlabel() const;
-    std::string label() const;
-
-    // Extended Label from FIG 2
-    std::map<int, std::vector<uint8_t> > segments;
-    size_t segment_count = 0; // number if actual segments (not segment count as in spec)
-    charset_e extended_label_charset = charset_e::UNDEFINED;
-    uint8_t toggle_flag = 0;
-
-    // Assemble all segments into a UTF-8 string. Returns an
-    // empty string if not all segments received.
-    std::string assemble() const;
-
-    // Return a string that represents segment count and completeness
-    std::string assembly_state() const;
+class label_t {
+    public:
+        // Update the FIG 1 label and shortlabel, in raw form. The cached
+        // UTF-8 representations are only invalidated if something changed.
+        void set_fig1_label(const std::vector<uint8_t>& label_bytes,
+                uint16_t shortlabel_flag, charset_e charset);
+
+        // Returns a utf-8 encoded shortlabel
+        const std::string& shortlabel() const;
+        const std::string& label() const;
+
+        // Extended Label from FIG 2. A change of toggle flag clears
+        // all segments received so far.
+        void set_toggle_flag(uint8_t toggle_flag);
+        uint8_t toggle_flag() const { return m_toggle_flag; }
+
+        // Set the segment count (number of actual segments, not segment
+        // count as in spec) and charset, carried in the first segment
+        void set_extended_label_header(size_t segment_count, charset_e charset);
+        void set_segment(int segment_index, const uint8_t *data, size_t len);
+
+        // Assemble all segments into a UTF-8 string. Returns an
+        // empty string if not all segments received.
+        const std::string& assemble() const;
+
+        // Return a string that represents segment count and completeness
+        const std::string& assembly_state() const;
+
+        // Raw state, used to save ensemble snapshots
+        const std::vector<uint8_t>& label_bytes() const { return m_label_bytes; }
+        uint16_t shortlabel_flag() const { return m_shortlabel_flag; }
+        charset_e charset() const { return m_charset; }
+        const std::map<int, std::vector<uint8_t> >& segments() const { return m_segments; }
+        size_t segment_count() const { return m_segment_count; }
+        charset_e extended_label_charset() const { return m_extended_label_charset; }
+
+    private:
+        // FIG 1 Label and shortlabel, in raw form
+        std::vector<uint8_t> m_label_bytes;
+        uint16_t m_shortlabel_flag = 0;
+        charset_e m_charset = charset_e::COMPLETE_EBU_LATIN;
+
+        // Extended Label from FIG 2
+        std::map<int, std::vector<uint8_t> > m_segments;
+        size_t m_segment_count = 0;
+        charset_e m_extended_label_charset = charset_e::UNDEFINED;
+        uint8_t m_toggle_flag = 0;
+
+        // Cached UTF-8 forms, rebuilt on first access after a change
+        mutable bool m_fig1_cache_valid = false;
+        mutable std::string m_label_utf8;
+        mutable std::string m_shortlabel_utf8;
+
+        mutable bool m_fig2_cache_valid = false;
+        mutable int m_assembly_state_verbosity = -1;
+        mutable std::string m_assembled_utf8;
+        mutable std::string m_assembly_state;
+
+        void update_fig1_cache() const;
+        void update_fig2_cache() const;
 };
 
 struct subchannel_t {
@@ -127,6 +165,15 @@ struct service_t {
 };
 
 
+// Service component in packet mode, from FIG 0/3
+struct packet_component_t {
+    uint16_t scid = 0;
+    uint8_t subchId = 0;
+    uint16_t packet_address = 0;
+    uint8_t dscty = 0;
+    bool dg_flag = false; // MSC data groups are not used if set
+};
+
 class not_found : public std::runtime_error
 {
     public:
@@ -139,6 +186,7 @@ struct ensemble_t {
 
     std::list<service_t> services;
     std::list<subchannel_t> subchannels;
+    std::list<packet_component_t> packet_components;
 
     // TODO ecc
 
@@ -147,6 +195,10 @@ struct ensemble_t {
 
     subchannel_t& get_subchannel(uint8_t subchannel_id);
     subchannel_t& get_or_create_subchannel(uint8_t subchannel_id);
+
+    packet_component_t& get_packet_component(uint8_t subchannel_id,
+            uint16_t packet_address);
+    packet_component_t& get_or_create_packet_component(uint16_t scid);
 };
 
 }
@@ -30,9 +30,15 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cinttypes>
+#include <cmath>
+#include <memory>
+#include <thread>
 #include "etianalyse.hpp"
+#include "decoderpool.hpp"
 #include "etiinput.hpp"
 #include "figs.hpp"
+#include "snapshot.hpp"
 
 extern "C" {
 #include "lib_crc.h"
@@ -91,13 +97,197 @@ static void print_fig_result(const fig_result_t& fig_result, const display_setti
     }
 }
 
-void ETI_Analyser::analyse()
+// Loudness in LUFS or dBTP, null if it could not be measured
+static string loudness_to_yaml(double value)
 {
+    return std::isfinite(value) ? strprintf("%.1f", value) : "null";
+}
+
+// Double-quoted YAML string, the text comes from the broadcast
+static string string_to_yaml(const string& str)
+{
+    string quoted = "\"";
+    for (const char c : str) {
+        if (c == '"' or c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        }
+        else if ((uint8_t)c < 0x20 or c == 0x7F) {
+            quoted += strprintf("\\x%02x", (uint8_t)c);
+        }
+        else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+// MOT decoder statistics, with the given indentation
+static void mot_to_yaml(FILE *fd, const string& indent,
+        const mot_statistics_t& mot)
+{
+    const char *ind = indent.c_str();
+    fprintf(fd, "%sdata_groups: %zu\n", ind, mot.data_groups);
+    fprintf(fd, "%scrc_errors: %zu\n", ind, mot.crc_errors);
+    fprintf(fd, "%sinvalid_data_groups: %zu\n", ind, mot.invalid_data_groups);
+    fprintf(fd, "%ssegments: %zu\n", ind, mot.segments);
+    fprintf(fd, "%sobjects_completed: %zu\n", ind, mot.objects_completed);
+    fprintf(fd, "%sobjects_evicted: %zu\n", ind, mot.objects_evicted);
+    fprintf(fd, "%smax_memory: %zu\n", ind, mot.max_memory);
+    if (mot.objects.empty()) {
+        fprintf(fd, "%sobjects: []\n", ind);
+        return;
+    }
+
+    fprintf(fd, "%sobjects:\n", ind);
+    for (const auto& obj : mot.objects) {
+        fprintf(fd, "%s    - name: %s\n", ind, string_to_yaml(obj.name).c_str());
+        fprintf(fd, "%s      transport_id: %d\n", ind, obj.transport_id);
+        fprintf(fd, "%s      content_type: %s\n", ind,
+                mot_content_type_to_string(obj.content_type,
+                    obj.content_subtype).c_str());
+        fprintf(fd, "%s      size: %zu\n", ind, obj.body_size);
+        fprintf(fd, "%s      hash: \"%016" PRIx64 "\"\n", ind, obj.hash);
+        fprintf(fd, "%s      completed: %zu\n", ind, obj.times_completed);
+        fprintf(fd, "%s      first_completed_s: %.1f\n", ind, obj.first_completed);
+        if (obj.times_completed > 1) {
+            fprintf(fd, "%s      repetition_s: %.1f\n", ind,
+                    (obj.last_completed - obj.first_completed) /
+                    (obj.times_completed - 1));
+        }
+        else {
+            fprintf(fd, "%s      repetition_s: null\n", ind);
+        }
+    }
+}
+
+// Packet mode statistics of subchannel subchid
+static void packet_to_yaml(FILE *fd, ensemble_database::ensemble_t& ensemble,
+        int subchid, const packet_statistics_t& pkt)
+{
+    fprintf(fd, "      packet:\n");
+    fprintf(fd, "          packets: %zu\n", pkt.packets);
+    fprintf(fd, "          crc_errors: %zu\n", pkt.crc_errors);
+    fprintf(fd, "          padding_packets: %zu\n", pkt.padding_packets);
+    fprintf(fd, "          truncated_packets: %zu\n", pkt.truncated_packets);
+    if (pkt.addresses.empty()) {
+        fprintf(fd, "          addresses: []\n");
+        return;
+    }
+
+    fprintf(fd, "          addresses:\n");
+    for (const auto& el : pkt.addresses) {
+        const auto& addr = el.second;
+        fprintf(fd, "              - address: %d\n", el.first);
+        try {
+            // Signalled in FIG 0/3
+            const auto& component = ensemble.get_packet_component(subchid, el.first);
+            fprintf(fd, "                scid: 0x%x\n", component.scid);
+            fprintf(fd, "                dscty: %d\n", component.dscty);
+        }
+        catch (ensemble_database::not_found &e) {
+            fprintf(fd, "                scid: null\n");
+            fprintf(fd, "                dscty: null\n");
+        }
+        fprintf(fd, "                packets: %zu\n", addr.packets);
+        fprintf(fd, "                continuity_errors: %zu\n", addr.continuity_errors);
+        fprintf(fd, "                bitrate_kbps: %.1f\n", pkt.bitrate(addr.bytes));
+        fprintf(fd, "                useful_bitrate_kbps: %.1f\n",
+                pkt.bitrate(addr.useful_bytes));
+        fprintf(fd, "                data_groups: %zu\n", addr.data_groups);
+        fprintf(fd, "                data_group_crc_errors: %zu\n",
+                addr.data_group_crc_errors);
+        fprintf(fd, "                incomplete_data_groups: %zu\n",
+                addr.incomplete_data_groups);
+        if (addr.mot_found) {
+            fprintf(fd, "                mot:\n");
+            mot_to_yaml(fd, "                    ", addr.mot);
+        }
+    }
+}
+
+// Use of the subchannel capacity, in percent
+static void utilisation_to_yaml(FILE *fd, const utilisation_statistics_t& util)
+{
+    const auto& total = util.total;
+    fprintf(fd, "      utilisation:\n");
+    fprintf(fd, "          capacity_kbps: %.1f\n", util.capacity_kbps());
+    fprintf(fd, "          payload: %.1f\n", total.percent(total.payload));
+    fprintf(fd, "          pad: %.1f\n", total.percent(total.pad));
+    fprintf(fd, "          padding: %.1f\n", total.percent(total.padding));
+    fprintf(fd, "          overhead: %.1f\n", total.percent(total.overhead));
+    fprintf(fd, "          unknown: %.1f\n", total.percent(total.unknown));
+    fprintf(fd, "          intervals: %zu\n", util.num_intervals);
+    if (util.num_intervals > 0) {
+        fprintf(fd, "          interval_payload_min: %.1f\n",
+                util.min_interval_payload_percent);
+        fprintf(fd, "          interval_payload_max: %.1f\n",
+                util.max_interval_payload_percent);
+    }
+}
+
+static void superframes_to_yaml(FILE *fd,
+        const superframe_sync_statistics_t& sync)
+{
+    fprintf(fd, "      superframes:\n");
+    fprintf(fd, "          decoded: %zu\n", sync.superframes_decoded);
+    fprintf(fd, "          skipped: %zu\n", sync.superframes_skipped);
+    fprintf(fd, "          rs_corrected_bytes: %zu\n", sync.rs_corrected_bytes);
+    fprintf(fd, "          rs_uncorrectable: %zu\n", sync.rs_uncorrectable);
+    fprintf(fd, "          aus: %zu\n", sync.aus);
+    fprintf(fd, "          au_crc_errors: %zu\n", sync.au_crc_errors);
+    fprintf(fd, "          locks: %zu\n", sync.num_locks);
+    fprintf(fd, "          unlocks: %zu\n", sync.num_unlocks);
+    if (sync.num_locks > 0) {
+        fprintf(fd, "          time_to_lock_ms: %.0f\n",
+                sync.time_to_first_lock_ms);
+    }
+    else {
+        fprintf(fd, "          time_to_lock_ms: null\n");
+    }
+}
+
+static void events_to_yaml(FILE *fd, const audio_events_statistics_t& events)
+{
+    fprintf(fd, "      events:\n");
+    for (size_t ix = 0; ix < num_audio_events; ix++) {
+        const auto& ev = events[ix];
+        fprintf(fd, "          %s:\n", audio_event_to_string((audio_event_e)ix));
+        fprintf(fd, "              events: %zu\n", ev.events);
+        fprintf(fd, "              duration: %.3f\n", ev.frames * 0.024);
+        fprintf(fd, "              active: %s\n", ev.active ? "true" : "false");
+        fprintf(fd, "              occurrences: %zu\n", ev.occurrences);
+    }
+}
+
+bool ETI_Analyser::analyse()
+{
+    // Without the database, the output could not be attributed
+    if (not load_snapshot()) {
+        return false;
+    }
+
     if (config.etifd != nullptr) {
-        return eti_analyse();
+        eti_analyse();
     }
     else if (config.ficfd != nullptr) {
-        return fic_analyse();
+        fic_analyse();
+    }
+    return true;
+}
+
+bool ETI_Analyser::load_snapshot()
+{
+    if (not config.load_snapshot_filename.empty()) {
+        return snapshot_load(config.load_snapshot_filename, ensemble);
+    }
+    return true;
+}
+
+void ETI_Analyser::save_snapshot()
+{
+    if (not config.save_snapshot_filename.empty()) {
+        snapshot_save(config.save_snapshot_filename, ensemble);
     }
 }
 
@@ -147,6 +337,74 @@ void ETI_Analyser::eti_analyse()
         }
     }
 
+    for (auto& el : config.streams_to_decode) {
+        el.second.enable_raw_pcm_output(config.raw_pcm_output);
+        el.second.enable_integrity_only(config.integrity_only);
+        el.second.set_mot_dump_directory(config.mot_dump_directory);
+    }
+
+    FILE *loudness_series_fd = nullptr;
+    if (not config.loudness_series_filename.empty()) {
+        loudness_series_fd = fopen(config.loudness_series_filename.c_str(), "w");
+        if (loudness_series_fd == nullptr) {
+            fprintf(stderr, "Could not open loudness series file: %s\n",
+                    strerror(errno));
+            if (stat_fd) {
+                fclose(stat_fd);
+            }
+            return;
+        }
+        fprintf(loudness_series_fd,
+                "subchannel,time,momentary,short_term,integrated,true_peak\n");
+
+        for (auto& el : config.streams_to_decode) {
+            el.second.set_loudness_series_file(loudness_series_fd);
+        }
+    }
+
+    FILE *events_fd = nullptr;
+    if (not config.events_filename.empty()) {
+        events_fd = fopen(config.events_filename.c_str(), "w");
+        if (events_fd == nullptr) {
+            fprintf(stderr, "Could not open events file: %s\n",
+                    strerror(errno));
+            if (loudness_series_fd) {
+                fclose(loudness_series_fd);
+            }
+            if (stat_fd) {
+                fclose(stat_fd);
+            }
+            return;
+        }
+        fprintf(events_fd,
+                "subchannel,event,state,frame,tist,duration,occurrences\n");
+
+        for (auto& el : config.streams_to_decode) {
+            el.second.set_events_file(events_fd);
+        }
+    }
+
+    unique_ptr<StreamDump> stream_dump;
+    for (const auto& el : config.streams_to_decode) {
+        if (el.second.dump_to_file()) {
+            stream_dump = make_unique<StreamDump>(config.stream_dump);
+            break;
+        }
+    }
+
+    // In statistics mode, the subchannels are decoded in parallel
+    unique_ptr<DecoderPool> decoder_pool;
+    if (config.statistics) {
+        size_t num_threads = config.num_decode_threads;
+        if (config.num_decode_threads < 0) {
+            num_threads = thread::hardware_concurrency();
+        }
+
+        if (num_threads > 0) {
+            decoder_pool = make_unique<DecoderPool>(num_threads);
+        }
+    }
+
     while (running) {
 
         int ret = get_eti_frame(config.etifd, stream_type, p);
@@ -389,10 +647,20 @@ void ETI_Analyser::eti_analyse()
                 config.streams_to_decode.emplace(std::piecewise_construct,
                         std::make_tuple(scid),
                         std::make_tuple(scid, false)); // do not dump to file
+                config.streams_to_decode.at(scid).set_loudness_series_file(
+                        loudness_series_fd);
+                config.streams_to_decode.at(scid).set_mot_dump_directory(
+                        config.mot_dump_directory);
+                config.streams_to_decode.at(scid).set_events_file(events_fd);
+                config.streams_to_decode.at(scid).enable_integrity_only(
+                        config.integrity_only);
             }
 
             if (config.streams_to_decode.count(scid) > 0) {
-                config.streams_to_decode.at(scid).set_subchannel_index(stl[i]/3);
+                if (not decoder_pool) {
+                    // Otherwise set by the worker
+                    config.streams_to_decode.at(scid).set_subchannel_index(stl[i]/3);
+                }
                 config.streams_to_decode.at(scid).stream_index = i;
             }
         }
@@ -484,6 +752,17 @@ void ETI_Analyser::eti_analyse()
             }
         }
 
+        // The TIST that follows the stream data is given to the decoders
+        size_t stream_data_len = 0;
+        for (int i=0; i < nst; i++) {
+            stream_data_len += stl[i] * 8;
+        }
+        const size_t tist_ix = 12 + 4*nst + ficf*ficl*4 + stream_data_len + 4;
+        uint32_t TIST = (uint32_t)(p[tist_ix]) << 24 |
+                        (uint32_t)(p[tist_ix+1]) << 16 |
+                        (uint32_t)(p[tist_ix+2]) << 8 |
+                        (uint32_t)(p[tist_ix+3]);
+
         printvalue("Stream Data", 1);
         int offset = 0;
         for (int i=0; i < nst; i++) {
@@ -506,7 +785,20 @@ void ETI_Analyser::eti_analyse()
             printbuf("Data", 3, streamdata, stl[i]*8);
 
             if (subchid != -1) {
-                config.streams_to_decode.at(subchid).push(streamdata, stl[i]*8);
+                auto& snoop = config.streams_to_decode.at(subchid);
+                if (stream_dump and snoop.dump_to_file()) {
+                    stream_dump->set_ensemble_id(ensemble.EId);
+                    stream_dump->push(subchid, fct, streamdata, stl[i]*8);
+                }
+
+                if (decoder_pool) {
+                    decoder_pool->push(snoop, stl[i]/3, num_frames, TIST,
+                            streamdata, stl[i]*8);
+                }
+                else {
+                    snoop.set_frame(num_frames, TIST);
+                    snoop.push(streamdata, stl[i]*8);
+                }
             }
         }
 
@@ -532,17 +824,14 @@ void ETI_Analyser::eti_analyse()
         printbuf("RFU", 2, p + 12 + 4*nst + ficf*ficl*4 + offset + 2, 2);
 
         //* TIST (4 Bytes)
-        const size_t tist_ix = 12 + 4*nst + ficf*ficl*4 + offset + 4;
-        uint32_t TIST = (uint32_t)(p[tist_ix]) << 24 |
-                        (uint32_t)(p[tist_ix+1]) << 16 |
-                        (uint32_t)(p[tist_ix+2]) << 8 |
-                        (uint32_t)(p[tist_ix+3]);
-
         sprintf(sdesc, "%f", (TIST & 0xFFFFFF) / 16384.0);
         printbuf("TIST", 1, p + tist_ix, 4, "Time Stamp (ms)", sdesc);
 
         if (config.analyse_fig_rates and (fct % 250) == 0) {
             rate_display_analysis(config.analyse_fig_rates_per_second);
+            if (config.analyse_fig_rate_windows) {
+                rate_display_windows(config.analyse_fig_rates_per_second);
+            }
         }
 
         num_frames++;
@@ -555,6 +844,22 @@ void ETI_Analyser::eti_analyse()
         if (quit.load()) running = false;
     }
 
+    if (decoder_pool) {
+        decoder_pool->finish();
+    }
+
+    if (stream_dump) {
+        stream_dump->finish();
+    }
+
+    if (loudness_series_fd) {
+        fclose(loudness_series_fd);
+    }
+
+    if (events_fd) {
+        fclose(events_fd);
+    }
+
     if (config.statistics) {
         assert(stat_fd != nullptr);
 
@@ -622,14 +927,125 @@ void ETI_Analyser::eti_analyse()
                 fprintf(stat_fd, "    - service_id: unknown\n");
             }
 
+            const auto format = snoop.second.get_format();
+            switch (format) {
+                case audio_format_e::UNKNOWN:
+                    fprintf(stat_fd, "      format: unknown\n");
+                    break;
+                case audio_format_e::DABPLUS:
+                    fprintf(stat_fd, "      format: dab+\n");
+                    break;
+                case audio_format_e::MP2:
+                    fprintf(stat_fd, "      format: mp2\n");
+                    break;
+                case audio_format_e::PACKET:
+                    fprintf(stat_fd, "      format: packet\n");
+                    break;
+            }
+
+            utilisation_to_yaml(stat_fd, snoop.second.get_utilisation_statistics());
+
+            if (format == audio_format_e::PACKET) {
+                packet_to_yaml(stat_fd, ensemble, snoop.first,
+                        snoop.second.get_packet_statistics());
+                continue;
+            }
+
+            if (format == audio_format_e::DABPLUS and config.integrity_only) {
+                // Neither the audio nor the PAD has been decoded
+                superframes_to_yaml(stat_fd, snoop.second.get_sync_statistics());
+                events_to_yaml(stat_fd, snoop.second.get_event_statistics());
+                continue;
+            }
+
+            // For MP2, the levels are estimated from the scale factors
             const auto& stat = snoop.second.get_audio_statistics();
             fprintf(stat_fd, "      audio:\n");
             fprintf(stat_fd, "          average: %d %d\n",
-                    absolute_to_dB(stat.average_level_left),
-                    absolute_to_dB(stat.average_level_right));
+                    absolute_to_dB(stat.total.left.mean_abs()),
+                    absolute_to_dB(stat.total.right.mean_abs()));
             fprintf(stat_fd, "          peak: %d %d\n",
-                    absolute_to_dB(stat.peak_level_left),
-                    absolute_to_dB(stat.peak_level_right));
+                    absolute_to_dB(stat.total.left.peak),
+                    absolute_to_dB(stat.total.right.peak));
+            fprintf(stat_fd, "          rms: %d %d\n",
+                    absolute_to_dB(stat.total.left.rms()),
+                    absolute_to_dB(stat.total.right.rms()));
+            fprintf(stat_fd, "          clipped: %" PRIu64 " %" PRIu64 "\n",
+                    stat.total.left.num_clipped,
+                    stat.total.right.num_clipped);
+            fprintf(stat_fd, "          intervals: %zu\n", stat.num_intervals);
+            if (stat.num_intervals > 0) {
+                fprintf(stat_fd, "          interval_rms_min: %d %d\n",
+                        absolute_to_dB(stat.min_interval_rms_left),
+                        absolute_to_dB(stat.min_interval_rms_right));
+                fprintf(stat_fd, "          interval_rms_max: %d %d\n",
+                        absolute_to_dB(stat.max_interval_rms_left),
+                        absolute_to_dB(stat.max_interval_rms_right));
+            }
+
+            const auto& loudness = stat.loudness;
+            fprintf(stat_fd, "      loudness:\n");
+            fprintf(stat_fd, "          integrated: %s\n",
+                    loudness_to_yaml(loudness.integrated).c_str());
+            fprintf(stat_fd, "          range: %.1f\n", loudness.range);
+            fprintf(stat_fd, "          momentary_max: %s\n",
+                    loudness_to_yaml(loudness.max_momentary).c_str());
+            fprintf(stat_fd, "          short_term_max: %s\n",
+                    loudness_to_yaml(loudness.max_short_term).c_str());
+            fprintf(stat_fd, "          true_peak: %s\n",
+                    loudness_to_yaml(loudness.true_peak).c_str());
+
+            if (format == audio_format_e::MP2) {
+                const auto& mp2 = snoop.second.get_mp2_statistics();
+                fprintf(stat_fd, "      mp2:\n");
+                fprintf(stat_fd, "          bitrate: %d\n", mp2.last_header.bitrate);
+                fprintf(stat_fd, "          sample_rate: %d\n", mp2.last_header.sample_rate);
+                fprintf(stat_fd, "          mode: %s\n",
+                        mp2_mode_to_string(mp2.last_header.mode));
+                fprintf(stat_fd, "          frames: %zu\n", mp2.frames);
+                fprintf(stat_fd, "          crc_errors: %zu\n", mp2.crc_errors);
+                fprintf(stat_fd, "          silent_frames: %zu\n", mp2.silent_frames);
+                fprintf(stat_fd, "          sync_losses: %zu\n", mp2.sync_losses);
+            }
+            else {
+                superframes_to_yaml(stat_fd, snoop.second.get_sync_statistics());
+            }
+
+            events_to_yaml(stat_fd, snoop.second.get_event_statistics());
+
+            const auto& pad = snoop.second.get_pad_statistics();
+            fprintf(stat_fd, "      pad:\n");
+            fprintf(stat_fd, "          pads: %zu\n", pad.pads);
+            fprintf(stat_fd, "          xpads: %zu\n", pad.xpads);
+            string xpad_bytes;
+            for (size_t appty = 0; appty < pad.xpad_bytes.size(); appty++) {
+                if (pad.xpad_bytes[appty] > 0) {
+                    xpad_bytes += strprintf("%s%zu: %zu",
+                            xpad_bytes.empty() ? "" : ", ",
+                            appty, pad.xpad_bytes[appty]);
+                }
+            }
+            fprintf(stat_fd, "          xpad_bytes: {%s}\n", xpad_bytes.c_str());
+            fprintf(stat_fd, "          dl_data_groups: %zu\n", pad.dl_data_groups);
+            fprintf(stat_fd, "          dl_crc_errors: %zu\n", pad.dl_crc_errors);
+            fprintf(stat_fd, "          dls_changes: %zu\n", pad.dl_changes);
+            fprintf(stat_fd, "          dls: %s\n",
+                    string_to_yaml(pad.label.text).c_str());
+            fprintf(stat_fd, "          dl_plus_changes: %zu\n", pad.dl_plus_changes);
+            if (pad.label.tags.empty()) {
+                fprintf(stat_fd, "          dl_plus: []\n");
+            }
+            else {
+                fprintf(stat_fd, "          dl_plus:\n");
+                for (const auto& tag : pad.label.tags) {
+                    fprintf(stat_fd, "              - %s: %s\n",
+                            dl_plus_content_type_to_string(tag.content_type),
+                            string_to_yaml(tag.text).c_str());
+                }
+            }
+            fprintf(stat_fd, "          dgli_crc_errors: %zu\n", pad.dgli_crc_errors);
+            fprintf(stat_fd, "          mot:\n");
+            mot_to_yaml(stat_fd, "              ", pad.mot);
         }
 
         fclose(stat_fd);
@@ -643,8 +1059,10 @@ void ETI_Analyser::eti_analyse()
 
     if (config.analyse_fig_rates) {
         rate_display_analysis(config.analyse_fig_rates_per_second);
+        rate_display_jitter(config.analyse_fig_rates_per_second);
     }
 
+    save_snapshot();
     figs_cleardb();
 }
 
@@ -724,6 +1142,8 @@ void ETI_Analyser::fic_analyse()
 
         i = (i+1) % 3;
     }
+
+    save_snapshot();
 }
 
 void ETI_Analyser::decodeFIG(
@@ -41,6 +41,7 @@
 #include "repetitionrate.hpp"
 #include "figalyser.hpp"
 #include "ensembledatabase.hpp"
+#include "streamdump.hpp"
 
 extern std::atomic<bool> quit;
 
@@ -53,10 +54,20 @@ struct eti_analyse_config_t {
     bool analyse_fic_carousel = false;
     bool analyse_fig_rates = false;
     bool analyse_fig_rates_per_second = false;
+    bool analyse_fig_rate_windows = false;
     bool decode_watermark = false;
     bool statistics = false;
     std::string statistics_filename;
+    int num_decode_threads = -1; // in statistics mode, -1 means one per CPU
+    bool integrity_only = false; // DAB+ subchannels are not decoded
+    std::string loudness_series_filename;
+    bool raw_pcm_output = false; // stream-N.pcm instead of stream-N.wav
+    std::string mot_dump_directory; // empty if MOT objects are not written
+    std::string events_filename; // empty if audio events are only printed
+    stream_dump_config_t stream_dump; // of the subchannels given with -d
     size_t num_frames_to_decode = 0; // 0 means forever
+    std::string load_snapshot_filename;
+    std::string save_snapshot_filename;
 
     bool is_fig_to_be_printed(int type, int extension) const;
 };
@@ -68,12 +79,16 @@ class ETI_Analyser {
             ensemble(),
             wm_decoder() {}
 
-        void analyse(void);
+        // Returns false if the analysis could not be started
+        bool analyse(void);
 
     private:
         void eti_analyse(void);
         void fic_analyse(void);
 
+        bool load_snapshot(void);
+        void save_snapshot(void);
+
         void decodeFIG(
                 const eti_analyse_config_t &config,
                 FIGalyser &figs,
@@ -68,14 +68,27 @@ static void handle_signal(int)
 const struct option longopts[] = {
     {"analyse-figs",       no_argument,        0, 'f'},
     {"decode-stream",      required_argument,  0, 'd'},
+    {"decode-threads",     required_argument,  0, 4},
+    {"dump-rotate-size",   required_argument,  0, 10},
+    {"dump-rotate-time",   required_argument,  0, 11},
+    {"dump-template",      required_argument,  0, 9},
+    {"events",             required_argument,  0, 8},
     {"filter-fig",         required_argument,  0, 'F'},
     {"help",               no_argument,        0, 'h'},
     {"ignore-error",       no_argument,        0, 'e'},
     {"input",              required_argument,  0, 'i'},
     {"input-fic",          required_argument,  0, 'I'},
+    {"integrity-only",     no_argument,        0, 12},
+    {"load-snapshot",      required_argument,  0, 1},
+    {"loudness-series",    required_argument,  0, 5},
+    {"mot-dump",           required_argument,  0, 7},
     {"num-frames",         required_argument,  0, 'n'},
+    {"rate-windows",       no_argument,        0, 3},
+    {"raw-pcm",            no_argument,        0, 6},
+    {"save-snapshot",      required_argument,  0, 2},
     {"statistics",         required_argument,  0, 's'},
     {"verbose",            no_argument,        0, 'v'},
+    {0,                    0,                  0, 0},
 };
 
 void usage(void)
@@ -97,17 +110,44 @@ void usage(void)
             "   -d N    write subchannel N into stream-N.dab\n"
             "           (superframes with RS coding)\n"
             "           if the suchannel contains DAB+ audio will be decoded to stream-N.wav\n"
+            "   --dump-template <template>\n"
+            "           with -d, write the subchannel data to files named after template instead,\n"
+            "           where {subchannel}, {ensemble}, {index} and strftime conversions get replaced\n"
+            "   --dump-rotate-size <MB>\n"
+            "   --dump-rotate-time <seconds>\n"
+            "           with -d, start a new file after that size or duration\n"
+            "   --raw-pcm\n"
+            "           with -d, write the audio as headerless 16-bit stereo to stream-N.pcm,\n"
+            "           which can be a named pipe\n"
             "   -s <filename.yaml>\n"
             "           statistics mode: decode all subchannels and measure audio level, write statistics to file\n"
+            "   --decode-threads N\n"
+            "           in statistics mode, decode the subchannels on N threads,\n"
+            "           default is one per CPU, 0 decodes on the main thread\n"
+            "   --integrity-only\n"
+            "           only check the Fire code, RS and AU CRCs of the DAB+ subchannels,\n"
+            "           without decoding the audio and the PAD\n"
+            "   --loudness-series <filename.csv>\n"
+            "           write the loudness of the decoded DAB+ subchannels every second to file\n"
+            "   --mot-dump <directory>\n"
+            "           write the MOT objects (slideshow images) of the decoded subchannels to directory\n"
+            "   --events <filename.csv>\n"
+            "           write the error and silence events of the decoded audio subchannels to file\n"
             "   -n N    stop analysing after N ETI frames\n"
             "   -f      analyse FIC carousel (no YAML output)\n"
             "   -r      analyse FIG rates in FIGs per second\n"
             "   -R      analyse FIG rates in frames per FIG\n"
+            "   --rate-windows\n"
+            "           with -r or -R, also print the rates over the last 10s, 1min and 1h\n"
             "   -w      decode CRC-DABMUX and ODR-DabMux watermark.\n"
             "   -e      decode frames with SYNC error and decode FIGs with invalid CRC\n"
             "   -F <type>/<ext>\n"
             "           add FIG type/ext to list of FIGs to display.\n"
             "           if the option is not given, all FIGs are displayed.\n"
+            "   --load-snapshot <filename>\n"
+            "           initialise the ensemble database from a snapshot file\n"
+            "   --save-snapshot <filename>\n"
+            "           save the ensemble database to a snapshot file at the end\n"
             "\n",
 #if defined(GITVERSION)
             GITVERSION,
@@ -199,6 +239,43 @@ int main(int argc, char *argv[])
             case 'w':
                 config.decode_watermark = true;
                 break;
+            case 1:
+                config.load_snapshot_filename = optarg;
+                break;
+            case 2:
+                config.save_snapshot_filename = optarg;
+                break;
+            case 3:
+                config.analyse_fig_rate_windows = true;
+                break;
+            case 4:
+                config.num_decode_threads = atoi(optarg);
+                break;
+            case 5:
+                config.loudness_series_filename = optarg;
+                break;
+            case 6:
+                config.raw_pcm_output = true;
+                break;
+            case 7:
+                config.mot_dump_directory = optarg;
+                break;
+            case 8:
+                config.events_filename = optarg;
+                break;
+            case 9:
+                config.stream_dump.filename_template = optarg;
+                break;
+            case 10:
+                config.stream_dump.rotate_size = std::atoi(optarg) * 1000000uL;
+                break;
+            case 11:
+                // 24ms ETI frames
+                config.stream_dump.rotate_frames = std::atoi(optarg) * 1000uL / 24;
+                break;
+            case 12:
+                config.integrity_only = true;
+                break;
             case -1:
                 break;
             default:
@@ -236,8 +313,12 @@ int main(int argc, char *argv[])
         }
 
         ETI_Analyser eti_analyser(config);
-        eti_analyser.analyse();
+        const bool success = eti_analyser.analyse();
         fclose(fd);
+
+        if (not success) {
+            return 1;
+        }
     }
     else {
         fprintf(stderr, "Must specify either -i or -I\n");
@@ -22,14 +22,15 @@
 */
 
 #include "faad_decoder.hpp"
-extern "C" {
-#include "wavfile.h"
-}
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <cassert>
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
 #include <string>
 #include <sstream>
 #include <vector>
@@ -38,43 +39,21 @@ using namespace std;
 
 FaadDecoder::FaadDecoder() :
     m_data_len(0),
-    m_fd(nullptr),
     m_initialised(false)
 {
 }
 
-FaadDecoder& FaadDecoder::operator=(FaadDecoder&& other)
-{
-    m_data_len = other.m_data_len;
-    m_fd = other.m_fd;
-    other.m_fd = nullptr;
-    m_initialised = other.m_initialised;
-    other.m_initialised = false;
-
-    return *this;
-}
-
-FaadDecoder::FaadDecoder(FaadDecoder&& other)
-{
-    m_data_len = other.m_data_len;
-    m_fd = other.m_fd;
-    other.m_fd = nullptr;
-    m_initialised = other.m_initialised;
-    other.m_initialised = false;
-}
-
 FaadDecoder::~FaadDecoder()
 {
-    if (m_fd) {
-        wavfile_close(m_fd);
-    }
 }
 
 
-void FaadDecoder::open(string filename, bool ps_flag, bool aac_channel_mode,
-        bool dac_rate, bool sbr_flag, int mpeg_surround_config)
+void FaadDecoder::open(string filename, bool raw_pcm, bool ps_flag,
+        bool aac_channel_mode, bool dac_rate, bool sbr_flag,
+        int mpeg_surround_config)
 {
     m_filename             = filename;
+    m_raw_pcm              = raw_pcm;
     m_ps_flag              = ps_flag;
     m_aac_channel_mode     = aac_channel_mode;
     m_dac_rate             = dac_rate;
@@ -82,11 +61,13 @@ void FaadDecoder::open(string filename, bool ps_flag, bool aac_channel_mode,
     m_mpeg_surround_config = mpeg_surround_config;
 }
 
-bool FaadDecoder::decode(vector<vector<uint8_t> > aus)
+bool FaadDecoder::decode(uint8_t *superframe, const vector<au_span_t>& aus)
 {
-    for (size_t au_ix = 0; au_ix < aus.size(); au_ix++) {
+    m_decoded_levels = audio_levels_t();
+    m_superframes++;
 
-        vector<uint8_t>& au = aus[au_ix];
+    for (size_t au_index = 0; au_index < aus.size(); au_index++) {
+        const auto& au = aus[au_index];
 
         NeAACDecFrameInfo hInfo;
         int16_t* outBuffer;
@@ -132,8 +113,13 @@ bool FaadDecoder::decode(vector<vector<uint8_t> > aus)
             m_initialised = true;
         }
 
-        outBuffer = (int16_t *)NeAACDecDecode(m_faad_handle.decoder, &hInfo, &au[0], au.size());
+        const auto decode_start = chrono::steady_clock::now();
+        outBuffer = (int16_t *)NeAACDecDecode(m_faad_handle.decoder, &hInfo,
+                superframe + au.offset, au.length);
         assert(outBuffer != nullptr);
+        update_aac_statistics(au_index, au.length, hInfo,
+                chrono::duration<double>(
+                    chrono::steady_clock::now() - decode_start).count());
 
         m_sample_rate = hInfo.samplerate;
         m_channels    = hInfo.channels;
@@ -153,10 +139,21 @@ bool FaadDecoder::decode(vector<vector<uint8_t> > aus)
             return false;
         }
 
-        if (m_fd == nullptr and not m_filename.empty()) {
-            stringstream ss;
-            ss << m_filename << ".wav";
-            m_fd = wavfile_open(ss.str().c_str(), m_sample_rate);
+        if (not m_pcm_sink and not m_filename.empty()) {
+            try {
+                if (m_raw_pcm) {
+                    m_pcm_sink.reset(new PcmFileSink(m_filename + ".pcm",
+                            pcm_file_format_e::RAW, m_sample_rate));
+                }
+                else {
+                    m_pcm_sink.reset(new PcmFileSink(m_filename + ".wav",
+                            pcm_file_format_e::WAV, m_sample_rate));
+                }
+            }
+            catch (const runtime_error& e) {
+                fprintf(stderr, "%s\n", e.what());
+                m_filename.clear();
+            }
         }
 
         if (samples) {
@@ -164,70 +161,153 @@ bool FaadDecoder::decode(vector<vector<uint8_t> > aus)
                 fprintf(stderr, "Cannot handle %d channels\n", m_channels);
             }
 
-            m_stats.peak_level_left = 0;
-            m_stats.peak_level_right = 0;
+            if (m_channels == 1 or m_channels == 2) {
+                update_audio_statistics(outBuffer, samples);
 
-            if (m_channels == 1) {
-                int32_t sum_ampl = 0;
-                for (size_t i = 0; i < samples; i ++) {
-                    const int16_t ampl = abs(outBuffer[i]);
-                    if (m_stats.peak_level_left < ampl) {
-                        m_stats.peak_level_left = ampl;
-                    }
+                if (m_loudness.sample_rate() != m_sample_rate) {
+                    m_loudness.configure(m_sample_rate, m_channels);
+                    m_loudness_series_next = loudness_series_interval_ms / 1000.0;
+                }
+                else if (m_loudness.channels() != m_channels) {
+                    // Switching between mono and stereo keeps the measurements
+                    m_loudness.set_channels(m_channels);
+                }
+                m_loudness.process(outBuffer, samples);
 
-                    sum_ampl += ampl;
+                if (m_loudness_series_fd) {
+                    write_loudness_series();
                 }
-                m_stats.average_level_left = sum_ampl / samples;
             }
-            else if (m_channels == 2) {
-                assert((samples % 2) == 0);
 
-                int32_t sum_left = 0;
-                int32_t sum_right = 0;
+            if (m_pcm_sink and (m_channels == 1 or m_channels == 2)) {
+                m_pcm_sink->write(outBuffer, samples / m_channels, m_channels);
+            }
+        }
 
-                for (size_t i = 0; i < samples; i += 2) {
-                    const int16_t ampl_left = abs(outBuffer[i]);
-                    if (m_stats.peak_level_left < ampl_left) {
-                        m_stats.peak_level_left = ampl_left;
-                    }
+    }
+    return true;
+}
 
-                    sum_left += ampl_left;
+void FaadDecoder::update_audio_statistics(
+        const int16_t *samples, size_t num_samples)
+{
+    audio_levels_t levels;
+    audio_levels_accumulate(levels, samples, num_samples, m_channels);
+    m_decoded_levels.add(levels);
+    m_interval_levels.add(levels);
+
+    const uint64_t interval_len =
+        (uint64_t)m_sample_rate * audio_statistics_interval_ms / 1000;
+
+    if (m_interval_levels.left.num_samples >= interval_len) {
+        const double rms_left = m_interval_levels.left.rms();
+        const double rms_right = m_interval_levels.right.rms();
+
+        if (m_stats.num_intervals == 0) {
+            m_stats.min_interval_rms_left = rms_left;
+            m_stats.min_interval_rms_right = rms_right;
+            m_stats.max_interval_rms_left = rms_left;
+            m_stats.max_interval_rms_right = rms_right;
+        }
+        else {
+            m_stats.min_interval_rms_left = std::min(m_stats.min_interval_rms_left, rms_left);
+            m_stats.min_interval_rms_right = std::min(m_stats.min_interval_rms_right, rms_right);
+            m_stats.max_interval_rms_left = std::max(m_stats.max_interval_rms_left, rms_left);
+            m_stats.max_interval_rms_right = std::max(m_stats.max_interval_rms_right, rms_right);
+        }
 
-                    const int16_t ampl_right = abs(outBuffer[i+1]);
-                    if (m_stats.peak_level_right < ampl_right) {
-                        m_stats.peak_level_right = ampl_right;
-                    }
+        m_stats.total.add(m_interval_levels);
+        m_stats.last_interval = m_interval_levels;
+        m_stats.num_intervals++;
+        m_interval_levels = audio_levels_t();
+    }
+}
 
-                    sum_right += ampl_right;
-                }
+void FaadDecoder::update_aac_statistics(size_t au_index, size_t au_length,
+        const NeAACDecFrameInfo& info, double decode_seconds)
+{
+    auto& st = m_aac_stats;
 
-                m_stats.average_level_left = sum_left / samples;
-                m_stats.average_level_right = sum_right / samples;
-            }
+    if (st.aus == 0 or au_length < st.min_au_size) {
+        st.min_au_size = au_length;
+    }
+    st.max_au_size = std::max(st.max_au_size, au_length);
+    st.au_bytes += au_length;
+    st.au_sizes[std::min(au_length / au_size_bucket_bytes,
+            num_au_size_buckets - 1)]++;
 
-            if (m_fd) {
-                if (m_channels == 1) {
-                    vector<int16_t> buffer(2*samples);
-                    for (size_t i = 0; i < samples; i ++) {
-                        buffer [2 * i]  = ((int16_t *)outBuffer) [i];
-                        buffer [2 * i + 1] = buffer [2 * i];
-                    }
+    st.decode_seconds += decode_seconds;
+    st.max_decode_seconds = std::max(st.max_decode_seconds, decode_seconds);
 
-                    wavfile_write(m_fd, buffer.data(), 2*samples);
-                }
-                else if (m_channels == 2) {
-                    wavfile_write(m_fd, outBuffer, samples);
-                }
-            }
+    if (info.error != 0) {
+        st.errors++;
+    }
+    else {
+        if (info.sbr == SBR_UPSAMPLED or info.sbr == SBR_DOWNSAMPLED) {
+            st.sbr_aus++;
+        }
+        if (info.ps) {
+            st.ps_aus++;
+        }
+        if (m_last_au_channels != 0 and info.channels != m_last_au_channels) {
+            st.channel_changes++;
         }
+        m_last_au_channels = info.channels;
+    }
 
+    if (info.bytesconsumed != au_length) {
+        st.consumption_mismatches++;
+    }
+    st.aus++;
+
+    if (m_au_statistics_fd) {
+        fprintf(m_au_statistics_fd, "%zu,%zu,%zu,%lu,%lu,%d,%lu,%d,%d,%d,%.1f\n",
+                m_superframes - 1, au_index, au_length, info.bytesconsumed,
+                info.samples, info.channels, info.samplerate, info.sbr,
+                info.ps, info.error, decode_seconds * 1e6);
     }
-    return true;
 }
 
 audio_statistics_t FaadDecoder::get_audio_statistics(void) const
 {
-    return m_stats;
+    // Include the audio of the interval in progress in the total
+    audio_statistics_t stats = m_stats;
+    stats.total.add(m_interval_levels);
+    stats.loudness = m_loudness.get_statistics();
+    return stats;
+}
+
+void FaadDecoder::set_loudness_series_file(FILE *fd, int label)
+{
+    m_loudness_series_fd = fd;
+    m_loudness_series_label = label;
+}
+
+// Empty CSV field for -infinity
+static string loudness_to_csv(double value)
+{
+    char s[16] = "";
+    if (std::isfinite(value)) {
+        snprintf(s, sizeof(s), "%.1f", value);
+    }
+    return s;
+}
+
+void FaadDecoder::write_loudness_series()
+{
+    const double t = m_loudness.duration();
+    if (t < m_loudness_series_next) {
+        return;
+    }
+    m_loudness_series_next = t + loudness_series_interval_ms / 1000.0;
+
+    // A single call, because the decoders of several threads share the file
+    fprintf(m_loudness_series_fd, "%d,%.1f,%s,%s,%s,%s\n",
+            m_loudness_series_label, t,
+            loudness_to_csv(m_loudness.momentary()).c_str(),
+            loudness_to_csv(m_loudness.short_term()).c_str(),
+            loudness_to_csv(m_loudness.integrated()).c_str(),
+            loudness_to_csv(m_loudness.take_interval_true_peak()).c_str());
 }
 
 int FaadDecoder::get_aac_channel_configuration()
@@ -28,7 +28,11 @@
 #include <string>
 #include <sstream>
 #include <vector>
+#include <memory>
 #include <neaacdec.h>
+#include "audiolevels.hpp"
+#include "loudness.hpp"
+#include "pcmsink.hpp"
 
 #ifndef __FAAD_DECODER_H_
 #define __FAAD_DECODER_H_
@@ -61,41 +65,131 @@ class FaadHandle
         NeAACDecHandle decoder;
 };
 
+// Position of an AU inside a superframe, without its CRC
+struct au_span_t {
+    size_t offset = 0;
+    size_t length = 0;
+};
+
 struct audio_statistics_t {
-    int16_t average_level_left;
-    int16_t average_level_right;
+    // Whole run
+    audio_levels_t total;
+
+    /* The audio is also split in intervals of audio_statistics_interval_ms.
+     * The last complete interval, and the RMS levels of the quietest and of
+     * the loudest intervals are kept. */
+    audio_levels_t last_interval;
+    size_t num_intervals = 0;
+
+    double min_interval_rms_left = 0;
+    double min_interval_rms_right = 0;
+    double max_interval_rms_left = 0;
+    double max_interval_rms_right = 0;
+
+    loudness_statistics_t loudness;
+};
+
+const int audio_statistics_interval_ms = 1000;
+
+// AU sizes are counted in buckets of this many bytes
+const size_t au_size_bucket_bytes = 64;
+const size_t num_au_size_buckets = 32; // The last one also counts larger AUs
+
+// Properties of the AAC bitstream, collected over all AUs
+struct aac_statistics_t {
+    size_t aus = 0;
+    size_t errors = 0;
+
+    uint64_t au_bytes = 0;
+    size_t min_au_size = 0;
+    size_t max_au_size = 0;
+    size_t au_sizes[num_au_size_buckets] = {};
 
-    int16_t peak_level_left;
-    int16_t peak_level_right;
+    size_t sbr_aus = 0;
+    size_t ps_aus = 0;
+
+    // AUs that have a different number of channels than the previous one
+    size_t channel_changes = 0;
+
+    // AUs of which the decoder did not consume exactly all bytes
+    size_t consumption_mismatches = 0;
+
+    double decode_seconds = 0;
+    double max_decode_seconds = 0;
 };
 
+// Interval of the lines of the loudness time series
+const int loudness_series_interval_ms = 1000;
+
 class FaadDecoder
 {
     public:
         FaadDecoder();
         ~FaadDecoder();
-        FaadDecoder& operator=(FaadDecoder&& other);
-        FaadDecoder(FaadDecoder&& other);
+
+        /* Not movable, the decoder handle, the sink and the statistics
+         * belong together */
+        FaadDecoder(FaadDecoder&&) = delete;
+        FaadDecoder& operator=(FaadDecoder&&) = delete;
         FaadDecoder(const FaadDecoder&) = delete;
         FaadDecoder& operator=(const FaadDecoder&) = delete;
 
-        void open(std::string filename, bool ps_flag, bool aac_channel_mode,
-                bool dac_rate, bool sbr_flag, int mpeg_surround_config);
+        /* Audio is written to filename.wav, or to filename.pcm without
+         * header if raw_pcm is set, unless filename is empty */
+        void open(std::string filename, bool raw_pcm, bool ps_flag,
+                bool aac_channel_mode, bool dac_rate, bool sbr_flag,
+                int mpeg_surround_config);
 
-        bool decode(std::vector<std::vector<uint8_t> > aus);
+        /* Decode the AUs, which are referenced inside the superframe
+         * and are not copied */
+        bool decode(uint8_t *superframe, const std::vector<au_span_t>& aus);
+
+        // Levels of the audio decoded by the last call to decode()
+        const audio_levels_t& get_decoded_levels(void) const {
+            return m_decoded_levels;
+        }
 
         bool is_initialised(void) { return m_initialised; }
 
         audio_statistics_t get_audio_statistics(void) const;
 
+        /* Write the loudness as CSV lines to fd every
+         * loudness_series_interval_ms, prefixed by label */
+        void set_loudness_series_file(FILE *fd, int label);
+
+        aac_statistics_t get_aac_statistics(void) const { return m_aac_stats; }
+
+        /* Write one CSV line per AU to fd, with the columns superframe,
+         * au, size, consumed, samples, channels, sample_rate, sbr, ps,
+         * error and decode_us. superframe counts the calls to decode() */
+        void set_au_statistics_file(FILE *fd) { m_au_statistics_fd = fd; }
+
     private:
         int get_aac_channel_configuration();
+        void update_audio_statistics(const int16_t *samples, size_t num_samples);
         size_t m_data_len;
 
+        // Complete intervals only
         audio_statistics_t m_stats;
+        audio_levels_t m_interval_levels;
+        audio_levels_t m_decoded_levels;
+
+        aac_statistics_t m_aac_stats;
+        FILE* m_au_statistics_fd = nullptr;
+        size_t m_superframes = 0; // Calls to decode()
+        int m_last_au_channels = 0;
+        void update_aac_statistics(size_t au_index, size_t au_length,
+                const NeAACDecFrameInfo& info, double decode_seconds);
+
+        LoudnessMeter m_loudness;
+        FILE* m_loudness_series_fd = nullptr;
+        int m_loudness_series_label = 0;
+        double m_loudness_series_next = 0; // seconds
+        void write_loudness_series(void);
 
         std::string m_filename;
-        FILE* m_fd;
+        bool m_raw_pcm = false;
+        std::unique_ptr<PcmSink> m_pcm_sink;
 
         /* Data needed for FAAD */
         bool m_ps_flag;
@@ -25,6 +25,7 @@
 #ifdef HAVE_CONFIG_H
 #  include "config.h"
 #endif
+#include <algorithm>
 #include <cstdio>
 #include <cstdint>
 #include <cstdlib>
@@ -32,20 +33,292 @@
 #include <string>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
 #include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 extern "C" {
+#include "firecode.h"
 #include "lib_crc.h"
 }
 #include "dabplussnoop.hpp"
 
 using namespace std;
 
+// Data at the start of the file used to detect the bitrate
+static const size_t probe_size = 32 * 1024;
+
+// Superframe headers needed at the right distance to consider a bitrate
+static const size_t probe_superframes = 4;
+
 static void usage(void)
 {
     cerr << "\nUsage:\n"
+        "faadalyse [options] <file.dabp>...\n"
         "faadalyse <file.dabp> <bitrate>\n"
-        "  The bitrate of the file must be given separately\n";
+        "  -a       write the properties of every AU of file.dabp to\n"
+        "           file.csv in the output directory\n"
+        "  -b N     the bitrate of all files in kbps, detected if not given\n"
+        "  -j N     decode N files in parallel, default is one per CPU\n"
+        "  -o DIR   write the audio of file.dabp to DIR/file.wav, default is\n"
+        "           the current directory\n";
+}
+
+/* The contents of a file, mapped into memory. Files that cannot be
+ * mapped, like pipes, are read instead. */
+class InputFile {
+    public:
+        InputFile(const string& filename)
+        {
+            const int fd = open(filename.c_str(), O_RDONLY);
+            if (fd == -1) {
+                return;
+            }
+
+            struct stat st;
+            if (fstat(fd, &st) == 0 and S_ISREG(st.st_mode) and st.st_size > 0) {
+                void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (map != MAP_FAILED) {
+                    madvise(map, st.st_size, MADV_SEQUENTIAL);
+                    m_map = (uint8_t*)map;
+                    m_size = st.st_size;
+                }
+            }
+
+            if (m_map == nullptr) {
+                uint8_t buf[65536];
+                ssize_t r;
+                while ((r = read(fd, buf, sizeof(buf))) > 0) {
+                    m_buffer.insert(m_buffer.end(), buf, buf + r);
+                }
+                m_size = m_buffer.size();
+            }
+
+            close(fd);
+            m_valid = true;
+        }
+
+        ~InputFile()
+        {
+            if (m_map) {
+                munmap(m_map, m_size);
+            }
+        }
+
+        InputFile(const InputFile& other) = delete;
+        InputFile& operator=(const InputFile& other) = delete;
+
+        bool valid(void) const { return m_valid; }
+
+        // DabPlusSnoop only reads the data
+        uint8_t* data(void) { return m_map ? m_map : m_buffer.data(); }
+        size_t size(void) const { return m_size; }
+
+    private:
+        bool m_valid = false;
+        uint8_t *m_map = nullptr;
+        vector<uint8_t> m_buffer;
+        size_t m_size = 0;
+};
+
+/* Find the subchannel index of the DAB+ superframes in probe, 0 if none
+ * fits. The firecode is checked once at every position, then each index
+ * from 1 to 24 (8 to 192kbps) is considered if probe_superframes headers
+ * follow each other at its superframe length. The smallest of these
+ * indices whose superframes also pass the RS decoder and the AU CRCs wins,
+ * larger ones can be multiples of the right one. */
+static int detect_subchannel_index(vector<uint8_t>& probe)
+{
+    // Same plausibility check as the superframe search of DabPlusSnoop
+    vector<bool> header(probe.size());
+    for (size_t i = 0; i + 11 <= probe.size(); i++) {
+        uint8_t *b = &probe[i];
+        if (b[3] != 0x00 or (b[4] & 0xF0) != 0x00) {
+            header[i] = ((b[0] << 8) | b[1]) == firecode_crc(b + 2, 9);
+        }
+    }
+
+    for (int index = 1; index <= 24; index++) {
+        const size_t sf_len = index * 120;
+
+        bool candidate = false;
+        for (size_t start = 0; start < sf_len and not candidate; start++) {
+            size_t n = 0;
+            while (n < probe_superframes and
+                    start + n * sf_len < probe.size() and
+                    header[start + n * sf_len]) {
+                n++;
+            }
+            candidate = (n == probe_superframes);
+        }
+
+        if (not candidate) {
+            continue;
+        }
+
+        DabPlusSnoop snoop;
+        snoop.set_subchannel_index(index);
+        snoop.push(probe.data(), probe.size());
+        if (snoop.get_sync_statistics().superframes_decoded > 0) {
+            return index;
+        }
+    }
+
+    return 0;
+}
+
+struct file_result_t {
+    bool ok = false;
+    int bitrate = 0;
+    size_t bytes = 0;
+    superframe_sync_statistics_t sync;
+    aac_statistics_t aac;
+    double seconds = 0; // Processing time
+};
+
+// Messages of the workers are written in one piece
+static mutex output_mutex;
+
+static void print(const string& message)
+{
+    lock_guard<mutex> lock(output_mutex);
+    cerr << message;
+}
+
+// The audio of dir/name.dabp goes to output_dir/name
+static string output_basename(const string& fname, const string& output_dir)
+{
+    string name = fname.substr(fname.find_last_of('/') + 1);
+    const size_t dot = name.find_last_of('.');
+    if (dot != string::npos and dot > 0) {
+        name.resize(dot);
+    }
+    return output_dir + "/" + name;
+}
+
+static const char *au_statistics_header =
+    "superframe,au,size,consumed,samples,channels,sample_rate,sbr,ps,"
+    "error,decode_us\n";
+
+// The audio goes to basename.wav, the AU statistics to basename.csv
+static file_result_t analyse_file(const string& fname, int bitrate,
+        const string& basename, bool au_statistics)
+{
+    file_result_t result;
+    const auto start = chrono::steady_clock::now();
+
+    InputFile input(fname);
+    if (not input.valid()) {
+        print("Failed to open " + fname + "\n");
+        return result;
+    }
+    result.bytes = input.size();
+
+    if (bitrate == 0) {
+        vector<uint8_t> probe(input.data(),
+                input.data() + min(probe_size, input.size()));
+        bitrate = detect_subchannel_index(probe) * 8;
+        if (bitrate == 0) {
+            print("Could not detect the bitrate of " + fname + "\n");
+            return result;
+        }
+    }
+    result.bitrate = bitrate;
+
+    FILE *au_fd = nullptr;
+    if (au_statistics) {
+        const string csv_name = basename + ".csv";
+        au_fd = fopen(csv_name.c_str(), "w");
+        if (au_fd == nullptr) {
+            print("Failed to open " + csv_name + "\n");
+            return result;
+        }
+        fputs(au_statistics_header, au_fd);
+    }
+
+    {
+        // The audio file is complete once the snoop is destroyed
+        DabPlusSnoop snoop;
+        snoop.set_subchannel_index(bitrate / 8);
+        snoop.enable_wav_file_output(true);
+        snoop.set_output_basename(basename);
+        snoop.set_au_statistics_file(au_fd);
+
+        if (input.size() > 0) {
+            snoop.push(input.data(), input.size());
+        }
+        result.sync = snoop.get_sync_statistics();
+        result.aac = snoop.get_aac_statistics();
+    }
+
+    if (au_fd) {
+        fclose(au_fd);
+    }
+
+    result.ok = result.sync.superframes_decoded > 0;
+    result.seconds = chrono::duration<double>(
+            chrono::steady_clock::now() - start).count();
+
+    if (not result.ok) {
+        print("No superframe of " + fname + " could be decoded at " +
+                to_string(bitrate) + "kbps, is the bitrate right?\n");
+    }
+    return result;
+}
+
+// Summary of the properties of the AUs of a file
+static string aac_summary(const aac_statistics_t& aac)
+{
+    if (aac.aus == 0) {
+        return "";
+    }
+
+    const double aus = aac.aus;
+    const size_t decoded = aac.aus - aac.errors;
+
+    stringstream ss;
+    char line[512];
+    snprintf(line, sizeof(line),
+            "  %zu AUs, %zu errors, size %zu/%.1f/%zu bytes (min/mean/max), "
+            "SBR %.1f%%, PS %.1f%%, %zu channel changes\n"
+            "  %zu AUs not consumed exactly, decode time %.1f/%.1fus (mean/max)\n",
+            aac.aus, aac.errors, aac.min_au_size, aac.au_bytes / aus,
+            aac.max_au_size,
+            decoded ? 100.0 * aac.sbr_aus / decoded : 0.0,
+            decoded ? 100.0 * aac.ps_aus / decoded : 0.0,
+            aac.channel_changes, aac.consumption_mismatches,
+            1e6 * aac.decode_seconds / aus, 1e6 * aac.max_decode_seconds);
+    ss << line << "  AU sizes:";
+
+    for (size_t i = 0; i < num_au_size_buckets; i++) {
+        if (aac.au_sizes[i] == 0) {
+            continue;
+        }
+        if (i == num_au_size_buckets - 1) {
+            ss << " >=" << i * au_size_bucket_bytes;
+        }
+        else {
+            ss << " " << i * au_size_bucket_bytes << "-" <<
+                (i + 1) * au_size_bucket_bytes - 1;
+        }
+        ss << ": " << aac.au_sizes[i];
+    }
+    ss << "\n";
+    return ss.str();
+}
+
+// A superframe carries 120ms of audio
+static double audio_seconds(const superframe_sync_statistics_t& sync)
+{
+    return 0.12 * (sync.superframes_decoded + sync.superframes_skipped);
 }
 
 int main(int argc, char **argv)
@@ -53,40 +326,126 @@ int main(int argc, char **argv)
     cerr << "Faadalyse -- A .dabp file analyser\n  www.opendigitalradio.org\n" <<
             " compiled at " << __DATE__ << " " << __TIME__ << "\n";
 
-    if (argc != 3) {
+    int bitrate = 0;
+    bool au_statistics = false;
+    int num_threads = thread::hardware_concurrency();
+    string output_dir = ".";
+
+    int ch;
+    while ((ch = getopt(argc, argv, "ab:hj:o:")) != -1) {
+        switch (ch) {
+            case 'a':
+                au_statistics = true;
+                break;
+            case 'b':
+                bitrate = atoi(optarg);
+                break;
+            case 'j':
+                num_threads = atoi(optarg);
+                break;
+            case 'o':
+                output_dir = optarg;
+                break;
+            case 'h':
+            default:
+                usage();
+                return 1;
+        }
+    }
+
+    vector<string> fnames(argv + optind, argv + argc);
+
+    // faadalyse <file.dabp> <bitrate>
+    if (fnames.size() == 2 and bitrate == 0 and
+            fnames[1].find_first_not_of("0123456789") == string::npos) {
+        bitrate = stoi(fnames[1]);
+        fnames.pop_back();
+    }
+
+    if (fnames.empty()) {
         usage();
         return 1;
     }
-    const string fname = argv[1];
-    const int bitrate = stoi(argv[2]);
-    if (bitrate % 8 != 0) {
+
+    if (bitrate % 8 != 0 or bitrate < 0) {
         cerr << "Bitrate not a multiple of 8\n";
         return 1;
     }
-    const int subchannel_index = bitrate / 8;
 
-    cerr << "Analysing " << fname << " " << bitrate << "kbps\n";
+    /* Files with the same name in different directories would overwrite
+     * each other's output */
+    vector<string> basenames;
+    map<string, string> fname_of_basename;
+    for (const auto& fname : fnames) {
+        const string basename = output_basename(fname, output_dir);
+        const auto other = fname_of_basename.find(basename);
+        if (other != fname_of_basename.end()) {
+            cerr << "Both " << other->second << " and " << fname <<
+                " would be written to " << basename << ".wav\n";
+            return 1;
+        }
+        fname_of_basename[basename] = fname;
+        basenames.push_back(basename);
+    }
+
+    num_threads = max(1, min(num_threads, (int)fnames.size()));
 
-    DabPlusSnoop snoop;
-    snoop.set_subchannel_index(subchannel_index);
+    vector<file_result_t> results(fnames.size());
+    atomic<size_t> next_file(0);
+    const auto start = chrono::steady_clock::now();
 
-    FILE* fd = fopen(fname.c_str(), "r");
-    if (!fd) {
-        cerr << "Failed to open file\n";
-        return 1;
+    auto worker = [&]() {
+        size_t i;
+        while ((i = next_file++) < fnames.size()) {
+            results[i] = analyse_file(fnames[i], bitrate, basenames[i],
+                    au_statistics);
+
+            const auto& r = results[i];
+            if (r.ok) {
+                char line[512];
+                snprintf(line, sizeof(line),
+                        "%s: %dkbps, %zu superframes, %zu skipped, "
+                        "%.1fs of audio in %.2fs, %.0fx realtime, %.1fMB/s\n",
+                        fnames[i].c_str(), r.bitrate,
+                        r.sync.superframes_decoded, r.sync.superframes_skipped,
+                        audio_seconds(r.sync), r.seconds,
+                        audio_seconds(r.sync) / r.seconds,
+                        r.bytes / r.seconds / 1e6);
+                print(line + aac_summary(r.aac));
+            }
+        }
+    };
+
+    vector<thread> threads;
+    for (int t = 1; t < num_threads; t++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& t : threads) {
+        t.join();
     }
 
-    while (!feof(fd) and !ferror(fd)) {
-        vector<uint8_t> buf(1024);
-        size_t read_bytes = fread(buf.data(), 1, 1024, fd);
+    const double seconds = chrono::duration<double>(
+            chrono::steady_clock::now() - start).count();
 
-        if (read_bytes) {
-            snoop.push(buf.data(), read_bytes);
+    size_t num_ok = 0;
+    size_t bytes = 0;
+    double audio = 0;
+    for (const auto& r : results) {
+        if (r.ok) {
+            num_ok++;
+            bytes += r.bytes;
+            audio += audio_seconds(r.sync);
         }
     }
 
-    cerr << "Write file stream-0.wav\n";
+    if (fnames.size() > 1) {
+        fprintf(stderr, "%zu of %zu files decoded on %d threads: "
+                "%.1fs of audio in %.2fs, %.0fx realtime, %.1fMB/s\n",
+                num_ok, fnames.size(), num_threads, audio, seconds,
+                audio / seconds, bytes / seconds / 1e6);
+    }
 
-    return 0;
+    return num_ok == fnames.size() ? 0 : 1;
 }
 
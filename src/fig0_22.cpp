@@ -56,6 +56,16 @@ void fig0_22_cleardb()
     fig0_22_key_Lat_Lng.clear();
 }
 
+const std::map<uint16_t, Lat_Lng>& fig0_22_getdb()
+{
+    return fig0_22_key_Lat_Lng;
+}
+
+void fig0_22_setdb(const std::map<uint16_t, Lat_Lng>& key_lat_lng)
+{
+    fig0_22_key_Lat_Lng = key_lat_lng;
+}
+
 // FIG 0/22 Transmitter Identification Information (TII) database
 // ETSI EN 300 401 8.1.9
 fig_result_t fig0_22(fig0_common_t& fig0, const display_settings_t &disp)
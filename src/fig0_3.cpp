@@ -84,6 +84,14 @@ fig_result_t fig0_3(fig0_common_t& fig0, const display_settings_t &disp)
             r.errors.push_back(strprintf("Rfu=%d invalid value", Rfu));
         }
 
+        if (fig0.fibcrccorrect) {
+            auto& component = fig0.ensemble.get_or_create_packet_component(SCId);
+            component.subchId = SubChId;
+            component.packet_address = Packet_address;
+            component.dscty = DSCTy;
+            component.dg_flag = DG_flag;
+        }
+
         i += 5;
         if (CAOrg_flag) {
             if (i < fig0.figlen - 1) {
@@ -53,6 +53,16 @@ void fig0_6_cleardb()
     fig0_6_key_la.clear();
 }
 
+const std::map<uint16_t, bool>& fig0_6_getdb()
+{
+    return fig0_6_key_la;
+}
+
+void fig0_6_setdb(const std::map<uint16_t, bool>& key_la)
+{
+    fig0_6_key_la = key_la;
+}
+
 // FIG 0/6 Service linking information
 // ETSI EN 300 401 8.1.15
 fig_result_t fig0_6(fig0_common_t& fig0, const display_settings_t &disp)
@@ -87,9 +87,7 @@ fig_result_t fig1_select(fig1_common_t& fig1, const display_settings_t &disp)
 
                 if (fig1.fibcrccorrect) {
                     fig1.ensemble.EId = eid;
-                    fig1.ensemble.label.label_bytes = label;
-                    fig1.ensemble.label.shortlabel_flag = flag;
-                    fig1.ensemble.label.charset = charset_to_charset(charset);
+                    fig1.ensemble.label.set_fig1_label(label, flag, charset_to_charset(charset));
 
                     r.msgs.push_back(strprintf("Label=\"%s\"", fig1.ensemble.label.label().c_str()));
                     r.msgs.push_back(strprintf("Short label mask=0x%04X", flag));
@@ -106,9 +104,7 @@ fig_result_t fig1_select(fig1_common_t& fig1, const display_settings_t &disp)
                 if (fig1.fibcrccorrect) {
                     try {
                         auto& service = fig1.ensemble.get_service(sid);
-                        service.label.label_bytes = label;
-                        service.label.shortlabel_flag = flag;
-                        service.label.charset = charset_to_charset(charset);
+                        service.label.set_fig1_label(label, flag, charset_to_charset(charset));
 
                         r.msgs.push_back(strprintf("Service ID=0x%04X", sid));
                         r.msgs.push_back(strprintf("Label=\"%s\"", service.label.label().c_str()));
@@ -38,11 +38,7 @@ static void handle_ext_label_data_field(fig2_common_t& fig2, ensemble_database::
     const uint8_t *f = fig2.f + header_length + fig2.identifier_len();
     const size_t len_bytes = fig2.figlen - header_length - fig2.identifier_len();
 
-    if (label.toggle_flag != fig2.toggle_flag()) {
-        label.segments.clear();
-        label.extended_label_charset = ensemble_database::charset_e::UNDEFINED;
-        label.toggle_flag = fig2.toggle_flag();
-    }
+    label.set_toggle_flag(fig2.toggle_flag());
 
     size_t len_character_field = len_bytes;
 
@@ -50,17 +46,13 @@ static void handle_ext_label_data_field(fig2_common_t& fig2, ensemble_database::
         // Only if it's the first segment
         const uint8_t encoding_flag = (f[0] & 0x80) >> 7;
         const uint8_t segment_count = (f[0] & 0x70) >> 4;
-        label.segment_count = segment_count + 1;
 
         r.msgs.push_back(strprintf("encoding=%s", (encoding_flag ? "UCS-2" : "UTF-8")));
         r.msgs.push_back(strprintf("Total number of segments=%d", segment_count + 1));
 
-        if (encoding_flag) {
-            label.extended_label_charset = ensemble_database::charset_e::UCS2;
-        }
-        else {
-            label.extended_label_charset = ensemble_database::charset_e::UTF8;
-        }
+        label.set_extended_label_header(segment_count + 1, encoding_flag ?
+                ensemble_database::charset_e::UCS2 :
+                ensemble_database::charset_e::UTF8);
 
         if (fig2.rfu() == 0) {
             const uint8_t rfa = (f[0] & 0x0F);
@@ -89,8 +81,7 @@ static void handle_ext_label_data_field(fig2_common_t& fig2, ensemble_database::
         }
     }
 
-    vector<uint8_t> labelbytes(f, f + len_character_field);
-    label.segments[fig2.segment_index()] = labelbytes;
+    label.set_segment(fig2.segment_index(), f, len_character_field);
 }
 
 // UTF-8 or UCS2 Labels
@@ -122,7 +113,7 @@ fig_result_t fig2_select(fig2_common_t& fig2, const display_settings_t &disp)
                     r.msgs.push_back(strprintf("Ensemble ID=0x%04X", eid));
                     handle_ext_label_data_field(fig2, fig2.ensemble.label, disp, r);
 
-                    const auto complete_label = fig2.ensemble.label.assemble();
+                    const auto& complete_label = fig2.ensemble.label.assemble();
                     r.msgs.push_back(strprintf("Label segments=\"%s\"", fig2.ensemble.label.assembly_state().c_str()));
                     if (not complete_label.empty()) {
                         r.msgs.push_back(strprintf("Label=\"%s\"", complete_label.c_str()));
@@ -143,7 +134,7 @@ fig_result_t fig2_select(fig2_common_t& fig2, const display_settings_t &disp)
                         auto& service = fig2.ensemble.get_service(sid);
                         handle_ext_label_data_field(fig2, service.label, disp, r);
 
-                        const auto complete_label = service.label.assemble();
+                        const auto& complete_label = service.label.assemble();
                         r.msgs.push_back(strprintf("Label segments=\"%s\"", service.label.assembly_state().c_str()));
                         if (not complete_label.empty()) {
                             r.msgs.push_back(strprintf("Label=\"%s\"", complete_label.c_str()));
@@ -185,7 +176,7 @@ fig_result_t fig2_select(fig2_common_t& fig2, const display_settings_t &disp)
 
                         handle_ext_label_data_field(fig2, comp.label, disp, r);
 
-                        const auto complete_label = comp.label.assemble();
+                        const auto& complete_label = comp.label.assemble();
                         r.msgs.push_back(strprintf("Label segments=\"%s\"", comp.label.assembly_state().c_str()));
                         if (not complete_label.empty()) {
                             r.msgs.push_back(strprintf("Label=\"%s\"", complete_label.c_str()));
@@ -212,7 +203,7 @@ fig_result_t fig2_select(fig2_common_t& fig2, const display_settings_t &disp)
                         auto& service = fig2.ensemble.get_service(sid);
                         handle_ext_label_data_field(fig2, service.label, disp, r);
 
-                        const auto complete_label = service.label.assemble();
+                        const auto& complete_label = service.label.assemble();
                         r.msgs.push_back(strprintf("Label segments=\"%s\"", service.label.assembly_state().c_str()));
                         if (not complete_label.empty()) {
                             r.msgs.push_back(strprintf("Label=\"%s\"", complete_label.c_str()));
@@ -262,7 +253,7 @@ fig_result_t fig2_select(fig2_common_t& fig2, const display_settings_t &disp)
 
                     handle_ext_label_data_field(fig2, label, disp, r);
 
-                    const auto complete_label = label.assemble();
+                    const auto& complete_label = label.assemble();
                     r.msgs.push_back(strprintf("Label segments=\"%s\"", label.assembly_state().c_str()));
                     if (not complete_label.empty()) {
                         r.msgs.push_back(strprintf("Label=\"%s\"", complete_label.c_str()));
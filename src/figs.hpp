@@ -30,6 +30,7 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <map>
 #include "utils.hpp"
 #include "tables.hpp"
 #include "watermarkdecoder.hpp"
@@ -168,6 +169,9 @@ fig_result_t fig0_2(fig0_common_t& fig0, const display_settings_t &disp);
 fig_result_t fig0_3(fig0_common_t& fig0, const display_settings_t &disp);
 fig_result_t fig0_5(fig0_common_t& fig0, const display_settings_t &disp);
 void fig0_6_cleardb();
+// Access to the FIG 0/6 database key to LA map, for ensemble snapshots
+const std::map<uint16_t, bool>& fig0_6_getdb();
+void fig0_6_setdb(const std::map<uint16_t, bool>& key_la);
 fig_result_t fig0_6(fig0_common_t& fig0, const display_settings_t &disp);
 fig_result_t fig0_7(fig0_common_t& fig0, const display_settings_t &disp);
 fig_result_t fig0_8(fig0_common_t& fig0, const display_settings_t &disp);
@@ -182,6 +186,9 @@ fig_result_t fig0_18(fig0_common_t& fig0, const display_settings_t &disp);
 fig_result_t fig0_19(fig0_common_t& fig0, const display_settings_t &disp);
 fig_result_t fig0_21(fig0_common_t& fig0, const display_settings_t &disp);
 void fig0_22_cleardb();
+// Access to the FIG 0/22 TII database, for ensemble snapshots
+const std::map<uint16_t, Lat_Lng>& fig0_22_getdb();
+void fig0_22_setdb(const std::map<uint16_t, Lat_Lng>& key_lat_lng);
 fig_result_t fig0_22(fig0_common_t& fig0, const display_settings_t &disp);
 fig_result_t fig0_24(fig0_common_t& fig0, const display_settings_t &disp);
 fig_result_t fig0_25(fig0_common_t& fig0, const display_settings_t &disp);
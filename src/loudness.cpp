@@ -0,0 +1,581 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    loudness.cpp
+        Loudness and true peak measurement according to ITU-R BS.1770-4
+        and EBU R 128 (EBU Tech 3341 and 3342)
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include "loudness.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define LOUDNESS_X86_SIMD 1
+#  include <immintrin.h>
+#else
+#  define LOUDNESS_X86_SIMD 0
+#endif
+
+using namespace std;
+
+static const double absolute_gate = -70.0;
+
+static double energy_to_loudness(double energy)
+{
+    return energy > 0 ? -0.691 + 10 * log10(energy) : -HUGE_VAL;
+}
+
+/* The true peak is measured on the signal oversampled by 4 with a
+ * polyphase FIR filter. Phase p of the output at input sample n is
+ *   sum(j = 0..11) true_peak_fir.taps[j][p] * x[n - j]
+ */
+static const size_t true_peak_taps = 12;
+static const size_t true_peak_history = true_peak_taps - 1;
+
+struct true_peak_fir_t {
+    alignas(16) float taps[true_peak_taps][4];
+
+    /* Windowed sinc with a cutoff at the Nyquist frequency of the input,
+     * centered on tap 24 of 48, so that phase 0 reproduces the input */
+    true_peak_fir_t() {
+        const int len = 4 * true_peak_taps;
+        const int center = len / 2;
+        for (int k = 0; k < len; k++) {
+            const double t = (k - center) / 4.0;
+            const double sinc = (k == center) ? 1 : sin(M_PI * t) / (M_PI * t);
+            const double w = 0.42 - 0.5 * cos(2 * M_PI * k / len) +
+                0.08 * cos(4 * M_PI * k / len);
+            taps[k / 4][k % 4] = sinc * w;
+        }
+    }
+};
+
+static const true_peak_fir_t& get_true_peak_fir()
+{
+    static const true_peak_fir_t fir;
+    return fir;
+}
+
+/* K-weighting kernels. They filter num_frames frames of audio and add the
+ * squares of the output to sums. The filter states are kept in the
+ * interleaved layout {z1 L, z1 R, z2 L, z2 R}. */
+typedef void (*kweighting_kernel_t)(
+        const loudness_biquad_t& shelving, const loudness_biquad_t& highpass,
+        double *shelving_state, double *highpass_state,
+        const int16_t *samples, size_t num_frames, int channels,
+        double *sums);
+
+static inline double biquad(const loudness_biquad_t& f,
+        double *state, int ch, double x)
+{
+    const double y = f.b0 * x + state[ch];
+    state[ch] = f.b1 * x - f.a1 * y + state[2 + ch];
+    state[2 + ch] = f.b2 * x - f.a2 * y;
+    return y;
+}
+
+static void kweighting_scalar(
+        const loudness_biquad_t& shelving, const loudness_biquad_t& highpass,
+        double *shelving_state, double *highpass_state,
+        const int16_t *samples, size_t num_frames, int channels,
+        double *sums)
+{
+    for (size_t n = 0; n < num_frames; n++) {
+        for (int ch = 0; ch < channels; ch++) {
+            const double x = samples[n * channels + ch] / 32768.0;
+            const double y = biquad(highpass, highpass_state, ch,
+                    biquad(shelving, shelving_state, ch, x));
+            sums[ch] += y * y;
+        }
+    }
+}
+
+/* Type of the true peak kernels: return the highest absolute value of
+ * the oversampled signal at the num_samples samples of x that follow
+ * true_peak_history samples of history */
+typedef float (*true_peak_kernel_t)(const true_peak_fir_t& fir,
+        const float *x, size_t num_samples);
+
+static float true_peak_scalar(const true_peak_fir_t& fir,
+        const float *x, size_t num_samples)
+{
+    float peak = 0;
+    for (size_t n = true_peak_history; n < true_peak_history + num_samples; n++) {
+        for (int p = 0; p < 4; p++) {
+            float y = 0;
+            for (size_t j = 0; j < true_peak_taps; j++) {
+                y += fir.taps[j][p] * x[n - j];
+            }
+            peak = max(peak, fabsf(y));
+        }
+    }
+    return peak;
+}
+
+#if LOUDNESS_X86_SIMD
+// Both channels of stereo audio are filtered in parallel, one per lane
+__attribute__((target("sse2")))
+static void kweighting_sse2(
+        const loudness_biquad_t& shelving, const loudness_biquad_t& highpass,
+        double *shelving_state, double *highpass_state,
+        const int16_t *samples, size_t num_frames, int channels,
+        double *sums)
+{
+    if (channels != 2) {
+        kweighting_scalar(shelving, highpass, shelving_state, highpass_state,
+                samples, num_frames, channels, sums);
+        return;
+    }
+
+    const __m128d scale = _mm_set1_pd(1.0 / 32768.0);
+
+    const __m128d s_b0 = _mm_set1_pd(shelving.b0);
+    const __m128d s_b1 = _mm_set1_pd(shelving.b1);
+    const __m128d s_b2 = _mm_set1_pd(shelving.b2);
+    const __m128d s_a1 = _mm_set1_pd(shelving.a1);
+    const __m128d s_a2 = _mm_set1_pd(shelving.a2);
+    const __m128d h_b0 = _mm_set1_pd(highpass.b0);
+    const __m128d h_b1 = _mm_set1_pd(highpass.b1);
+    const __m128d h_b2 = _mm_set1_pd(highpass.b2);
+    const __m128d h_a1 = _mm_set1_pd(highpass.a1);
+    const __m128d h_a2 = _mm_set1_pd(highpass.a2);
+
+    __m128d s_z1 = _mm_loadu_pd(shelving_state);
+    __m128d s_z2 = _mm_loadu_pd(shelving_state + 2);
+    __m128d h_z1 = _mm_loadu_pd(highpass_state);
+    __m128d h_z2 = _mm_loadu_pd(highpass_state + 2);
+    __m128d acc = _mm_loadu_pd(sums);
+
+    for (size_t n = 0; n < num_frames; n++) {
+        int32_t frame;
+        memcpy(&frame, samples + 2 * n, sizeof(frame));
+
+        // Sign-extend both int16 samples to int32
+        const __m128i xi = _mm_srai_epi32(
+                _mm_unpacklo_epi16(_mm_setzero_si128(), _mm_cvtsi32_si128(frame)), 16);
+        const __m128d x = _mm_mul_pd(_mm_cvtepi32_pd(xi), scale);
+
+        const __m128d s = _mm_add_pd(_mm_mul_pd(s_b0, x), s_z1);
+        s_z1 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(s_b1, x), _mm_mul_pd(s_a1, s)), s_z2);
+        s_z2 = _mm_sub_pd(_mm_mul_pd(s_b2, x), _mm_mul_pd(s_a2, s));
+
+        const __m128d y = _mm_add_pd(_mm_mul_pd(h_b0, s), h_z1);
+        h_z1 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(h_b1, s), _mm_mul_pd(h_a1, y)), h_z2);
+        h_z2 = _mm_sub_pd(_mm_mul_pd(h_b2, s), _mm_mul_pd(h_a2, y));
+
+        acc = _mm_add_pd(acc, _mm_mul_pd(y, y));
+    }
+
+    _mm_storeu_pd(shelving_state, s_z1);
+    _mm_storeu_pd(shelving_state + 2, s_z2);
+    _mm_storeu_pd(highpass_state, h_z1);
+    _mm_storeu_pd(highpass_state + 2, h_z2);
+    _mm_storeu_pd(sums, acc);
+}
+
+/* The vector true peak kernels compute one phase of the output for 4 or 8
+ * consecutive input samples at a time */
+__attribute__((target("sse2")))
+static float true_peak_sse2(const true_peak_fir_t& fir,
+        const float *x, size_t num_samples)
+{
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 peak = _mm_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 4 <= num_samples; i += 4) {
+        const float *xn = x + true_peak_history + i;
+        for (int p = 0; p < 4; p++) {
+            __m128 y = _mm_setzero_ps();
+            for (size_t j = 0; j < true_peak_taps; j++) {
+                y = _mm_add_ps(y, _mm_mul_ps(
+                            _mm_set1_ps(fir.taps[j][p]), _mm_loadu_ps(xn - j)));
+            }
+            peak = _mm_max_ps(peak, _mm_andnot_ps(sign, y));
+        }
+    }
+
+    float peaks[4];
+    _mm_storeu_ps(peaks, peak);
+    float result = max(max(peaks[0], peaks[1]), max(peaks[2], peaks[3]));
+
+    return max(result, true_peak_scalar(fir, x + i, num_samples - i));
+}
+
+__attribute__((target("avx2,fma")))
+static float true_peak_avx2(const true_peak_fir_t& fir,
+        const float *x, size_t num_samples)
+{
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 peak = _mm256_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 8 <= num_samples; i += 8) {
+        const float *xn = x + true_peak_history + i;
+        for (int p = 0; p < 4; p++) {
+            __m256 y = _mm256_setzero_ps();
+            for (size_t j = 0; j < true_peak_taps; j++) {
+                y = _mm256_fmadd_ps(_mm256_set1_ps(fir.taps[j][p]),
+                        _mm256_loadu_ps(xn - j), y);
+            }
+            peak = _mm256_max_ps(peak, _mm256_andnot_ps(sign, y));
+        }
+    }
+
+    float peaks[8];
+    _mm256_storeu_ps(peaks, peak);
+    float result = *max_element(peaks, peaks + 8);
+
+    return max(result, true_peak_scalar(fir, x + i, num_samples - i));
+}
+#endif
+
+static kweighting_kernel_t select_kweighting_kernel()
+{
+#if LOUDNESS_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        return kweighting_sse2;
+    }
+#endif
+    return kweighting_scalar;
+}
+
+static true_peak_kernel_t select_true_peak_kernel()
+{
+#if LOUDNESS_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") and __builtin_cpu_supports("fma")) {
+        return true_peak_avx2;
+    }
+    else if (__builtin_cpu_supports("sse2")) {
+        return true_peak_sse2;
+    }
+#endif
+    return true_peak_scalar;
+}
+
+static const kweighting_kernel_t kweighting_kernel = select_kweighting_kernel();
+static const true_peak_kernel_t true_peak_kernel = select_true_peak_kernel();
+
+void LoudnessMeter::configure(int sample_rate, int channels)
+{
+    if (sample_rate <= 0 or sample_rate % 10 != 0) {
+        throw invalid_argument("LoudnessMeter: unsupported sample rate");
+    }
+
+    if (channels != 1 and channels != 2) {
+        throw invalid_argument("LoudnessMeter: unsupported number of channels");
+    }
+
+    *this = LoudnessMeter();
+    m_sample_rate = sample_rate;
+    m_channels = channels;
+
+    // K-weighting filter of BS.1770, recalculated for the sample rate
+    {
+        const double f0 = 1681.974450955533;
+        const double G = 3.999843853973347;
+        const double Q = 0.7071752369554196;
+        const double K = tan(M_PI * f0 / sample_rate);
+        const double Vh = pow(10.0, G / 20.0);
+        const double Vb = pow(Vh, 0.4996667741545416);
+        const double a0 = 1.0 + K / Q + K * K;
+
+        m_shelving.b0 = (Vh + Vb * K / Q + K * K) / a0;
+        m_shelving.b1 = 2.0 * (K * K - Vh) / a0;
+        m_shelving.b2 = (Vh - Vb * K / Q + K * K) / a0;
+        m_shelving.a1 = 2.0 * (K * K - 1.0) / a0;
+        m_shelving.a2 = (1.0 - K / Q + K * K) / a0;
+    }
+
+    {
+        const double f0 = 38.13547087602444;
+        const double Q = 0.5003270373238773;
+        const double K = tan(M_PI * f0 / sample_rate);
+        const double a0 = 1.0 + K / Q + K * K;
+
+        m_highpass.b0 = 1.0;
+        m_highpass.b1 = -2.0;
+        m_highpass.b2 = 1.0;
+        m_highpass.a1 = 2.0 * (K * K - 1.0) / a0;
+        m_highpass.a2 = (1.0 - K / Q + K * K) / a0;
+    }
+
+    m_subblock_len = sample_rate / 10;
+
+    m_momentary_histogram.resize(histogram_bins);
+    m_short_term_histogram.resize(histogram_bins);
+
+    for (int ch = 0; ch < channels; ch++) {
+        m_peak_history[ch].assign(true_peak_history, 0.0f);
+    }
+}
+
+void LoudnessMeter::set_channels(int channels)
+{
+    if (m_channels == 0) {
+        throw logic_error("LoudnessMeter: set_channels before configure");
+    }
+
+    if (channels != 1 and channels != 2) {
+        throw invalid_argument("LoudnessMeter: unsupported number of channels");
+    }
+
+    if (channels == m_channels) {
+        return;
+    }
+    m_channels = channels;
+
+    // The filter states and the partial sub-block belong to the old layout
+    fill(begin(m_shelving_state), end(m_shelving_state), 0.0);
+    fill(begin(m_highpass_state), end(m_highpass_state), 0.0);
+    fill(begin(m_subblock_sums), end(m_subblock_sums), 0.0);
+    m_subblock_fill = 0;
+
+    for (int ch = 0; ch < 2; ch++) {
+        m_peak_history[ch].assign(ch < channels ? true_peak_history : 0, 0.0f);
+    }
+}
+
+void LoudnessMeter::process(const int16_t *samples, size_t num_samples)
+{
+    if (m_channels == 0) {
+        throw logic_error("LoudnessMeter: process before configure");
+    }
+
+    const size_t num_frames = num_samples / m_channels;
+
+    size_t pos = 0;
+    while (pos < num_frames) {
+        const size_t len = min(num_frames - pos, m_subblock_len - m_subblock_fill);
+        kweighting_kernel(m_shelving, m_highpass,
+                m_shelving_state, m_highpass_state,
+                samples + pos * m_channels, len, m_channels, m_subblock_sums);
+        pos += len;
+        m_subblock_fill += len;
+
+        if (m_subblock_fill == m_subblock_len) {
+            end_subblock();
+        }
+    }
+
+    /* After a long silence, the filter states decay into the denormal range,
+     * where the arithmetic gets very slow. That takes much longer than one
+     * call, flushing them here is enough. */
+    for (double *state : {m_shelving_state, m_highpass_state}) {
+        for (int k = 0; k < 4; k++) {
+            if (fabs(state[k]) < 1e-30) {
+                state[k] = 0;
+            }
+        }
+    }
+
+    m_peak_input.resize(true_peak_history + num_frames);
+    const true_peak_fir_t& fir = get_true_peak_fir();
+
+    for (int ch = 0; ch < m_channels; ch++) {
+        vector<float>& history = m_peak_history[ch];
+        copy(history.begin(), history.end(), m_peak_input.begin());
+        for (size_t n = 0; n < num_frames; n++) {
+            m_peak_input[true_peak_history + n] =
+                samples[n * m_channels + ch] / 32768.0f;
+        }
+
+        const float peak = true_peak_kernel(fir, m_peak_input.data(), num_frames);
+        m_true_peak = max(m_true_peak, peak);
+        m_interval_true_peak = max(m_interval_true_peak, peak);
+
+        copy(m_peak_input.end() - true_peak_history, m_peak_input.end(),
+                history.begin());
+    }
+}
+
+void LoudnessMeter::end_subblock()
+{
+    double energy = 0;
+    for (int ch = 0; ch < m_channels; ch++) {
+        energy += m_subblock_sums[ch] / m_subblock_len;
+        m_subblock_sums[ch] = 0;
+    }
+    m_subblock_fill = 0;
+
+    m_subblocks[m_num_subblocks % short_term_subblocks] = energy;
+    m_num_subblocks++;
+
+    // Blocks of 400ms and 3s, overlapping, with a new one every 100ms
+    if (m_num_subblocks >= momentary_subblocks) {
+        const double e = block_energy(momentary_subblocks);
+        histogram_add(m_momentary_histogram, e);
+        m_max_momentary_energy = max(m_max_momentary_energy, e);
+    }
+
+    if (m_num_subblocks >= short_term_subblocks) {
+        const double e = block_energy(short_term_subblocks);
+        histogram_add(m_short_term_histogram, e);
+        m_max_short_term_energy = max(m_max_short_term_energy, e);
+    }
+}
+
+double LoudnessMeter::block_energy(size_t num_subblocks) const
+{
+    double energy = 0;
+    for (uint64_t i = m_num_subblocks - num_subblocks; i < m_num_subblocks; i++) {
+        energy += m_subblocks[i % short_term_subblocks];
+    }
+    return energy / num_subblocks;
+}
+
+double LoudnessMeter::momentary() const
+{
+    if (m_num_subblocks < momentary_subblocks) {
+        return -HUGE_VAL;
+    }
+    return energy_to_loudness(block_energy(momentary_subblocks));
+}
+
+double LoudnessMeter::short_term() const
+{
+    if (m_num_subblocks < short_term_subblocks) {
+        return -HUGE_VAL;
+    }
+    return energy_to_loudness(block_energy(short_term_subblocks));
+}
+
+void LoudnessMeter::histogram_add(histogram_t& histogram, double energy)
+{
+    const double loudness = energy_to_loudness(energy);
+    if (loudness <= absolute_gate) {
+        return;
+    }
+
+    const int bin = min(histogram_bins - 1,
+            (int)((loudness - absolute_gate) * 10));
+    histogram[bin].count++;
+    histogram[bin].energy += energy;
+}
+
+int LoudnessMeter::gated_mean(const histogram_t& histogram,
+        double relative_gate, double& energy)
+{
+    uint64_t count = 0;
+    double sum = 0;
+    for (const auto& bin : histogram) {
+        count += bin.count;
+        sum += bin.energy;
+    }
+
+    if (count == 0) {
+        return -1;
+    }
+
+    const double gate = energy_to_loudness(sum / count) - relative_gate;
+    const int first = max(0, min(histogram_bins - 1,
+                (int)floor((gate - absolute_gate) * 10)));
+
+    count = 0;
+    sum = 0;
+    for (int i = first; i < histogram_bins; i++) {
+        count += histogram[i].count;
+        sum += histogram[i].energy;
+    }
+
+    if (count == 0) {
+        return -1;
+    }
+
+    energy = sum / count;
+    return first;
+}
+
+double LoudnessMeter::integrated() const
+{
+    double energy = 0;
+    if (gated_mean(m_momentary_histogram, 10.0, energy) < 0) {
+        return -HUGE_VAL;
+    }
+    return energy_to_loudness(energy);
+}
+
+double LoudnessMeter::loudness_range() const
+{
+    // EBU Tech 3342: distribution of the short-term loudness, 20 LU gate
+    double energy = 0;
+    const int first = gated_mean(m_short_term_histogram, 20.0, energy);
+    if (first < 0) {
+        return 0;
+    }
+
+    uint64_t count = 0;
+    for (int i = first; i < histogram_bins; i++) {
+        count += m_short_term_histogram[i].count;
+    }
+
+    const uint64_t low_rank = (uint64_t)(0.10 * (count - 1));
+    const uint64_t high_rank = (uint64_t)(0.95 * (count - 1));
+    int low_bin = -1;
+    int high_bin = -1;
+
+    uint64_t cumulated = 0;
+    for (int i = first; i < histogram_bins; i++) {
+        cumulated += m_short_term_histogram[i].count;
+        if (low_bin == -1 and cumulated > low_rank) {
+            low_bin = i;
+        }
+        if (cumulated > high_rank) {
+            high_bin = i;
+            break;
+        }
+    }
+
+    return (high_bin - low_bin) * 0.1;
+}
+
+static double peak_to_dB(float peak)
+{
+    return peak > 0 ? 20 * log10(peak) : -HUGE_VAL;
+}
+
+double LoudnessMeter::true_peak() const
+{
+    return peak_to_dB(m_true_peak);
+}
+
+double LoudnessMeter::take_interval_true_peak()
+{
+    const double peak = peak_to_dB(m_interval_true_peak);
+    m_interval_true_peak = 0;
+    return peak;
+}
+
+loudness_statistics_t LoudnessMeter::get_statistics() const
+{
+    loudness_statistics_t stats;
+    stats.integrated = integrated();
+    stats.range = loudness_range();
+    stats.max_momentary = energy_to_loudness(m_max_momentary_energy);
+    stats.max_short_term = energy_to_loudness(m_max_short_term_energy);
+    stats.true_peak = true_peak();
+    return stats;
+}
+
@@ -0,0 +1,145 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    loudness.hpp
+        Loudness and true peak measurement according to ITU-R BS.1770-4
+        and EBU R 128 (EBU Tech 3341 and 3342)
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include <vector>
+
+/* Loudness values are in LUFS, and are -infinity if there is not enough
+ * audio, or if it is entirely below the absolute gate of -70 LUFS. */
+struct loudness_statistics_t {
+    double integrated = 0;      // Gated, over the whole run
+    double range = 0;           // Loudness range (LRA) in LU
+    double max_momentary = 0;   // Highest loudness of a 400ms block
+    double max_short_term = 0;  // Highest loudness of a 3s block
+    double true_peak = 0;       // Highest true peak in dBTP
+};
+
+// Normalised biquad, a0 is 1
+struct loudness_biquad_t {
+    double b0, b1, b2, a1, a2;
+};
+
+/* The meter keeps the 100ms sub-block energies of the last 3 seconds, and
+ * histograms with a resolution of 0.1 LU of the block loudness for
+ * the gating. Its memory does not grow with the duration of the audio. */
+class LoudnessMeter {
+    public:
+        /* Prepare for audio with the given sample rate and number of
+         * channels (1 or 2), and discard all measurements */
+        void configure(int sample_rate, int channels);
+
+        /* Change the number of channels (1 or 2), for instance when the
+         * audio switches between mono and stereo. The measurements are
+         * kept, only the sub-block in progress is restarted. */
+        void set_channels(int channels);
+
+        int sample_rate(void) const { return m_sample_rate; }
+        int channels(void) const { return m_channels; }
+
+        /* Measure num_samples samples of interleaved audio, num_samples
+         * counts the samples of all channels */
+        void process(const int16_t *samples, size_t num_samples);
+
+        // Duration of the complete sub-blocks measured so far, in seconds
+        double duration(void) const { return m_num_subblocks * 0.1; }
+
+        double momentary(void) const;
+        double short_term(void) const;
+        double integrated(void) const;
+        double loudness_range(void) const;
+
+        // Highest true peak since configure, in dBTP
+        double true_peak(void) const;
+
+        /* Highest true peak since the previous call, in dBTP. Used for time
+         * series. */
+        double take_interval_true_peak(void);
+
+        loudness_statistics_t get_statistics(void) const;
+
+    private:
+        // Block loudness histogram from -70 LUFS to +10 LUFS
+        static const int histogram_bins = 800;
+
+        struct histogram_bin_t {
+            uint64_t count = 0;
+            double energy = 0;
+        };
+
+        typedef std::vector<histogram_bin_t> histogram_t;
+
+        static void histogram_add(histogram_t& histogram, double energy);
+
+        /* Mean energy of the blocks above the relative gate, which is
+         * relative_gate LU below the mean of all blocks. Returns the
+         * index of the first bin above the gate, or -1 if the histogram is
+         * empty. */
+        static int gated_mean(const histogram_t& histogram,
+                double relative_gate, double& energy);
+
+        void end_subblock(void);
+
+        // Mean energy of the last num_subblocks sub-blocks
+        double block_energy(size_t num_subblocks) const;
+
+        // Blocks of 400ms and 3s, in sub-blocks of 100ms
+        static const size_t momentary_subblocks = 4;
+        static const size_t short_term_subblocks = 30;
+
+        int m_sample_rate = 0;
+        int m_channels = 0;
+
+        // K-weighting filter
+        loudness_biquad_t m_shelving = {};
+        loudness_biquad_t m_highpass = {};
+
+        // Filter states, channels interleaved: {z1 L, z1 R, z2 L, z2 R}
+        alignas(16) double m_shelving_state[4] = {};
+        alignas(16) double m_highpass_state[4] = {};
+
+        // Sums of squares per channel of the current 100ms sub-block
+        alignas(16) double m_subblock_sums[2] = {};
+        size_t m_subblock_len = 0; // samples per channel
+        size_t m_subblock_fill = 0;
+
+        // Mean square energies of the last 30 sub-blocks, summed over channels
+        std::array<double, short_term_subblocks> m_subblocks;
+        uint64_t m_num_subblocks = 0;
+
+        histogram_t m_momentary_histogram;
+        histogram_t m_short_term_histogram;
+        double m_max_momentary_energy = 0;
+        double m_max_short_term_energy = 0;
+
+        // True peak: de-interleaved samples of one channel, 11 of history first
+        std::vector<float> m_peak_input;
+        std::vector<float> m_peak_history[2];
+        float m_true_peak = 0;
+        float m_interval_true_peak = 0;
+};
+
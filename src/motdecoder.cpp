@@ -0,0 +1,506 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    motdecoder.cpp
+        Reassemble MOT objects from MSC data groups
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include "motdecoder.hpp"
+#include "charset.hpp"
+extern "C" {
+#include "lib_crc.h"
+}
+
+using namespace std;
+
+// MSC data group types carrying MOT
+static const int dg_type_mot_header = 3;
+static const int dg_type_mot_body = 4;
+static const int dg_type_mot_directory = 6;
+
+// ContentName header extension parameter
+static const int mot_param_content_name = 0x0C;
+
+string mot_content_type_to_string(int content_type, int content_subtype)
+{
+    if (content_type == 2) {
+        switch (content_subtype) {
+            case 0: return "image/gif";
+            case 1: return "image/jpeg";
+            case 2: return "image/bmp";
+            case 3: return "image/png";
+        }
+    }
+    else if (content_type == 1) {
+        switch (content_subtype) {
+            case 0: return "text/plain";
+            case 2: return "text/html";
+        }
+    }
+
+    char desc[16];
+    snprintf(desc, sizeof(desc), "%d/%d", content_type, content_subtype);
+    return desc;
+}
+
+static uint64_t fnv1a_hash(const vector<uint8_t>& data)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const uint8_t b : data) {
+        hash ^= b;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+bool MotDecoder::segments_t::complete() const
+{
+    // Segment numbers are consecutive from 0
+    return last_segment != -1 and
+        segments.size() == (size_t)last_segment + 1 and
+        segments.rbegin()->first == last_segment;
+}
+
+vector<uint8_t> MotDecoder::segments_t::assemble() const
+{
+    vector<uint8_t> data;
+    data.reserve(bytes);
+    for (const auto& seg : segments) {
+        data.insert(data.end(), seg.second.begin(), seg.second.end());
+    }
+    return data;
+}
+
+bool MotDecoder::parse_header(const uint8_t *h, size_t len,
+        header_t& header, size_t& header_size)
+{
+    if (len < 7) {
+        return false;
+    }
+
+    header.body_size = (h[0] << 20) | (h[1] << 12) | (h[2] << 4) | (h[3] >> 4);
+    header_size = ((h[3] & 0x0F) << 9) | (h[4] << 1) | (h[5] >> 7);
+    header.content_type = (h[5] >> 1) & 0x3F;
+    header.content_subtype = ((h[5] & 0x01) << 8) | h[6];
+
+    if (header_size < 7 or header_size > len) {
+        return false;
+    }
+
+    size_t pos = 7;
+    while (pos < header_size) {
+        const int pli = h[pos] >> 6;
+        const int param_id = h[pos] & 0x3F;
+        pos++;
+
+        size_t data_len = 0;
+        switch (pli) {
+            case 0: data_len = 0; break;
+            case 1: data_len = 1; break;
+            case 2: data_len = 4; break;
+            case 3:
+                // Data field length indicator of 7 or 15 bits
+                if (pos >= header_size) {
+                    return false;
+                }
+                if (h[pos] & 0x80) {
+                    if (pos + 2 > header_size) {
+                        return false;
+                    }
+                    data_len = ((h[pos] & 0x7F) << 8) | h[pos + 1];
+                    pos += 2;
+                }
+                else {
+                    data_len = h[pos] & 0x7F;
+                    pos++;
+                }
+                break;
+        }
+
+        if (pos + data_len > header_size) {
+            return false;
+        }
+
+        if (param_id == mot_param_content_name and data_len >= 1) {
+            const int charset = h[pos] >> 4;
+            const uint8_t *name = h + pos + 1;
+            const size_t name_len = data_len - 1;
+
+            switch (charset) {
+                case 15: // UTF-8
+                    header.name.assign(name, name + name_len);
+                    break;
+                case 6: // UCS-2
+                    convert_ucs2_to_utf8(name, name_len, header.name);
+                    break;
+                case 4: // ISO Latin 1
+                    header.name.clear();
+                    for (size_t i = 0; i < name_len; i++) {
+                        if (name[i] < 0x80) {
+                            header.name += name[i];
+                        }
+                        else {
+                            header.name += 0xC0 | (name[i] >> 6);
+                            header.name += 0x80 | (name[i] & 0x3F);
+                        }
+                    }
+                    break;
+                default:
+                    convert_ebu_to_utf8(name, name_len, header.name);
+                    break;
+            }
+        }
+
+        pos += data_len;
+    }
+
+    return true;
+}
+
+void MotDecoder::process_data_group(const uint8_t *dg, size_t len)
+{
+    m_stats.data_groups++;
+
+    if (len < 2) {
+        m_stats.invalid_data_groups++;
+        return;
+    }
+
+    const bool extension_flag = dg[0] & 0x80;
+    const bool crc_flag = dg[0] & 0x40;
+    const bool segment_flag = dg[0] & 0x20;
+    const bool user_access_flag = dg[0] & 0x10;
+    const int dg_type = dg[0] & 0x0F;
+
+    if (crc_flag) {
+        if (len < 4) {
+            m_stats.invalid_data_groups++;
+            return;
+        }
+
+        uint16_t crc = 0xFFFF;
+        for (size_t i = 0; i < len - 2; i++) {
+            crc = update_crc_ccitt(crc, dg[i]);
+        }
+        crc = ~crc;
+
+        const uint16_t dg_crc = (dg[len - 2] << 8) | dg[len - 1];
+        if (crc != dg_crc) {
+            m_stats.crc_errors++;
+            return;
+        }
+        len -= 2;
+    }
+
+    if (dg_type != dg_type_mot_header and dg_type != dg_type_mot_body and
+            dg_type != dg_type_mot_directory) {
+        // Scrambled body, compressed directory or not MOT
+        return;
+    }
+
+    // MOT always uses the segment field and a transport id
+    size_t pos = extension_flag ? 4 : 2;
+    if (not segment_flag or not user_access_flag or pos + 3 > len) {
+        m_stats.invalid_data_groups++;
+        return;
+    }
+
+    const bool last = dg[pos] & 0x80;
+    const int segment = ((dg[pos] & 0x7F) << 8) | dg[pos + 1];
+    pos += 2;
+
+    const bool transport_id_flag = dg[pos] & 0x10;
+    const size_t length_indicator = dg[pos] & 0x0F;
+    pos++;
+
+    if (not transport_id_flag or length_indicator < 2 or
+            pos + length_indicator > len) {
+        m_stats.invalid_data_groups++;
+        return;
+    }
+
+    const uint16_t transport_id = (dg[pos] << 8) | dg[pos + 1];
+    pos += length_indicator;
+
+    // Segmentation header
+    if (pos + 2 > len) {
+        m_stats.invalid_data_groups++;
+        return;
+    }
+    const size_t segment_size = ((dg[pos] & 0x1F) << 8) | dg[pos + 1];
+    pos += 2;
+
+    if (pos + segment_size > len) {
+        m_stats.invalid_data_groups++;
+        return;
+    }
+
+    m_stats.segments++;
+    add_segment(dg_type, transport_id, segment, last, dg + pos, segment_size);
+}
+
+void MotDecoder::add_segment(int dg_type, uint16_t transport_id,
+        int segment, bool last, const uint8_t *data, size_t len)
+{
+    segments_t *segs = nullptr;
+
+    if (dg_type == dg_type_mot_directory) {
+        if (transport_id != m_directory_transport_id) {
+            // A new directory
+            m_memory -= m_directory.bytes;
+            m_directory = segments_t();
+            m_directory_transport_id = transport_id;
+        }
+        segs = &m_directory;
+    }
+    else {
+        object_t& obj = m_objects[transport_id];
+        obj.last_update = m_time;
+        segs = (dg_type == dg_type_mot_header) ? &obj.header : &obj.body;
+    }
+
+    // Repeated segments are only stored once
+    auto& seg = segs->segments[segment];
+    if (seg.size() != len or not equal(seg.begin(), seg.end(), data)) {
+        m_memory -= seg.size();
+        segs->bytes -= seg.size();
+        seg.assign(data, data + len);
+        m_memory += len;
+        segs->bytes += len;
+    }
+
+    if (last) {
+        segs->last_segment = segment;
+    }
+
+    m_stats.max_memory = max(m_stats.max_memory, m_memory);
+
+    if (dg_type == dg_type_mot_directory) {
+        if (m_directory.complete()) {
+            process_directory(m_directory.assemble());
+            m_memory -= m_directory.bytes;
+            m_directory = segments_t();
+        }
+    }
+    else {
+        check_object(transport_id);
+    }
+
+    evict(transport_id);
+}
+
+void MotDecoder::check_object(uint16_t transport_id)
+{
+    const auto it = m_objects.find(transport_id);
+    if (it == m_objects.end() or not it->second.body.complete()) {
+        return;
+    }
+
+    object_t& obj = it->second;
+
+    header_t header;
+    if (obj.header.complete()) {
+        const auto header_data = obj.header.assemble();
+        size_t header_size = 0;
+        if (not parse_header(header_data.data(), header_data.size(),
+                    header, header_size)) {
+            // Wait for a better header
+            m_memory -= obj.header.bytes;
+            obj.header = segments_t();
+            return;
+        }
+    }
+    else {
+        const auto dir_entry = m_directory_headers.find(transport_id);
+        if (dir_entry == m_directory_headers.end()) {
+            return;
+        }
+        header = dir_entry->second;
+    }
+
+    const auto body = obj.body.assemble();
+    m_memory -= obj.header.bytes + obj.body.bytes;
+    m_objects.erase(it);
+
+    if (body.size() != header.body_size) {
+        // Header and body of different objects
+        m_stats.objects_evicted++;
+        return;
+    }
+
+    object_complete(transport_id, header, body);
+}
+
+void MotDecoder::process_directory(const vector<uint8_t>& directory)
+{
+    const uint8_t *d = directory.data();
+    const size_t len = directory.size();
+
+    if (len < 13) {
+        m_stats.invalid_data_groups++;
+        return;
+    }
+
+    const size_t num_objects = (d[4] << 8) | d[5];
+    const size_t extension_len = (d[11] << 8) | d[12];
+    size_t pos = 13 + extension_len;
+
+    m_directory_headers.clear();
+    for (size_t i = 0; i < num_objects and pos + 2 <= len; i++) {
+        const uint16_t transport_id = (d[pos] << 8) | d[pos + 1];
+        pos += 2;
+
+        header_t header;
+        size_t header_size = 0;
+        if (not parse_header(d + pos, len - pos, header, header_size)) {
+            m_stats.invalid_data_groups++;
+            break;
+        }
+        m_directory_headers[transport_id] = header;
+        pos += header_size;
+    }
+
+    // Bodies may have been waiting for their header
+    vector<uint16_t> transport_ids;
+    for (const auto& obj : m_objects) {
+        transport_ids.push_back(obj.first);
+    }
+    for (const auto transport_id : transport_ids) {
+        check_object(transport_id);
+    }
+}
+
+void MotDecoder::object_complete(uint16_t transport_id,
+        const header_t& header, const vector<uint8_t>& body)
+{
+    m_stats.objects_completed++;
+
+    const uint64_t hash = fnv1a_hash(body);
+
+    auto& objects = m_stats.objects;
+    auto known = find_if(objects.begin(), objects.end(),
+            [&](const mot_object_info_t& o) { return o.hash == hash; });
+
+    if (known != objects.end()) {
+        // Keep the list ordered by completion time
+        mot_object_info_t info = *known;
+        objects.erase(known);
+        info.transport_id = transport_id;
+        info.times_completed++;
+        info.last_completed = m_time;
+        objects.push_back(info);
+        return;
+    }
+
+    mot_object_info_t info;
+    info.transport_id = transport_id;
+    info.name = header.name;
+    info.content_type = header.content_type;
+    info.content_subtype = header.content_subtype;
+    info.body_size = body.size();
+    info.hash = hash;
+    info.times_completed = 1;
+    info.first_completed = m_time;
+    info.last_completed = m_time;
+
+    if (objects.size() >= mot_max_tracked_objects) {
+        objects.erase(objects.begin());
+    }
+    objects.push_back(info);
+
+    if (not m_dump_prefix.empty()) {
+        char hash_str[20];
+        snprintf(hash_str, sizeof(hash_str), "%016" PRIx64, hash);
+
+        string filename = m_dump_prefix + hash_str;
+        if (not header.name.empty()) {
+            string name = header.name;
+            for (auto& c : name) {
+                if (c == '/' or (c >= 0 and c < 0x20)) {
+                    c = '_';
+                }
+            }
+            filename += "-" + name;
+        }
+
+        FILE *fd = fopen(filename.c_str(), "wb");
+        if (fd == nullptr) {
+            fprintf(stderr, "Could not open %s: %s\n",
+                    filename.c_str(), strerror(errno));
+            return;
+        }
+        if (fwrite(body.data(), 1, body.size(), fd) != body.size()) {
+            fprintf(stderr, "Write error on %s: %s\n",
+                    filename.c_str(), strerror(errno));
+        }
+        fclose(fd);
+    }
+}
+
+void MotDecoder::evict(uint16_t keep_transport_id)
+{
+    auto remove = [&](map<uint16_t, object_t>::iterator it) {
+        m_memory -= it->second.header.bytes + it->second.body.bytes;
+        m_stats.objects_evicted++;
+        return m_objects.erase(it);
+    };
+
+    for (auto it = m_objects.begin(); it != m_objects.end();) {
+        if (it->first != keep_transport_id and
+                m_time - it->second.last_update > mot_object_timeout_s) {
+            it = remove(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    if (m_directory.bytes > mot_memory_limit) {
+        m_memory -= m_directory.bytes;
+        m_directory = segments_t();
+    }
+
+    // Drop the least recently updated objects, the current one last
+    while (m_memory > mot_memory_limit and not m_objects.empty()) {
+        auto oldest = m_objects.end();
+        for (auto it = m_objects.begin(); it != m_objects.end(); ++it) {
+            if (it->first == keep_transport_id) {
+                continue;
+            }
+            if (oldest == m_objects.end() or
+                    it->second.last_update < oldest->second.last_update) {
+                oldest = it;
+            }
+        }
+
+        if (oldest == m_objects.end()) {
+            oldest = m_objects.find(keep_transport_id);
+            if (oldest == m_objects.end()) {
+                break;
+            }
+        }
+        remove(oldest);
+    }
+}
+
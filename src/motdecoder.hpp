@@ -0,0 +1,166 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    motdecoder.hpp
+        Reassemble MOT objects from MSC data groups
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+/*
+MSC data group (EN 300 401 clause 5.3.3)
+    extension flag         1
+    CRC flag               1
+    segment flag           1
+    user access flag       1
+    data group type        4  3: MOT header, 4: MOT body, 6: MOT directory
+    continuity index       4
+    repetition index       4
+    extension field       16  if extension flag
+    last                   1  if segment flag
+    segment number        15
+    rfa                    3  if user access flag
+    transport id flag      1
+    length indicator       4
+    transport id          16  if transport id flag
+    end user address
+    data field                segmentation header (repetition count 3,
+                              segment size 13), segment data
+    CRC                   16  if CRC flag
+
+MOT header core (EN 301 234 clause 6.1)
+    body size             28
+    header size           13
+    content type           6
+    content subtype        9
+followed by the header extension parameters.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// Memory for incomplete objects of one MotDecoder
+const size_t mot_memory_limit = 4 * 1024 * 1024;
+
+// Incomplete objects that received nothing for this long are dropped
+const double mot_object_timeout_s = 600;
+
+// Number of distinct completed objects in the statistics
+const size_t mot_max_tracked_objects = 32;
+
+struct mot_object_info_t {
+    uint16_t transport_id = 0;
+    std::string name; // ContentName, UTF-8
+    int content_type = 0;
+    int content_subtype = 0;
+    size_t body_size = 0;
+    uint64_t hash = 0; // FNV-1a of the body
+
+    size_t times_completed = 0;
+    double first_completed = 0; // seconds
+    double last_completed = 0;
+};
+
+std::string mot_content_type_to_string(int content_type, int content_subtype);
+
+struct mot_statistics_t {
+    size_t data_groups = 0;
+    size_t crc_errors = 0;
+    size_t invalid_data_groups = 0;
+    size_t segments = 0;
+    size_t objects_completed = 0;
+    size_t objects_evicted = 0; // incomplete, timed out or over memory limit
+    size_t max_memory = 0;
+
+    // Distinct objects, the least recently completed ones are dropped
+    std::vector<mot_object_info_t> objects;
+};
+
+/* MotDecoder reassembles MOT objects in header mode and in directory mode,
+ * using a bounded amount of memory. Every completed object is hashed, to
+ * measure how often each one is repeated, and is optionally written to a
+ * file.
+ */
+class MotDecoder {
+    public:
+        // Time in seconds of the data groups that follow
+        void set_time(double time) { m_time = time; }
+
+        /* Write new objects to files whose name is prefix followed by the
+         * hash and the content name. Nothing is written if empty. */
+        void set_dump_prefix(const std::string& prefix) { m_dump_prefix = prefix; }
+
+        // Process a complete MSC data group of len bytes
+        void process_data_group(const uint8_t *dg, size_t len);
+
+        mot_statistics_t get_statistics(void) const { return m_stats; }
+
+    private:
+        struct segments_t {
+            std::map<int, std::vector<uint8_t> > segments;
+            int last_segment = -1;
+            size_t bytes = 0;
+
+            bool complete(void) const;
+            std::vector<uint8_t> assemble(void) const;
+        };
+
+        struct header_t {
+            size_t body_size = 0;
+            int content_type = 0;
+            int content_subtype = 0;
+            std::string name;
+        };
+
+        struct object_t {
+            segments_t header;
+            segments_t body;
+            double last_update = 0;
+        };
+
+        /* Parse the header core and extension at h, of at most len
+         * bytes. The header size is returned in header_size */
+        static bool parse_header(const uint8_t *h, size_t len,
+                header_t& header, size_t& header_size);
+
+        void add_segment(int dg_type, uint16_t transport_id, int segment,
+                bool last, const uint8_t *data, size_t len);
+        void check_object(uint16_t transport_id);
+        void process_directory(const std::vector<uint8_t>& directory);
+        void object_complete(uint16_t transport_id, const header_t& header,
+                const std::vector<uint8_t>& body);
+        void evict(uint16_t keep_transport_id);
+
+        double m_time = 0;
+        std::string m_dump_prefix;
+
+        std::map<uint16_t, object_t> m_objects;
+        size_t m_memory = 0;
+
+        // Directory being assembled, and headers from the last directory
+        uint16_t m_directory_transport_id = 0;
+        segments_t m_directory;
+        std::map<uint16_t, header_t> m_directory_headers;
+
+        mot_statistics_t m_stats;
+};
+
@@ -0,0 +1,478 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    mp2snoop.cpp
+        Parse MPEG-1/2 Audio Layer II frames of DAB subchannels, and
+        estimate the audio level from the scale factors
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "mp2snoop.hpp"
+
+using namespace std;
+
+static const int bitrates_mpeg1[16] = {
+    0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, -1 };
+static const int bitrates_lsf[16] = {
+    0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, -1 };
+static const int sample_rates_mpeg1[4] = { 44100, 48000, 32000, -1 };
+static const int sample_rates_lsf[4] = { 22050, 24000, 16000, -1 };
+
+bool mp2_parse_header(const uint8_t *buf, mp2_header_t& header)
+{
+    // The MPEG-2.5 syncword 0xFFE is not used in DAB
+    if (buf[0] != 0xFF or (buf[1] & 0xF0) != 0xF0) {
+        return false;
+    }
+
+    const int layer = (buf[1] >> 1) & 0x03;
+    if (layer != 0x02) {
+        return false;
+    }
+
+    header.lsf = (buf[1] & 0x08) == 0;
+    header.protection = (buf[1] & 0x01) == 0;
+
+    const int bitrate_index = buf[2] >> 4;
+    const int sample_rate_index = (buf[2] >> 2) & 0x03;
+    header.bitrate = header.lsf ?
+        bitrates_lsf[bitrate_index] : bitrates_mpeg1[bitrate_index];
+    header.sample_rate = header.lsf ?
+        sample_rates_lsf[sample_rate_index] :
+        sample_rates_mpeg1[sample_rate_index];
+
+    if (header.bitrate <= 0 or header.sample_rate < 0) {
+        return false;
+    }
+
+    header.padding = buf[2] & 0x02;
+    header.mode = buf[3] >> 6;
+    header.mode_extension = (buf[3] >> 4) & 0x03;
+    header.emphasis = buf[3] & 0x03;
+
+    if (header.emphasis == 2) {
+        return false;
+    }
+
+    // 1152 samples per frame, both for MPEG-1 and LSF
+    header.frame_length = 144000 * header.bitrate / header.sample_rate +
+        (header.padding ? 1 : 0);
+
+    return true;
+}
+
+const char* mp2_mode_to_string(int mode)
+{
+    switch (mode) {
+        case 0: return "stereo";
+        case 1: return "joint stereo";
+        case 2: return "dual channel";
+        case 3: return "mono";
+    }
+    return "unknown";
+}
+
+/* Number of bits of the bit allocation of each subband, from the tables
+ * B.2a to B.2d of ISO/IEC 11172-3 and B.1 of ISO/IEC 13818-3 */
+struct allocation_table_t {
+    int sblimit;
+    uint8_t nbal[32];
+};
+
+static const allocation_table_t allocation_tables[5] = {
+    { 27, { 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+            3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+            2, 2, 2, 2 } },
+    { 30, { 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+            3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+            2, 2, 2, 2, 2, 2, 2 } },
+    { 8,  { 4, 4, 3, 3, 3, 3, 3, 3 } },
+    { 12, { 4, 4, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3 } },
+    { 30, { 4, 4, 4, 4, 3, 3, 3, 3, 3, 3, 3,
+            2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2 } },
+};
+
+static const allocation_table_t& select_allocation_table(
+        const mp2_header_t& header)
+{
+    if (header.lsf) {
+        return allocation_tables[4];
+    }
+
+    const int channel_bitrate = header.bitrate / header.channels();
+
+    if ((header.sample_rate == 48000 and channel_bitrate >= 56) or
+            (channel_bitrate >= 56 and channel_bitrate <= 80)) {
+        return allocation_tables[0];
+    }
+    else if (header.sample_rate != 48000 and channel_bitrate >= 96) {
+        return allocation_tables[1];
+    }
+    else if (header.sample_rate != 32000 and channel_bitrate <= 48) {
+        return allocation_tables[2];
+    }
+    return allocation_tables[3];
+}
+
+class bit_reader_t {
+    public:
+        bit_reader_t(const uint8_t *data, size_t len) :
+            m_data(data), m_len_bits(8 * len) {}
+
+        // Returns 0 and sets the overflow flag past the end
+        uint32_t read(int bits) {
+            if (m_pos + bits > m_len_bits) {
+                m_overflow = true;
+                m_pos = m_len_bits;
+                return 0;
+            }
+
+            uint32_t value = 0;
+            for (int i = 0; i < bits; i++, m_pos++) {
+                value = (value << 1) |
+                    ((m_data[m_pos / 8] >> (7 - m_pos % 8)) & 1);
+            }
+            return value;
+        }
+
+        size_t position(void) const { return m_pos; }
+        bool overflow(void) const { return m_overflow; }
+
+    private:
+        const uint8_t *m_data;
+        size_t m_len_bits;
+        size_t m_pos = 0;
+        bool m_overflow = false;
+};
+
+// CRC-16 with polynomial 0x8005 over bits [from, to) of data
+static uint16_t crc16_bits(uint16_t crc, const uint8_t *data,
+        size_t from, size_t to)
+{
+    for (size_t i = from; i < to; i++) {
+        const int bit = (data[i / 8] >> (7 - i % 8)) & 1;
+        const int msb = (crc >> 15) & 1;
+        crc <<= 1;
+        if (msb ^ bit) {
+            crc ^= 0x8005;
+        }
+    }
+    return crc;
+}
+
+// Squares of the scale factors 2^(1 - index/3), 0 for unallocated subbands
+struct scf_squares_t {
+    double values[64];
+
+    scf_squares_t() {
+        for (int i = 0; i < 63; i++) {
+            values[i] = pow(2.0, 2.0 * (1.0 - i / 3.0));
+        }
+        values[mp2_scf_unallocated] = 0;
+    }
+};
+
+static double scf_square(uint8_t index)
+{
+    static const scf_squares_t squares;
+    return squares.values[index & 0x3F];
+}
+
+void mp2_parse_frame(const uint8_t *frame, const mp2_header_t& header,
+        size_t& last_subfield_length, mp2_frame_info_t& info)
+{
+    info.header = header;
+    info.valid = false;
+    info.crc_ok = false;
+    info.xpad_length = 0;
+
+    const size_t len = header.frame_length;
+    const int channels = header.channels();
+    const allocation_table_t& table = select_allocation_table(header);
+    const int sblimit = table.sblimit;
+    const int bound = (header.mode == 1) ?
+        min(sblimit, (header.mode_extension + 1) * 4) : sblimit;
+
+    bit_reader_t br(frame, len);
+    br.read(32);
+    const uint16_t crc = header.protection ? br.read(16) : 0;
+    const size_t crc_start = br.position();
+
+    uint8_t allocation[2][32] = {};
+    for (int sb = 0; sb < sblimit; sb++) {
+        if (sb < bound) {
+            for (int ch = 0; ch < channels; ch++) {
+                allocation[ch][sb] = br.read(table.nbal[sb]);
+            }
+        }
+        else {
+            allocation[0][sb] = allocation[1][sb] = br.read(table.nbal[sb]);
+        }
+    }
+
+    uint8_t scfsi[2][32] = {};
+    for (int sb = 0; sb < sblimit; sb++) {
+        for (int ch = 0; ch < channels; ch++) {
+            if (allocation[ch][sb]) {
+                scfsi[ch][sb] = br.read(2);
+            }
+        }
+    }
+
+    if (header.protection) {
+        uint16_t calc_crc = crc16_bits(0xFFFF, frame, 16, 32);
+        calc_crc = crc16_bits(calc_crc, frame, crc_start, br.position());
+        info.crc_ok = (calc_crc == crc);
+    }
+    else {
+        info.crc_ok = true;
+    }
+
+    for (int ch = 0; ch < 2; ch++) {
+        for (int sb = 0; sb < 32; sb++) {
+            for (int part = 0; part < 3; part++) {
+                info.scf[ch][sb][part] = mp2_scf_unallocated;
+            }
+        }
+    }
+
+    for (int sb = 0; sb < sblimit; sb++) {
+        for (int ch = 0; ch < channels; ch++) {
+            if (allocation[ch][sb] == 0) {
+                continue;
+            }
+
+            uint8_t *s = info.scf[ch][sb];
+            switch (scfsi[ch][sb]) {
+                case 0:
+                    s[0] = br.read(6);
+                    s[1] = br.read(6);
+                    s[2] = br.read(6);
+                    break;
+                case 1:
+                    s[0] = s[1] = br.read(6);
+                    s[2] = br.read(6);
+                    break;
+                case 2:
+                    s[0] = s[1] = s[2] = br.read(6);
+                    break;
+                case 3:
+                    s[0] = br.read(6);
+                    s[1] = s[2] = br.read(6);
+                    break;
+            }
+        }
+    }
+
+    info.side_info_length = (br.position() + 7) / 8;
+
+    const size_t pad_overhead = header.lsf or
+        header.bitrate / channels < 56 ? 2 : 4;
+    if (br.overflow() or info.side_info_length + 2 + pad_overhead > len) {
+        return;
+    }
+    info.valid = true;
+
+    /* The levels of the parts of 384 samples. The scale factor is the
+     * peak of the subband samples, the mean square of a sine is half of
+     * its squared peak, and the subbands add up in power. */
+    for (int ch = 0; ch < 2; ch++) {
+        for (int part = 0; part < 3; part++) {
+            double ms = 0;
+            if (ch < channels) {
+                for (int sb = 0; sb < sblimit; sb++) {
+                    ms += scf_square(info.scf[ch][sb][part]) / 2;
+                }
+            }
+            info.mean_square[ch][part] = min(ms, 1.0);
+        }
+    }
+
+    // PAD
+    info.fpad[0] = frame[len - 2];
+    info.fpad[1] = frame[len - 1];
+    info.scf_crc_length = pad_overhead;
+    info.scf_crc_offset = len - 2 - pad_overhead;
+
+    const int xpad_ind = (info.fpad[0] >> 4) & 0x03;
+    const bool ci_flag = info.fpad[1] & 0x02;
+    const size_t xpad_end = info.scf_crc_offset;
+    const size_t xpad_max = xpad_end - info.side_info_length;
+
+    size_t xpad_length = 0;
+    if (xpad_ind == 1) {
+        // Short X-PAD
+        xpad_length = 4;
+        last_subfield_length = ci_flag ? 3 : 4;
+    }
+    else if (xpad_ind == 2) {
+        // Variable size X-PAD, with the contents indicators first
+        if (ci_flag) {
+            size_t num_ci = 0;
+            size_t data_length = 0;
+            size_t subfield_length = 0;
+            while (num_ci < 4 and num_ci < xpad_max) {
+                const uint8_t ci = frame[xpad_end - 1 - num_ci];
+                num_ci++;
+
+                if ((ci & 0x1F) == 0) {
+                    // End marker
+                    break;
+                }
+                subfield_length = xpad_subfield_lengths[ci >> 5];
+                data_length += subfield_length;
+            }
+            xpad_length = num_ci + data_length;
+            last_subfield_length = subfield_length;
+        }
+        else {
+            xpad_length = last_subfield_length;
+        }
+    }
+
+    if (xpad_length <= xpad_max) {
+        info.xpad_length = xpad_length;
+        info.xpad_offset = xpad_end - xpad_length;
+    }
+}
+
+void Mp2Snoop::push(const uint8_t *streamdata, size_t streamsize)
+{
+    m_buffer.insert(m_buffer.end(), streamdata, streamdata + streamsize);
+
+    while (m_buffer.size() - m_pos >= 4) {
+        const size_t available = m_buffer.size() - m_pos;
+        const uint8_t *p = m_buffer.data() + m_pos;
+
+        mp2_header_t header;
+        if (not mp2_parse_header(p, header)) {
+            if (m_locked) {
+                m_locked = false;
+                m_stats.sync_losses++;
+            }
+            m_pos++;
+            continue;
+        }
+
+        if (not m_locked) {
+            // Confirm the sync with the header of the following frame
+            if (available < header.frame_length + 4) {
+                break;
+            }
+
+            mp2_header_t next;
+            if (not mp2_parse_header(p + header.frame_length, next) or
+                    next.lsf != header.lsf or
+                    next.sample_rate != header.sample_rate or
+                    next.bitrate != header.bitrate) {
+                m_pos++;
+                continue;
+            }
+
+            m_locked = true;
+        }
+
+        if (available < header.frame_length) {
+            break;
+        }
+
+        analyse_frame(p, header);
+        m_pos += header.frame_length;
+    }
+
+    // Discard the consumed data once in a while, the frames are small
+    if (m_pos > 16384 or m_pos == m_buffer.size()) {
+        m_buffer.erase(m_buffer.begin(), m_buffer.begin() + m_pos);
+        m_bytes_discarded += m_pos;
+        m_pos = 0;
+    }
+}
+
+void Mp2Snoop::analyse_frame(const uint8_t *frame, const mp2_header_t& header)
+{
+    mp2_frame_info_t& info = m_frame_info;
+    mp2_parse_frame(frame, header, m_last_subfield_length, info);
+
+    if (not info.valid) {
+        return;
+    }
+
+    m_stats.frames++;
+    m_stats.last_header = header;
+
+    // The PAD is not covered by the CRC
+    const size_t position = m_bytes_discarded + (frame - m_buffer.data());
+    pad.set_time(8.0 * position / (header.bitrate * 1000));
+    pad.process(frame + info.xpad_offset, info.xpad_length, info.fpad);
+
+    events.update(audio_event_e::CRC, not info.crc_ok);
+    if (not info.crc_ok) {
+        // The scale factors cannot be trusted
+        m_stats.crc_errors++;
+        return;
+    }
+
+    const double silence_threshold =
+        pow(10.0, mp2_silence_threshold_dB / 10.0);
+    bool silent = true;
+
+    channel_levels_t *levels[2] = {&m_levels.left, &m_levels.right};
+    const int channels = header.channels();
+    const double full_scale = 32768.0;
+    const size_t part_samples = 384;
+
+    for (int ch = 0; ch < channels; ch++) {
+        channel_levels_t& l = *levels[ch];
+        for (int part = 0; part < 3; part++) {
+            const double ms = info.mean_square[ch][part];
+            const double rms = sqrt(ms);
+
+            l.num_samples += part_samples;
+            l.sum_squares += llround(ms * full_scale * full_scale * part_samples);
+
+            // Mean absolute value and peak of a sine of that RMS
+            l.sum_abs += llround(2 * M_SQRT2 / M_PI * rms * full_scale * part_samples);
+            const double peak = min(M_SQRT2 * rms * full_scale, 32767.0);
+            l.peak = max(l.peak, (int16_t)lrint(peak));
+
+            if (ms >= silence_threshold) {
+                silent = false;
+            }
+        }
+    }
+
+    if (silent) {
+        m_stats.silent_frames++;
+    }
+    events.update(audio_event_e::SILENCE, silent);
+}
+
+audio_statistics_t Mp2Snoop::get_audio_statistics() const
+{
+    audio_statistics_t stats;
+    stats.total = m_levels;
+    stats.loudness.integrated = -HUGE_VAL;
+    stats.loudness.max_momentary = -HUGE_VAL;
+    stats.loudness.max_short_term = -HUGE_VAL;
+    stats.loudness.true_peak = -HUGE_VAL;
+    return stats;
+}
+
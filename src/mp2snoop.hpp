@@ -0,0 +1,166 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    mp2snoop.hpp
+        Parse MPEG-1/2 Audio Layer II frames of DAB subchannels, and
+        estimate the audio level from the scale factors
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+/*
+DAB audio frames (EN 300 401 clause 7, ISO/IEC 11172-3 and 13818-3)
+
+header                    32
+    syncword              12  0xFFF
+    ID                     1  1: MPEG-1 48kHz, 0: MPEG-2 LSF 24kHz
+    layer                  2  '10' for Layer II
+    protection_bit         1  0 if the CRC is present
+    bitrate_index          4
+    sampling_frequency     2
+    padding_bit            1
+    private_bit            1
+    mode                   2  stereo, joint stereo, dual channel, mono
+    mode_extension         2
+    copyright              1
+    original/home          1
+    emphasis               2
+crc_check                 16  over the last 16 header bits, the bit
+                              allocation and the scfsi
+bit allocation, scfsi, scale factors, samples
+
+The end of each DAB audio frame carries, from the end backwards:
+    F-PAD                 16
+    ScF-CRC               16 or 32
+    X-PAD                     bytes in reverse order
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "audioevents.hpp"
+#include "faad_decoder.hpp"
+#include "paddecoder.hpp"
+
+struct mp2_header_t {
+    bool lsf = false;           // MPEG-2 low sampling frequency
+    bool protection = false;    // CRC present
+    int bitrate = 0;            // kbps
+    int sample_rate = 0;
+    bool padding = false;
+    int mode = 0;
+    int mode_extension = 0;
+    int emphasis = 0;
+    size_t frame_length = 0;    // bytes
+
+    int channels(void) const { return mode == 3 ? 1 : 2; }
+};
+
+/* Parse the four header bytes at buf. Returns false if they are not
+ * a Layer II header, or use the free format. */
+bool mp2_parse_header(const uint8_t *buf, mp2_header_t& header);
+
+const char* mp2_mode_to_string(int mode);
+
+// Scale factor index of a subband that has no bits allocated
+const uint8_t mp2_scf_unallocated = 63;
+
+struct mp2_frame_info_t {
+    mp2_header_t header;
+
+    // False if the frame is too short for its side information
+    bool valid = false;
+    bool crc_ok = false;
+
+    /* Scale factor indices per channel, subband and part of 12 samples,
+     * mp2_scf_unallocated for subbands without bits */
+    uint8_t scf[2][32][3];
+
+    /* Mean square of each part of 384 samples, relative to full scale,
+     * estimated from the scale factors */
+    double mean_square[2][3];
+
+    // Size of the side information, the audio samples follow
+    size_t side_info_length = 0;
+
+    // Position of the ScF-CRC and of the X-PAD, whose bytes are reversed
+    size_t scf_crc_offset = 0;
+    size_t scf_crc_length = 0;
+    size_t xpad_offset = 0;
+    size_t xpad_length = 0;     // 0 without X-PAD or if unknown
+
+    // The two F-PAD bytes at the end of the frame
+    uint8_t fpad[2] = {0, 0};
+};
+
+/* Parse the side information of the frame of length frame_length at
+ * frame. The X-PAD length of a variable size X-PAD without contents
+ * indicator continues the last data subfield of the previous frame,
+ * whose length is given in and updated through last_subfield_length. */
+void mp2_parse_frame(const uint8_t *frame, const mp2_header_t& header,
+        size_t& last_subfield_length, mp2_frame_info_t& info);
+
+// Level below which a frame counts as silent
+const int mp2_silence_threshold_dB = silence_threshold_dB;
+
+struct mp2_statistics_t {
+    size_t frames = 0;
+    size_t crc_errors = 0;
+    size_t silent_frames = 0;
+    size_t sync_losses = 0;
+
+    mp2_header_t last_header;
+};
+
+/* Mp2Snoop synchronises to the Layer II frames of a DAB subchannel, and
+ * accumulates level estimates. It does not decode the audio, the levels
+ * only depend on the scale factors, assuming sine-like subband signals.
+ */
+class Mp2Snoop {
+    public:
+        void push(const uint8_t *streamdata, size_t streamsize);
+
+        // Frames that contained at least a valid side information
+        size_t num_frames(void) const { return m_stats.frames; }
+
+        // The levels are estimates, there is no loudness measurement
+        audio_statistics_t get_audio_statistics(void) const;
+
+        mp2_statistics_t get_statistics(void) const { return m_stats; }
+
+        PadDecoder pad;
+
+        // CRC errors and silence of the frames
+        AudioEventDetector events;
+
+    private:
+        void analyse_frame(const uint8_t *frame, const mp2_header_t& header);
+
+        std::vector<uint8_t> m_buffer;
+        size_t m_pos = 0;
+        size_t m_bytes_discarded = 0; // Before m_buffer, gives the time
+
+        bool m_locked = false;
+        size_t m_last_subfield_length = 0;
+        mp2_frame_info_t m_frame_info;
+
+        mp2_statistics_t m_stats;
+        audio_levels_t m_levels;
+};
+
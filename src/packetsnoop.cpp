@@ -0,0 +1,203 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    packetsnoop.cpp
+        Demultiplex packet mode data subchannels
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#include <stdio.h>
+#include "packetsnoop.hpp"
+extern "C" {
+#include "lib_crc.h"
+}
+
+using namespace std;
+
+static const size_t packet_lengths[4] = {24, 48, 72, 96};
+
+// Packet header and CRC around the packet data field
+static const size_t packet_overhead = 5;
+
+static uint16_t crc_ccitt(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc = update_crc_ccitt(crc, data[i]);
+    }
+    return ~crc;
+}
+
+void PacketSnoop::push(const uint8_t *streamdata, size_t streamsize)
+{
+    m_stats.frames++;
+    m_frame_utilisation = utilisation_t();
+
+    size_t pos = 0;
+    while (pos < streamsize) {
+        const size_t packet_len = packet_lengths[streamdata[pos] >> 6];
+        if (pos + packet_len > streamsize) {
+            m_stats.truncated_packets++;
+            m_frame_utilisation.unknown += streamsize - pos;
+            break;
+        }
+
+        process_packet(streamdata + pos, packet_len);
+        pos += packet_len;
+    }
+
+    m_utilisation.add(m_frame_utilisation, 1);
+}
+
+void PacketSnoop::process_packet(const uint8_t *packet, size_t packet_len)
+{
+    m_stats.packets++;
+
+    const uint16_t crc = (packet[packet_len - 2] << 8) | packet[packet_len - 1];
+    if (crc_ccitt(packet, packet_len - 2) != crc) {
+        // The address cannot be trusted
+        m_stats.crc_errors++;
+        m_frame_utilisation.unknown += packet_len;
+        return;
+    }
+
+    const int continuity_index = (packet[0] >> 4) & 0x03;
+    const bool first = packet[0] & 0x08;
+    const bool last = packet[0] & 0x04;
+    const int address = ((packet[0] & 0x03) << 8) | packet[1];
+    const bool command = packet[2] & 0x80;
+    const size_t useful_len = packet[2] & 0x7F;
+
+    if (address == 0) {
+        m_stats.padding_packets++;
+        m_frame_utilisation.padding += packet_len;
+        return;
+    }
+
+    address_t& addr = m_addresses[address];
+    auto& stats = addr.stats;
+    stats.packets++;
+    stats.bytes += packet_len;
+
+    if (addr.last_continuity_index != -1 and
+            continuity_index != ((addr.last_continuity_index + 1) & 0x03)) {
+        stats.continuity_errors++;
+
+        if (addr.receiving) {
+            // Packets of this data group were lost
+            stats.incomplete_data_groups++;
+            addr.receiving = false;
+        }
+    }
+    addr.last_continuity_index = continuity_index;
+
+    m_frame_utilisation.overhead += packet_overhead;
+
+    if (useful_len > packet_len - packet_overhead) {
+        m_frame_utilisation.unknown += packet_len - packet_overhead;
+        if (addr.receiving) {
+            stats.incomplete_data_groups++;
+            addr.receiving = false;
+        }
+        return;
+    }
+    stats.useful_bytes += useful_len;
+    m_frame_utilisation.payload += useful_len;
+    m_frame_utilisation.padding += packet_len - packet_overhead - useful_len;
+
+    if (command) {
+        return;
+    }
+
+    if (first) {
+        if (addr.receiving) {
+            stats.incomplete_data_groups++;
+        }
+        addr.receiving = true;
+        addr.data_group.clear();
+    }
+    else if (not addr.receiving) {
+        // Start of the data group missed
+        return;
+    }
+
+    const uint8_t *data = packet + 3;
+    if (addr.data_group.size() + useful_len > max_data_group_size) {
+        stats.incomplete_data_groups++;
+        addr.receiving = false;
+        return;
+    }
+    addr.data_group.insert(addr.data_group.end(), data, data + useful_len);
+
+    if (last) {
+        addr.receiving = false;
+        process_data_group(address, addr);
+    }
+}
+
+void PacketSnoop::process_data_group(int address, address_t& addr)
+{
+    auto& stats = addr.stats;
+    const auto& dg = addr.data_group;
+
+    if (dg.size() < 2) {
+        stats.incomplete_data_groups++;
+        return;
+    }
+
+    stats.data_groups++;
+
+    const bool crc_flag = dg[0] & 0x40;
+    const int dg_type = dg[0] & 0x0F;
+
+    if (crc_flag) {
+        const size_t len = dg.size();
+        if (len < 4 or crc_ccitt(dg.data(), len - 2) !=
+                ((dg[len - 2] << 8) | dg[len - 1])) {
+            stats.data_group_crc_errors++;
+            return;
+        }
+    }
+
+    // Types 3 to 7 are used by MOT
+    if (dg_type >= 3 and dg_type <= 7) {
+        if (not stats.mot_found) {
+            stats.mot_found = true;
+            if (not m_mot_dump_prefix.empty()) {
+                addr.mot.set_dump_prefix(
+                        m_mot_dump_prefix + to_string(address) + "-");
+            }
+        }
+        addr.mot.set_time(m_stats.frames * 0.024);
+        addr.mot.process_data_group(dg.data(), dg.size());
+    }
+}
+
+packet_statistics_t PacketSnoop::get_statistics() const
+{
+    packet_statistics_t stats = m_stats;
+    for (const auto& addr : m_addresses) {
+        auto& addr_stats = stats.addresses[addr.first];
+        addr_stats = addr.second.stats;
+        if (addr_stats.mot_found) {
+            addr_stats.mot = addr.second.mot.get_statistics();
+        }
+    }
+    return stats;
+}
+
@@ -0,0 +1,131 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    packetsnoop.hpp
+        Demultiplex packet mode data subchannels
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+/*
+Packet (EN 300 401 clause 5.3.2)
+    packet length          2  00: 24, 01: 48, 10: 72, 11: 96 bytes
+    continuity index       2  incremented for each packet of the address
+    first, last            2  10: first, 00: intermediate, 01: last,
+                              11: one and only packet of the data group
+    address               10  0 is used for padding packets
+    command                1  0: data
+    useful data length     7
+    packet data field         useful data, then padding
+    CRC                   16  CRC-CCITT over all the preceding bytes
+
+Each logical frame of the subchannel holds an integer number of packets.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "motdecoder.hpp"
+#include "utilisation.hpp"
+
+struct packet_address_statistics_t {
+    size_t packets = 0;
+    size_t bytes = 0; // Whole packets
+    size_t useful_bytes = 0;
+    size_t continuity_errors = 0;
+
+    size_t data_groups = 0;
+    size_t data_group_crc_errors = 0;
+    size_t incomplete_data_groups = 0;
+
+    // MOT statistics, if data groups of a MOT type were received
+    bool mot_found = false;
+    mot_statistics_t mot;
+};
+
+struct packet_statistics_t {
+    size_t frames = 0; // 24ms logical frames
+    size_t packets = 0;
+    size_t crc_errors = 0;
+    size_t padding_packets = 0;
+    size_t truncated_packets = 0; // Not ending within the logical frame
+
+    std::map<int /* address */, packet_address_statistics_t> addresses;
+
+    // Bitrate in kbit/s of the given number of bytes
+    double bitrate(size_t bytes) const {
+        return frames > 0 ? bytes * 8.0 / (frames * 24) : 0;
+    }
+};
+
+/* PacketSnoop splits each logical frame of a packet mode subchannel into
+ * packets, and reassembles the MSC data groups of every address. Data
+ * groups of the types used by MOT are given to a MotDecoder for that
+ * address. */
+class PacketSnoop {
+    public:
+        // Process one logical frame of the subchannel
+        void push(const uint8_t *streamdata, size_t streamsize);
+
+        /* MOT objects are written to files whose name starts with prefix,
+         * followed by the address. Nothing is written if empty. */
+        void set_mot_dump_prefix(const std::string& prefix) {
+            m_mot_dump_prefix = prefix;
+        }
+
+        // Packets with a correct CRC received so far
+        size_t num_valid_packets(void) const {
+            return m_stats.packets - m_stats.crc_errors;
+        }
+
+        packet_statistics_t get_statistics(void) const;
+
+        utilisation_statistics_t get_utilisation_statistics(void) const {
+            return m_utilisation.get_statistics();
+        }
+
+    private:
+        // Largest MSC data group: headers, 8191 bytes of data and CRC
+        static const size_t max_data_group_size = 8191 + 16;
+
+        struct address_t {
+            int last_continuity_index = -1;
+
+            // Data group being received, only valid if receiving is set
+            bool receiving = false;
+            std::vector<uint8_t> data_group;
+
+            MotDecoder mot;
+            packet_address_statistics_t stats;
+        };
+
+        void process_packet(const uint8_t *packet, size_t packet_len);
+        void process_data_group(int address, address_t& addr);
+
+        std::map<int, address_t> m_addresses;
+        std::string m_mot_dump_prefix;
+        packet_statistics_t m_stats;
+
+        // Of the frame being processed, and of the whole run
+        utilisation_t m_frame_utilisation;
+        UtilisationTracker m_utilisation;
+};
+
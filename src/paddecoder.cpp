@@ -0,0 +1,477 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    paddecoder.cpp
+        Demultiplex the X-PAD of DAB and DAB+ audio, decode the Dynamic
+        Label with DL Plus, and pass the MOT data groups on
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#include <stdio.h>
+#include <algorithm>
+#include "paddecoder.hpp"
+#include "charset.hpp"
+extern "C" {
+#include "lib_crc.h"
+}
+
+#define PAD_PREFIX "PAD:"
+
+using namespace std;
+
+const size_t xpad_subfield_lengths[8] = { 4, 6, 8, 12, 16, 24, 32, 48 };
+
+// ETSI TS 102 980 Annex A
+static const char *dl_plus_content_types[64] = {
+    "DUMMY",                "ITEM.TITLE",
+    "ITEM.ALBUM",           "ITEM.TRACKNUMBER",
+    "ITEM.ARTIST",          "ITEM.COMPOSITION",
+    "ITEM.MOVEMENT",        "ITEM.CONDUCTOR",
+    "ITEM.COMPOSER",        "ITEM.BAND",
+    "ITEM.COMMENT",         "ITEM.GENRE",
+    "INFO.NEWS",            "INFO.NEWS.LOCAL",
+    "INFO.STOCKMARKET",     "INFO.SPORT",
+    "INFO.LOTTERY",         "INFO.HOROSCOPE",
+    "INFO.DAILY_DIVERSION", "INFO.HEALTH",
+    "INFO.EVENT",           "INFO.SCENE",
+    "INFO.CINEMA",          "INFO.STUPIDITY_MACHINE",
+    "INFO.DATE_TIME",       "INFO.WEATHER",
+    "INFO.TRAFFIC",         "INFO.ALARM",
+    "INFO.ADVERTISEMENT",   "INFO.URL",
+    "INFO.OTHER",           "STATIONNAME.SHORT",
+    "STATIONNAME.LONG",     "PROGRAMME.NOW",
+    "PROGRAMME.NEXT",       "PROGRAMME.PART",
+    "PROGRAMME.HOST",       "PROGRAMME.EDITORIAL_STAFF",
+    "PROGRAMME.FREQUENCY",  "PROGRAMME.HOMEPAGE",
+    "PROGRAMME.SUBCHANNEL", "PHONE.HOTLINE",
+    "PHONE.STUDIO",         "PHONE.OTHER",
+    "SMS.STUDIO",           "SMS.OTHER",
+    "EMAIL.HOTLINE",        "EMAIL.STUDIO",
+    "EMAIL.OTHER",          "MMS.OTHER",
+    "CHAT",                 "CHAT.CENTRE",
+    "VOTE.QUESTION",        "VOTE.CENTRE",
+    "rfu",                  "rfu",
+    "PRIVATE_1",            "PRIVATE_2",
+    "PRIVATE_3",            "DESCRIPTOR.PLACE",
+    "DESCRIPTOR.APPOINTMENT", "DESCRIPTOR.IDENTIFIER",
+    "DESCRIPTOR.PURCHASE",  "DESCRIPTOR.GET_DATA",
+};
+
+const char* dl_plus_content_type_to_string(int content_type)
+{
+    if (content_type < 0 or content_type >= 64) {
+        return "rfu";
+    }
+    return dl_plus_content_types[content_type];
+}
+
+// Extract len characters starting at character start from a UTF-8 string
+static string utf8_substr(const string& str, size_t start, size_t len)
+{
+    size_t begin = str.size();
+    size_t end = str.size();
+    size_t index = 0;
+    for (size_t i = 0; i < str.size(); i++) {
+        if ((str[i] & 0xC0) == 0x80) {
+            // Continuation byte
+            continue;
+        }
+
+        if (index == start) {
+            begin = i;
+        }
+        if (index == start + len) {
+            end = i;
+            break;
+        }
+        index++;
+    }
+
+    if (begin >= end) {
+        return "";
+    }
+    return str.substr(begin, end - begin);
+}
+
+void PadDecoder::process(const uint8_t *xpad, size_t xpad_len,
+        const uint8_t *fpad)
+{
+    m_stats.pads++;
+
+    const int fpad_type = fpad[0] >> 6;
+    const int xpad_ind = (fpad[0] >> 4) & 0x03;
+    const bool ci_flag = fpad[1] & 0x02;
+
+    if (fpad_type != 0 or xpad_ind == 0 or xpad_len == 0) {
+        return;
+    }
+
+    m_stats.xpads++;
+
+    // The X-PAD is reversed, its first byte is at the end
+    auto xpad_byte = [&](size_t i) { return xpad[xpad_len - 1 - i]; };
+
+    if (not ci_flag) {
+        // Continuation of the last data subfield
+        if (m_last_appty == -1) {
+            return;
+        }
+
+        int appty = m_last_appty;
+        if (appty == xpad_appty_dl_start) {
+            appty = xpad_appty_dl_continuation;
+        }
+        else if (appty == xpad_appty_mot_start) {
+            appty = xpad_appty_mot_continuation;
+        }
+        process_subfield(appty, xpad, xpad_len, 0, xpad_len);
+    }
+    else if (xpad_ind == 1) {
+        // Short X-PAD: one CI and three bytes
+        if (xpad_len < 4) {
+            return;
+        }
+        process_subfield(xpad_byte(0) & 0x1F, xpad, xpad_len, 1, 3);
+    }
+    else {
+        int apptys[4];
+        size_t lengths[4];
+        size_t num_subfields = 0;
+
+        size_t offset = 0;
+        while (offset < 4 and offset < xpad_len) {
+            const uint8_t ci = xpad_byte(offset++);
+            const int appty = ci & 0x1F;
+            if (appty == 0) {
+                // End marker
+                break;
+            }
+            apptys[num_subfields] = appty;
+            lengths[num_subfields] = xpad_subfield_lengths[ci >> 5];
+            num_subfields++;
+        }
+
+        for (size_t i = 0; i < num_subfields and offset < xpad_len; i++) {
+            const size_t length = min(lengths[i], xpad_len - offset);
+            process_subfield(apptys[i], xpad, xpad_len, offset, length);
+            offset += length;
+        }
+    }
+}
+
+void PadDecoder::process_subfield(int appty, const uint8_t *xpad,
+        size_t xpad_len, size_t offset, size_t length)
+{
+    m_stats.xpad_bytes[appty] += length;
+
+    vector<uint8_t> *dg = nullptr;
+
+    switch (appty) {
+        case xpad_appty_dgli:
+            if (m_last_appty != xpad_appty_dgli or m_dgli.size() >= 4) {
+                m_dgli.clear();
+            }
+            dg = &m_dgli;
+            break;
+        case xpad_appty_dl_start:
+            m_dl_data_group.clear();
+            dg = &m_dl_data_group;
+            break;
+        case xpad_appty_dl_continuation:
+            if (m_dl_data_group.empty()) {
+                // Start of the data group missed, or padding
+                break;
+            }
+            dg = &m_dl_data_group;
+            break;
+        case xpad_appty_mot_start:
+            m_mot_data_group.clear();
+            if (m_mot_data_group_length > 0) {
+                dg = &m_mot_data_group;
+            }
+            break;
+        case xpad_appty_mot_continuation:
+            if (m_mot_data_group.empty()) {
+                break;
+            }
+            dg = &m_mot_data_group;
+            break;
+    }
+
+    m_last_appty = appty;
+
+    if (dg == nullptr) {
+        return;
+    }
+
+    for (size_t i = offset; i < offset + length; i++) {
+        dg->push_back(xpad[xpad_len - 1 - i]);
+    }
+
+    switch (appty) {
+        case xpad_appty_dgli:
+            process_dgli();
+            break;
+        case xpad_appty_dl_start:
+        case xpad_appty_dl_continuation:
+            process_dl_data_group();
+            break;
+        case xpad_appty_mot_start:
+        case xpad_appty_mot_continuation:
+            if (m_mot_data_group.size() >= m_mot_data_group_length) {
+                m_mot.process_data_group(m_mot_data_group.data(),
+                        m_mot_data_group_length);
+
+                // Each data group needs its own length indicator
+                m_mot_data_group.clear();
+                m_mot_data_group_length = 0;
+            }
+            break;
+    }
+}
+
+void PadDecoder::process_dgli()
+{
+    if (m_dgli.size() < 4) {
+        return;
+    }
+
+    uint16_t crc = 0xFFFF;
+    crc = update_crc_ccitt(crc, m_dgli[0]);
+    crc = update_crc_ccitt(crc, m_dgli[1]);
+    crc = ~crc;
+
+    if (crc == ((m_dgli[2] << 8) | m_dgli[3])) {
+        m_mot_data_group_length = ((m_dgli[0] & 0x3F) << 8) | m_dgli[1];
+    }
+    else {
+        m_stats.dgli_crc_errors++;
+        m_mot_data_group_length = 0;
+    }
+}
+
+pad_statistics_t PadDecoder::get_statistics() const
+{
+    pad_statistics_t stats = m_stats;
+    stats.mot = m_mot.get_statistics();
+    return stats;
+}
+
+void PadDecoder::process_dl_data_group()
+{
+    const auto& dg = m_dl_data_group;
+    if (dg.size() < 2) {
+        return;
+    }
+
+    const bool command = dg[0] & 0x10;
+    size_t field_len = 0;
+    if (not command) {
+        field_len = (dg[0] & 0x0F) + 1;
+    }
+    else if ((dg[0] & 0x0F) == 0x02) {
+        // DL Plus command
+        field_len = (dg[1] & 0x0F) + 1;
+    }
+
+    // prefix, field and CRC
+    const size_t dg_len = 2 + field_len + 2;
+    if (dg.size() < dg_len) {
+        return;
+    }
+
+    m_stats.dl_data_groups++;
+
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < dg_len - 2; i++) {
+        crc = update_crc_ccitt(crc, dg[i]);
+    }
+    crc = ~crc;
+
+    const uint16_t dg_crc = (dg[dg_len - 2] << 8) | dg[dg_len - 1];
+    if (crc != dg_crc) {
+        m_stats.dl_crc_errors++;
+    }
+    else if (not command) {
+        process_dl_segment(dg.data(), field_len);
+    }
+    else if ((dg[0] & 0x0F) == 0x01) {
+        remove_label();
+    }
+    else if ((dg[0] & 0x0F) == 0x02) {
+        m_dl_plus_link = dg[1] >> 7;
+        m_dl_plus_command.assign(dg.begin() + 2, dg.begin() + 2 + field_len);
+        apply_dl_plus();
+    }
+
+    // The rest of the data subfield is padding
+    m_dl_data_group.clear();
+}
+
+void PadDecoder::process_dl_segment(const uint8_t *dg, size_t field_len)
+{
+    const int toggle = dg[0] >> 7;
+    const bool first = dg[0] & 0x40;
+    const bool last = dg[0] & 0x20;
+    const int segment = first ? 0 : (dg[1] >> 4) & 0x07;
+
+    const uint8_t *chars = dg + 2;
+
+    if (toggle != m_dl_toggle) {
+        m_dl_toggle = toggle;
+        m_dl_segments.clear();
+        m_dl_last_segment = -1;
+        m_dl_complete = false;
+    }
+    else if (m_dl_complete) {
+        const auto& known = m_dl_segments[segment];
+        if (known.size() == field_len and
+                equal(known.begin(), known.end(), chars)) {
+            // Repetition of the current label
+            return;
+        }
+
+        // Changed without toggle, start again
+        m_dl_segments.clear();
+        m_dl_last_segment = -1;
+        m_dl_complete = false;
+    }
+
+    if (first) {
+        m_dl_charset = dg[1] >> 4;
+    }
+    if (last) {
+        m_dl_last_segment = segment;
+    }
+    m_dl_segments[segment].assign(chars, chars + field_len);
+
+    if (m_dl_last_segment == -1) {
+        return;
+    }
+
+    vector<uint8_t> label_bytes;
+    for (int i = 0; i <= m_dl_last_segment; i++) {
+        const auto seg = m_dl_segments.find(i);
+        if (seg == m_dl_segments.end()) {
+            return;
+        }
+        label_bytes.insert(label_bytes.end(),
+                seg->second.begin(), seg->second.end());
+    }
+    m_dl_complete = true;
+
+    string text;
+    switch (m_dl_charset) {
+        case 15: // UTF-8
+            text.assign(label_bytes.begin(), label_bytes.end());
+            break;
+        case 6: // UCS-2
+            convert_ucs2_to_utf8(label_bytes.data(), label_bytes.size(), text);
+            break;
+        default:
+            convert_ebu_to_utf8(label_bytes.data(), label_bytes.size(), text);
+            break;
+    }
+
+    auto& label = m_stats.label;
+    if (text != label.text) {
+        label.text = text;
+        label.tags.clear();
+        m_stats.dl_changes++;
+        printf(PAD_PREFIX " subchannel %d DLS: %s\n", subchid, text.c_str());
+    }
+
+    apply_dl_plus();
+}
+
+void PadDecoder::remove_label()
+{
+    m_dl_toggle = -1;
+    m_dl_segments.clear();
+    m_dl_last_segment = -1;
+    m_dl_complete = false;
+    m_dl_plus_command.clear();
+
+    auto& label = m_stats.label;
+    if (not label.text.empty() or not label.tags.empty()) {
+        label = dynamic_label_t();
+        m_stats.dl_changes++;
+        printf(PAD_PREFIX " subchannel %d DLS removed\n", subchid);
+    }
+}
+
+void PadDecoder::apply_dl_plus()
+{
+    if (not m_dl_complete or m_dl_plus_link != m_dl_toggle or
+            m_dl_plus_command.empty()) {
+        return;
+    }
+
+    const auto& cmd = m_dl_plus_command;
+
+    // Only the DL Plus tags command is defined
+    if ((cmd[0] >> 4) != 0) {
+        return;
+    }
+
+    const size_t num_tags = (cmd[0] & 0x03) + 1;
+    if (cmd.size() < 1 + 3 * num_tags) {
+        return;
+    }
+
+    auto& label = m_stats.label;
+
+    vector<dl_plus_tag_t> tags;
+    for (size_t i = 0; i < num_tags; i++) {
+        const uint8_t *t = &cmd[1 + 3 * i];
+
+        dl_plus_tag_t tag;
+        tag.content_type = t[0] & 0x7F;
+        if (tag.content_type == 0) {
+            continue;
+        }
+
+        const size_t start = t[1] & 0x7F;
+        const size_t length = (t[2] & 0x7F) + 1;
+        tag.text = utf8_substr(label.text, start, length);
+        tags.push_back(tag);
+    }
+
+    const bool item_toggle = cmd[0] & 0x08;
+    const bool item_running = cmd[0] & 0x04;
+
+    if (tags == label.tags and item_toggle == label.item_toggle and
+            item_running == label.item_running) {
+        return;
+    }
+
+    label.tags = tags;
+    label.item_toggle = item_toggle;
+    label.item_running = item_running;
+    m_stats.dl_plus_changes++;
+
+    string desc;
+    for (const auto& tag : label.tags) {
+        desc += string(" ") +
+            dl_plus_content_type_to_string(tag.content_type) +
+            "=\"" + tag.text + "\"";
+    }
+    printf(PAD_PREFIX " subchannel %d DL Plus%s:%s\n", subchid,
+            item_running ? "" : " (item stopped)", desc.c_str());
+}
+
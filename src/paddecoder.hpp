@@ -0,0 +1,181 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    paddecoder.hpp
+        Demultiplex the X-PAD of DAB and DAB+ audio, decode the Dynamic
+        Label with DL Plus, and pass the MOT data groups on
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+/*
+PAD (EN 300 401 clause 7.4)
+
+The PAD of a DAB audio frame is at its end, that of a DAB+ AU in a
+data_stream_element at the start of the AU. In both cases, the X-PAD comes
+first, with its bytes in reverse order, and is followed by the two F-PAD
+bytes:
+
+F-PAD byte L-1
+    F-PAD type             2  00
+    X-PAD Ind              2  00: none, 01: short (4 bytes), 10: variable
+    Byte L-1 Indicator     4
+F-PAD byte L
+    Byte L data field      6
+    CI flag                1  X-PAD starts with contents indicators
+    Z                      1
+
+Short X-PAD: CI (AppTy), three bytes of data
+Variable X-PAD: up to four CIs (length index 3, AppTy 5), ended by AppTy 0
+    if less than four, followed by the data subfields
+Without CI flag, the X-PAD continues the last data subfield of the
+previous X-PAD.
+
+MOT data groups in X-PAD (clause 7.4.5.1) are preceded by a data group
+length indicator: rfa 2, data group length 14, CRC 16.
+
+Dynamic Label data group (clause 7.4.5.2)
+    prefix                16
+        toggle             1
+        first, last        2
+        C flag             1  1: command
+        field 1            4  length - 1, or command
+        field 2            8  charset if first, else segment number
+    character field       up to 16 bytes
+    CRC                   16
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include <map>
+#include <string>
+#include <vector>
+#include "motdecoder.hpp"
+
+// X-PAD application types
+const int xpad_appty_dgli = 1;
+const int xpad_appty_dl_start = 2;
+const int xpad_appty_dl_continuation = 3;
+const int xpad_appty_mot_start = 12;
+const int xpad_appty_mot_continuation = 13;
+
+// Lengths of the variable size X-PAD data subfields, by length index
+extern const size_t xpad_subfield_lengths[8];
+
+struct dl_plus_tag_t {
+    int content_type = 0;
+    std::string text;
+
+    bool operator==(const dl_plus_tag_t& other) const {
+        return content_type == other.content_type and text == other.text;
+    }
+};
+
+const char* dl_plus_content_type_to_string(int content_type);
+
+struct dynamic_label_t {
+    std::string text; // UTF-8
+
+    // DL Plus (ETSI TS 102 980), tags are empty if not signalled
+    bool item_toggle = false;
+    bool item_running = false;
+    std::vector<dl_plus_tag_t> tags;
+};
+
+struct pad_statistics_t {
+    size_t pads = 0;
+    size_t xpads = 0;
+
+    // Bytes of the X-PAD data subfields, per application type
+    std::array<size_t, 32> xpad_bytes = {};
+
+    size_t dl_data_groups = 0;
+    size_t dl_crc_errors = 0;
+    size_t dl_changes = 0;
+    size_t dl_plus_changes = 0;
+
+    dynamic_label_t label;
+
+    size_t dgli_crc_errors = 0;
+    mot_statistics_t mot;
+};
+
+/* PadDecoder splits the X-PAD into its data subfields, and reassembles the
+ * Dynamic Label and the MOT data groups. New labels and DL Plus tags are
+ * printed when they change, repetitions of the current label are skipped.
+ */
+class PadDecoder {
+    public:
+        /* Process the PAD of one AU or audio frame. xpad points to the
+         * xpad_len X-PAD bytes, which are left in reverse order, and fpad
+         * to the two F-PAD bytes. */
+        void process(const uint8_t *xpad, size_t xpad_len,
+                const uint8_t *fpad);
+
+        // Time in seconds of the PAD that follows
+        void set_time(double time) { m_mot.set_time(time); }
+
+        // See MotDecoder::set_dump_prefix
+        void set_mot_dump_prefix(const std::string& prefix) {
+            m_mot.set_dump_prefix(prefix);
+        }
+
+        pad_statistics_t get_statistics(void) const;
+
+        // Printed with the labels
+        int subchid = -1;
+
+    private:
+        void process_subfield(int appty, const uint8_t *xpad,
+                size_t xpad_len, size_t offset, size_t length);
+        void process_dl_data_group(void);
+        void process_dl_segment(const uint8_t *dg, size_t field_len);
+        void remove_label(void);
+        void apply_dl_plus(void);
+        void process_dgli(void);
+
+        // Application type of the last data subfield, -1 if unknown
+        int m_last_appty = -1;
+
+        // Dynamic Label data group being received
+        std::vector<uint8_t> m_dl_data_group;
+
+        // Dynamic Label being assembled
+        int m_dl_toggle = -1;
+        int m_dl_charset = 0;
+        int m_dl_last_segment = -1;
+        bool m_dl_complete = false;
+        std::map<int, std::vector<uint8_t> > m_dl_segments;
+
+        // Last DL Plus command, for the label whose toggle equals the link bit
+        std::vector<uint8_t> m_dl_plus_command;
+        int m_dl_plus_link = -1;
+
+        // Data group length indicator being received, and its value
+        std::vector<uint8_t> m_dgli;
+        size_t m_mot_data_group_length = 0;
+
+        // MOT data group being received
+        std::vector<uint8_t> m_mot_data_group;
+        MotDecoder m_mot;
+
+        pad_statistics_t m_stats;
+};
+
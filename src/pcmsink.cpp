@@ -0,0 +1,157 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    pcmsink.cpp
+        Destinations for decoded audio
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include "pcmsink.hpp"
+extern "C" {
+#include "wavfile.h"
+}
+
+using namespace std;
+
+PcmFileSink::PcmFileSink(const string& filename, pcm_file_format_e format,
+        int sample_rate) :
+    m_filename(filename),
+    m_format(format)
+{
+    switch (format) {
+        case pcm_file_format_e::WAV:
+            m_fd = wavfile_open(filename.c_str(), sample_rate);
+            break;
+        case pcm_file_format_e::RAW:
+            m_fd = fopen(filename.c_str(), "w");
+            break;
+    }
+
+    if (m_fd == nullptr) {
+        throw runtime_error("Could not open " + filename + ": " + strerror(errno));
+    }
+
+    m_buffers.resize(num_buffers);
+    for (size_t i = 0; i < num_buffers; i++) {
+        m_buffers[i].resize(2 * buffer_frames);
+        if (i != m_current) {
+            m_free.push_back(i);
+        }
+    }
+
+    m_writer = thread(&PcmFileSink::writer_loop, this);
+}
+
+PcmFileSink::~PcmFileSink()
+{
+    if (m_current_frames > 0) {
+        submit_buffer();
+    }
+
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    m_writer.join();
+
+    switch (m_format) {
+        case pcm_file_format_e::WAV:
+            wavfile_close(m_fd);
+            break;
+        case pcm_file_format_e::RAW:
+            fclose(m_fd);
+            break;
+    }
+}
+
+void PcmFileSink::write(const int16_t *samples, size_t num_frames,
+        int channels)
+{
+    while (num_frames > 0) {
+        const size_t len = min(num_frames, buffer_frames - m_current_frames);
+        int16_t *dst = m_buffers[m_current].data() + 2 * m_current_frames;
+
+        if (channels == 1) {
+            for (size_t i = 0; i < len; i++) {
+                dst[2 * i] = samples[i];
+                dst[2 * i + 1] = samples[i];
+            }
+        }
+        else {
+            memcpy(dst, samples, 2 * len * sizeof(int16_t));
+        }
+
+        samples += channels * len;
+        num_frames -= len;
+        m_current_frames += len;
+
+        if (m_current_frames == buffer_frames) {
+            submit_buffer();
+        }
+    }
+}
+
+void PcmFileSink::submit_buffer()
+{
+    unique_lock<mutex> lock(m_mutex);
+    m_full.emplace_back(m_current, m_current_frames);
+    m_cv.notify_all();
+
+    // Only blocks if the disk cannot keep up for several seconds
+    m_cv.wait(lock, [&]{ return not m_free.empty(); });
+    m_current = m_free.front();
+    m_free.pop_front();
+    m_current_frames = 0;
+}
+
+void PcmFileSink::writer_loop()
+{
+    bool error_reported = false;
+
+    unique_lock<mutex> lock(m_mutex);
+    while (true) {
+        m_cv.wait(lock, [&]{ return m_stop or not m_full.empty(); });
+
+        if (m_full.empty()) {
+            // Stopped, and everything is written
+            break;
+        }
+
+        const auto buffer = m_full.front();
+        m_full.pop_front();
+
+        lock.unlock();
+        const size_t written = fwrite(m_buffers[buffer.first].data(),
+                2 * sizeof(int16_t), buffer.second, m_fd);
+        if (written != buffer.second and not error_reported) {
+            fprintf(stderr, "Write error on %s: %s\n",
+                    m_filename.c_str(), strerror(errno));
+            error_reported = true;
+        }
+        lock.lock();
+
+        m_free.push_back(buffer.first);
+        m_cv.notify_all();
+    }
+}
+
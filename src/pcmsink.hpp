@@ -0,0 +1,94 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    pcmsink.hpp
+        Destinations for decoded audio
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Destination of decoded audio, which is always written as 16-bit stereo
+class PcmSink {
+    public:
+        virtual ~PcmSink() {}
+
+        /* Write num_frames frames of interleaved audio with 1 or 2
+         * channels. Mono audio is written to both channels. */
+        virtual void write(const int16_t *samples, size_t num_frames,
+                int channels) = 0;
+};
+
+enum class pcm_file_format_e {
+    WAV, // RF64 once larger than 4GB
+    RAW, // Headerless, can be a named pipe
+};
+
+/* Writes the audio to a file from a separate thread. The audio is collected
+ * in large buffers, and the decoder only has to wait if all buffers are
+ * waiting to be written. */
+class PcmFileSink : public PcmSink {
+    public:
+        // Throws a runtime_error if the file cannot be opened
+        PcmFileSink(const std::string& filename, pcm_file_format_e format,
+                int sample_rate);
+        ~PcmFileSink();
+
+        PcmFileSink(const PcmFileSink& other) = delete;
+        PcmFileSink& operator=(const PcmFileSink& other) = delete;
+
+        virtual void write(const int16_t *samples, size_t num_frames,
+                int channels) override;
+
+    private:
+        // 1MB per buffer, about 5s of 48kHz audio
+        static const size_t buffer_frames = 256 * 1024;
+        static const size_t num_buffers = 8;
+
+        // Hand the current buffer to the writer, and wait for a free one
+        void submit_buffer(void);
+        void writer_loop(void);
+
+        std::string m_filename;
+        pcm_file_format_e m_format;
+        FILE *m_fd = nullptr;
+
+        std::vector<std::vector<int16_t> > m_buffers;
+
+        // Only used by the decoder
+        size_t m_current = 0;
+        size_t m_current_frames = 0;
+
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::deque<std::pair<size_t, size_t> > m_full; // buffer, frames
+        std::deque<size_t> m_free;
+        bool m_stop = false;
+
+        std::thread m_writer;
+};
+
@@ -29,10 +29,14 @@
 #include <array>
 #include <map>
 #include <set>
+#include <climits>
+#include <cstdint>
+#include "utils.hpp"
 
 using namespace std;
 
 const double FRAME_DURATION = 24e-3;
+const int FRAME_DURATION_MS = 24;
 
 struct FIGTypeExt {
     int figtype;
@@ -48,17 +52,167 @@ struct FIGTypeExt {
     }
 };
 
+// Streaming quantile sketch for intervals in frames. Intervals up to
+// exact_limit are counted exactly, longer ones in 16 logarithmic bins per
+// octave, which bounds the relative error of the quantile to 1/16.
+class IntervalSketch {
+    public:
+        void add(int interval) {
+            m_bins[bin_of(interval)]++;
+            m_count++;
+        }
+
+        // Returns the upper bound of the bin that contains quantile q
+        int quantile(double q) const {
+            const uint64_t rank = ceil(q * m_count);
+            uint64_t cumulative = 0;
+            for (size_t bin = 0; bin < m_bins.size(); bin++) {
+                cumulative += m_bins[bin];
+                if (cumulative >= rank and cumulative > 0) {
+                    return upper_bound_of(bin);
+                }
+            }
+            return 0;
+        }
+
+    private:
+        static const int exact_limit = 128; // must be a power of two
+        static const int exact_bits = 7;
+        static const int sub_bins = 16;
+        static const int sub_bits = 4;
+
+        static size_t bin_of(int interval) {
+            if (interval < exact_limit) {
+                return interval;
+            }
+            int msb = 31 - __builtin_clz(interval);
+            const int sub = (interval >> (msb - sub_bits)) & (sub_bins - 1);
+            return exact_limit + (msb - exact_bits) * sub_bins + sub;
+        }
+
+        static int upper_bound_of(size_t bin) {
+            if (bin < (size_t)exact_limit) {
+                return bin;
+            }
+            const int msb = (bin - exact_limit) / sub_bins + exact_bits;
+            const int sub = (bin - exact_limit) % sub_bins;
+            const int64_t lower = ((int64_t)(sub_bins + sub)) << (msb - sub_bits);
+            const int64_t width = (int64_t)1 << (msb - sub_bits);
+            return std::min<int64_t>(lower + width - 1, INT32_MAX);
+        }
+
+        array<uint32_t, exact_limit + (31 - exact_bits) * sub_bins> m_bins = {};
+        uint64_t m_count = 0;
+};
+
+// Occurrence statistics that use constant memory, however long the analysis
+// runs. Positions and intervals are in frames.
+struct OccurrenceStats {
+    size_t count = 0;
+    int first = 0;
+    int last = 0;
+    int min_interval = 0;
+    int max_interval = 0;
+
+    IntervalSketch intervals;
+
+    // Bucket 0 counts intervals of zero (several occurrences in the same
+    // frame), bucket i > 0 counts intervals in [2^(i-1), 2^i), the last
+    // bucket also counts all longer intervals.
+    array<uint32_t, 12> interval_histogram = {};
+
+    void add(int frame_number) {
+        if (count == 0) {
+            first = frame_number;
+        }
+        else {
+            const int interval = frame_number - last;
+            min_interval = (count == 1) ? interval : std::min(min_interval, interval);
+            max_interval = std::max(max_interval, interval);
+            intervals.add(interval);
+
+            size_t bucket = 0;
+            for (int i = interval; i > 0 and bucket < interval_histogram.size() - 1; i >>= 1) {
+                bucket++;
+            }
+            interval_histogram[bucket]++;
+        }
+        last = frame_number;
+        count++;
+    }
+};
+
+// Counts occurrences over the last N slots. Slots that fall out of the window
+// are subtracted when time advances, so the history is never rescanned.
+template<size_t N>
+class SlidingCounter {
+    public:
+        void add(int64_t slot) {
+            advance(slot);
+            m_counts[slot % N]++;
+            m_sum++;
+        }
+
+        uint32_t sum(int64_t slot) {
+            advance(slot);
+            return m_sum;
+        }
+
+    private:
+        void advance(int64_t slot) {
+            if (slot <= m_slot) {
+                return;
+            }
+
+            if (slot - m_slot >= (int64_t)N) {
+                m_counts.fill(0);
+                m_sum = 0;
+            }
+            else {
+                for (int64_t s = m_slot + 1; s <= slot; s++) {
+                    m_sum -= m_counts[s % N];
+                    m_counts[s % N] = 0;
+                }
+            }
+            m_slot = slot;
+        }
+
+        array<uint32_t, N> m_counts = {};
+        uint32_t m_sum = 0;
+        int64_t m_slot = 0;
+};
+
+// Windows of 10 seconds and 1 minute use one-second slots, the 1 hour window
+// uses one-minute slots
+struct WindowCounters {
+    SlidingCounter<10> last_10s;
+    SlidingCounter<60> last_1min;
+    SlidingCounter<60> last_1h;
+
+    void add(int frame_number) {
+        const int64_t second = (int64_t)frame_number * FRAME_DURATION_MS / 1000;
+        last_10s.add(second);
+        last_1min.add(second);
+        last_1h.add(second / 60);
+    }
+};
+
 struct FIGRateInfo {
-    // List of frame numbers in which the FIG is present
-    vector<int> frames_present;
+    // Frames in which the FIG is present
+    OccurrenceStats present;
+
+    // Frames in which a complete DB for that FIG has been sent
+    OccurrenceStats complete;
 
-    // List of frame numbers in which a complete DB for that FIG has been sent
-    vector<int> frames_complete;
+    WindowCounters present_windows;
+    WindowCounters complete_windows;
 
     // Which FIBs this FIG was seen in
     set<int> in_fib;
 
-    vector<uint8_t> lengths;
+    // FIG lengths, a FIG cannot be longer than 31 bytes
+    array<uint32_t, 32> length_histogram = {};
+    uint64_t length_sum = 0;
 };
 
 
@@ -71,66 +225,47 @@ void rate_announce_fig(int figtype, int figextension, bool complete, uint8_t fig
 {
     FIGTypeExt f = {.figtype = figtype, .figextension = figextension};
 
-    if (fig_rates.count(f) == 0) {
-        FIGRateInfo rate;
-        fig_rates[f] = rate;
-    }
-
     FIGRateInfo& rate = fig_rates[f];
 
-    rate.frames_present.push_back(current_frame_number);
+    rate.present.add(current_frame_number);
+    rate.present_windows.add(current_frame_number);
     if (complete) {
-        rate.frames_complete.push_back(current_frame_number);
+        rate.complete.add(current_frame_number);
+        rate.complete_windows.add(current_frame_number);
     }
     rate.in_fib.insert(current_fib);
-    rate.lengths.push_back(figlen);
+    rate.length_histogram.at(figlen)++;
+    rate.length_sum += figlen;
 }
 
-static double rate_avg(
-        const std::vector<int>& fig_positions,
-        bool per_second)
+static double rate_avg(const OccurrenceStats& stats, bool per_second)
 {
     // Average interval is 1/N \sum_{i} pos_{i+1} - pos_{i}
     // but this sums out all the intermediate pos_{i}, leaving us
     // with 1/N (pos_{last} - pos_{first})
     //
-    // N = size - 1 because we sum intervals, not points in time,
+    // N = count - 1 because we sum intervals, not points in time,
     // and there's one less interval than there are points.
 
     double avg =
-        (double)(fig_positions.back() - fig_positions.front()) /
-        (double)(fig_positions.size() - 1);
+        (double)(stats.last - stats.first) /
+        (double)(stats.count - 1);
     if (per_second) {
         avg = 1.0 / (avg * FRAME_DURATION);
     }
     return avg;
 }
 
-static double length_avg(const std::vector<uint8_t>& lengths)
-{
-    double avg = 0.0;
-    for (const uint8_t l : lengths) {
-        avg += l;
-    }
-    return avg / (double)lengths.size();
-}
-
-static string length_histogram(const std::vector<uint8_t>& lengths)
+static string histogram_to_string(const uint32_t *histogram, size_t len)
 {
     const array<const char*, 7> hist_chars({"▁", "▂", "▃", "▄", "▅", "▆", "▇"});
 
-    // FIB length is 30
-    vector<size_t> histogram(30);
-    for (const uint8_t l : lengths) {
-        histogram.at(l)++;
-    }
-
-    const double max_hist = *std::max_element(histogram.cbegin(), histogram.cend());
+    const double max_hist = *std::max_element(histogram, histogram + len);
 
     stringstream ss;
     ss << "[";
-    for (const size_t h : histogram) {
-        uint8_t char_ix = floor((double)h / (max_hist+1) * hist_chars.size());
+    for (size_t i = 0; i < len; i++) {
+        uint8_t char_ix = floor((double)histogram[i] / (max_hist+1) * hist_chars.size());
         ss << hist_chars.at(char_ix);
     }
     ss << "]";
@@ -138,6 +273,30 @@ static string length_histogram(const std::vector<uint8_t>& lengths)
     return ss.str();
 }
 
+static string length_histogram(const FIGRateInfo& rate)
+{
+    // FIB length is 30, longer FIGs are only possible when FIBs with
+    // CRC errors are analysed, and are shown in the last bin
+    array<uint32_t, 30> histogram;
+    std::copy(rate.length_histogram.begin(),
+            rate.length_histogram.begin() + histogram.size(),
+            histogram.begin());
+    for (size_t i = histogram.size(); i < rate.length_histogram.size(); i++) {
+        histogram.back() += rate.length_histogram[i];
+    }
+
+    return histogram_to_string(histogram.data(), histogram.size());
+}
+
+static string max_interval(const OccurrenceStats& stats, bool per_second)
+{
+    if (per_second) {
+        return strprintf("%6.2fs", stats.max_interval * FRAME_DURATION);
+    }
+    else {
+        return strprintf("%6d ", stats.max_interval);
+    }
+}
 
 void rate_display_analysis(bool per_second)
 {
@@ -146,29 +305,28 @@ void rate_display_analysis(bool per_second)
 
     if (per_second) {
         printf(GREPPABLE_PREFIX
-        "FIG T/EXT  AVG  (COUNT) -   AVG  (COUNT) -  LEN - LENGTH HISTOGRAM               IN FIB(S)\n");
+        "FIG T/EXT  AVG  (COUNT) -   AVG  (COUNT) -  LEN - LENGTH HISTOGRAM               IN FIB(S)"
+        " - MAXGAP  MAXGAP COMPLETE - INTERVAL HISTOGRAM\n");
     }
 
     for (auto& fig_rate : fig_rates) {
-        auto& frames_present = fig_rate.second.frames_present;
-        auto& frames_complete = fig_rate.second.frames_complete;
+        const auto& present = fig_rate.second.present;
+        const auto& complete = fig_rate.second.complete;
 
-        const size_t n_present = frames_present.size();
-        const size_t n_complete = frames_complete.size();
         printf(GREPPABLE_PREFIX);
 
-        if (n_present >= 2) {
-            double avg = rate_avg(frames_present, per_second);
+        if (present.count >= 2) {
+            double avg = rate_avg(present, per_second);
 
             printf("FIG%2d/%2d %6.2f (%5zu)",
                     fig_rate.first.figtype, fig_rate.first.figextension,
                     avg,
-                    n_present);
+                    present.count);
 
-            if (n_complete >= 2) {
-                double avg = rate_avg(frames_complete, per_second);
+            if (complete.count >= 2) {
+                double avg = rate_avg(complete, per_second);
 
-                printf(" - %6.2f (%5zu)", avg, n_complete);
+                printf(" - %6.2f (%5zu)", avg, complete.count);
             }
             else {
                 printf(" - None complete");
@@ -180,17 +338,137 @@ void rate_display_analysis(bool per_second)
         }
 
         printf(" - %4.1f %s - ",
-                length_avg(fig_rate.second.lengths),
-                length_histogram(fig_rate.second.lengths).c_str());
+                (double)fig_rate.second.length_sum / (double)present.count,
+                length_histogram(fig_rate.second).c_str());
 
         for (auto& fib : fig_rate.second.in_fib) {
             printf(" %d", fib);
         }
+
+        if (present.count >= 2) {
+            printf(" - %s", max_interval(present, per_second).c_str());
+            if (complete.count >= 2) {
+                printf(" %s", max_interval(complete, per_second).c_str());
+            }
+            printf(" - %s", histogram_to_string(
+                        present.interval_histogram.data(),
+                        present.interval_histogram.size()).c_str());
+        }
         printf("\n");
 
     }
 }
 
+static string interval_to_string(int interval, bool per_second)
+{
+    if (per_second) {
+        return strprintf("%7.0f", interval * FRAME_DURATION * 1000.0);
+    }
+    else {
+        return strprintf("%7d", interval);
+    }
+}
+
+static string jitter_stats(const OccurrenceStats& stats, bool per_second)
+{
+    if (stats.count < 2) {
+        return "      -       -       -       -";
+    }
+
+    return interval_to_string(stats.min_interval, per_second) + " " +
+        interval_to_string(stats.intervals.quantile(0.95), per_second) + " " +
+        interval_to_string(stats.intervals.quantile(0.99), per_second) + " " +
+        interval_to_string(stats.max_interval, per_second);
+}
+
+void rate_display_jitter(bool per_second)
+{
+    // Group the FIGs by the set of FIBs they were carried in
+    map<set<int>, vector<const pair<const FIGTypeExt, FIGRateInfo>*> > by_fibs;
+    for (const auto& fig_rate : fig_rates) {
+        by_fibs[fig_rate.second.in_fib].push_back(&fig_rate);
+    }
+
+    // C_ columns are intervals between complete databases, C_FIRST is
+    // the time from the first occurrence until the first complete database
+    printf(GREPPABLE_PREFIX "JITTER intervals in %s\n", per_second ? "ms" : "frames");
+
+    for (const auto& group : by_fibs) {
+        printf(GREPPABLE_PREFIX "JITTER FIB(S)");
+        for (const int fib : group.first) {
+            printf(" %d", fib);
+        }
+        printf("\n");
+        printf(GREPPABLE_PREFIX "JITTER FIG T/EXT     MIN     P95     P99     MAX"
+                " -   C_MIN   C_P95   C_P99   C_MAX - C_FIRST\n");
+
+        for (const auto fig_rate : group.second) {
+            const auto& present = fig_rate->second.present;
+            const auto& complete = fig_rate->second.complete;
+
+            const string first_complete = complete.count == 0 ? "      -" :
+                interval_to_string(complete.first - present.first, per_second);
+
+            printf(GREPPABLE_PREFIX "JITTER FIG%2d/%2d %s - %s - %s\n",
+                    fig_rate->first.figtype, fig_rate->first.figextension,
+                    jitter_stats(present, per_second).c_str(),
+                    jitter_stats(complete, per_second).c_str(),
+                    first_complete.c_str());
+        }
+    }
+}
+
+static string window_rate(uint32_t count, double window_duration, bool per_second)
+{
+    if (per_second) {
+        return strprintf("%6.2f", count / window_duration);
+    }
+    else if (count == 0) {
+        return "     -";
+    }
+    else {
+        return strprintf("%6.2f", window_duration / FRAME_DURATION / count);
+    }
+}
+
+/* Time covered by the slots from the one at first_second up to the current
+ * frame. The current slot is only partly filled, and at the beginning the
+ * window does not reach back to first_second yet. */
+static double window_duration(int64_t first_second)
+{
+    first_second = std::max<int64_t>(first_second, 0);
+    const int64_t first_frame =
+        (first_second * 1000 + FRAME_DURATION_MS - 1) / FRAME_DURATION_MS;
+    return (current_frame_number + 1 - first_frame) * FRAME_DURATION;
+}
+
+void rate_display_windows(bool per_second)
+{
+    const int64_t second = (int64_t)current_frame_number * FRAME_DURATION_MS / 1000;
+    const int64_t minute = second / 60;
+
+    const double duration_10s = window_duration(second - 9);
+    const double duration_1min = window_duration(second - 59);
+    const double duration_1h = window_duration((minute - 59) * 60);
+
+    printf(GREPPABLE_PREFIX
+            "WINDOW FIG T/EXT   10s    1min   1h   - COMPLETE 10s    1min   1h\n");
+
+    for (auto& fig_rate : fig_rates) {
+        auto& present = fig_rate.second.present_windows;
+        auto& complete = fig_rate.second.complete_windows;
+
+        printf(GREPPABLE_PREFIX "WINDOW FIG%2d/%2d %s %s %s - %s %s %s\n",
+                fig_rate.first.figtype, fig_rate.first.figextension,
+                window_rate(present.last_10s.sum(second), duration_10s, per_second).c_str(),
+                window_rate(present.last_1min.sum(second), duration_1min, per_second).c_str(),
+                window_rate(present.last_1h.sum(second / 60), duration_1h, per_second).c_str(),
+                window_rate(complete.last_10s.sum(second), duration_10s, per_second).c_str(),
+                window_rate(complete.last_1min.sum(second), duration_1min, per_second).c_str(),
+                window_rate(complete.last_1h.sum(second / 60), duration_1h, per_second).c_str());
+    }
+}
+
 void rate_new_fib(int fib)
 {
     if (fib == 0) {
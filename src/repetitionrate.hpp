@@ -38,3 +38,15 @@ void rate_new_fib(int fib);
  */
 void rate_display_analysis(bool per_second);
 
+/* Print minimum, 95th and 99th percentile and maximum of the interval
+ * between FIGs and between complete databases, grouped by the FIBs the
+ * FIGs are carried in. Intervals are given in ms if per_second is true,
+ * in frames otherwise.
+ */
+void rate_display_jitter(bool per_second);
+
+/* Print the rates over the last 10 seconds, 1 minute and 1 hour.
+ * Same per_second semantics as rate_display_analysis.
+ */
+void rate_display_windows(bool per_second);
+
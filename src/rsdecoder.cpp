@@ -17,10 +17,235 @@
    */
 
 #include <stdexcept>
+#include <utility>
+#include <cstring>
 #include "rsdecoder.hpp"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define RSDEC_X86_SIMD 1
+#  include <immintrin.h>
+#else
+#  define RSDEC_X86_SIMD 0
+#endif
+
 #define RSDEC_DEBUG 0
 
+/* The code has 10 parity bytes, and the generator polynomial has the roots
+ * alpha^0 to alpha^9 (fcr=0, prim=1). A packet is a valid codeword if it
+ * evaluates to zero at all of them. */
+#define RSDEC_NROOTS 10
+
+struct syndrome_tables_t {
+    // root_mul[r][v] = v * alpha^r
+    uint8_t root_mul[RSDEC_NROOTS][256];
+
+    /* The same multiplication split in two nibble lookups for pshufb:
+     * v * alpha^r = nibble_mul[r][0][v & 0xF] ^ nibble_mul[r][1][v >> 4] */
+    alignas(16) uint8_t nibble_mul[RSDEC_NROOTS][2][16];
+};
+
+static syndrome_tables_t make_syndrome_tables()
+{
+    syndrome_tables_t t;
+
+    for (int v = 0; v < 256; v++) {
+        int p = v;
+        for (int r = 0; r < RSDEC_NROOTS; r++) {
+            t.root_mul[r][v] = p;
+
+            // multiply by alpha in GF(2^8) with polynomial 0x11D
+            p <<= 1;
+            if (p & 0x100)
+                p ^= 0x11D;
+        }
+    }
+
+    for (int r = 0; r < RSDEC_NROOTS; r++) {
+        for (int n = 0; n < 16; n++) {
+            t.nibble_mul[r][0][n] = t.root_mul[r][n];
+            t.nibble_mul[r][1][n] = t.root_mul[r][n << 4];
+        }
+    }
+
+    return t;
+}
+
+static const syndrome_tables_t& syndrome_tables()
+{
+    static const syndrome_tables_t tables = make_syndrome_tables();
+    return tables;
+}
+
+/* The syndrome kernels work directly on the interleaved superframe, where
+ * byte pos of packet i is at sf[pos * subch_index + i]. The bytes at the
+ * same position of consecutive packets are adjacent, so a vector kernel
+ * evaluates the syndromes of 16 or 32 packets at once. Lanes beyond the
+ * last packet see data from the next row, and their result is ignored.
+ *
+ * Each kernel returns a bitmask of the packets starting at i0 that have
+ * a non-zero syndrome.
+ */
+typedef uint32_t (*syndrome_kernel_t)(
+        const uint8_t *sf, int subch_index, int i0);
+
+static uint32_t erroneous_packets_scalar(
+        const uint8_t *sf, int subch_index, int i0)
+{
+    const auto& t = syndrome_tables();
+    uint8_t s[RSDEC_NROOTS] = {0};
+
+    // evaluate the packet at the roots of the generator polynomial
+    for(int pos = 0; pos < 120; pos++) {
+        const uint8_t d = sf[pos * subch_index + i0];
+        for(int r = 0; r < RSDEC_NROOTS; r++)
+            s[r] = t.root_mul[r][s[r]] ^ d;
+    }
+
+    uint8_t syn_error = 0;
+    for(int r = 0; r < RSDEC_NROOTS; r++)
+        syn_error |= s[r];
+
+    return syn_error != 0;
+}
+
+#if RSDEC_X86_SIMD
+/* Load the bytes at position pos of the packets starting at i0, without
+ * reading beyond the end of the superframe */
+static inline const uint8_t* lanes_at(const uint8_t *sf, int subch_index,
+        int i0, int pos, int width, uint8_t *tail)
+{
+    const size_t sf_len = 120 * subch_index;
+    const size_t offset = pos * subch_index + i0;
+
+    if (offset + width <= sf_len) {
+        return sf + offset;
+    }
+
+    memset(tail, 0, width);
+    memcpy(tail, sf + offset, sf_len - offset);
+    return tail;
+}
+
+__attribute__((target("ssse3")))
+static uint32_t erroneous_packets_ssse3(
+        const uint8_t *sf, int subch_index, int i0)
+{
+    const auto& t = syndrome_tables();
+    const __m128i low_nibble = _mm_set1_epi8(0x0F);
+    uint8_t tail[16];
+
+    __m128i mul_lo[RSDEC_NROOTS];
+    __m128i mul_hi[RSDEC_NROOTS];
+    __m128i s[RSDEC_NROOTS];
+    for (int r = 0; r < RSDEC_NROOTS; r++) {
+        mul_lo[r] = _mm_load_si128((const __m128i*)t.nibble_mul[r][0]);
+        mul_hi[r] = _mm_load_si128((const __m128i*)t.nibble_mul[r][1]);
+        s[r] = _mm_setzero_si128();
+    }
+
+    for (int pos = 0; pos < 120; pos++) {
+        const __m128i d = _mm_loadu_si128((const __m128i*)
+                lanes_at(sf, subch_index, i0, pos, 16, tail));
+
+        for (int r = 0; r < RSDEC_NROOTS; r++) {
+            const __m128i lo = _mm_and_si128(s[r], low_nibble);
+            const __m128i hi = _mm_and_si128(_mm_srli_epi16(s[r], 4), low_nibble);
+            const __m128i prod = _mm_xor_si128(
+                    _mm_shuffle_epi8(mul_lo[r], lo),
+                    _mm_shuffle_epi8(mul_hi[r], hi));
+            s[r] = _mm_xor_si128(prod, d);
+        }
+    }
+
+    __m128i syn_error = _mm_setzero_si128();
+    for (int r = 0; r < RSDEC_NROOTS; r++)
+        syn_error = _mm_or_si128(syn_error, s[r]);
+
+    const __m128i is_zero = _mm_cmpeq_epi8(syn_error, _mm_setzero_si128());
+    return ~_mm_movemask_epi8(is_zero) & 0xFFFF;
+}
+
+__attribute__((target("avx2")))
+static uint32_t erroneous_packets_avx2(
+        const uint8_t *sf, int subch_index, int i0)
+{
+    const auto& t = syndrome_tables();
+    const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+    uint8_t tail[32];
+
+    // pshufb works on each 128-bit half, both need the table
+    __m256i mul_lo[RSDEC_NROOTS];
+    __m256i mul_hi[RSDEC_NROOTS];
+    __m256i s[RSDEC_NROOTS];
+    for (int r = 0; r < RSDEC_NROOTS; r++) {
+        mul_lo[r] = _mm256_broadcastsi128_si256(
+                _mm_load_si128((const __m128i*)t.nibble_mul[r][0]));
+        mul_hi[r] = _mm256_broadcastsi128_si256(
+                _mm_load_si128((const __m128i*)t.nibble_mul[r][1]));
+        s[r] = _mm256_setzero_si256();
+    }
+
+    for (int pos = 0; pos < 120; pos++) {
+        const __m256i d = _mm256_loadu_si256((const __m256i*)
+                lanes_at(sf, subch_index, i0, pos, 32, tail));
+
+        for (int r = 0; r < RSDEC_NROOTS; r++) {
+            const __m256i lo = _mm256_and_si256(s[r], low_nibble);
+            const __m256i hi = _mm256_and_si256(
+                    _mm256_srli_epi16(s[r], 4), low_nibble);
+            const __m256i prod = _mm256_xor_si256(
+                    _mm256_shuffle_epi8(mul_lo[r], lo),
+                    _mm256_shuffle_epi8(mul_hi[r], hi));
+            s[r] = _mm256_xor_si256(prod, d);
+        }
+    }
+
+    __m256i syn_error = _mm256_setzero_si256();
+    for (int r = 0; r < RSDEC_NROOTS; r++)
+        syn_error = _mm256_or_si256(syn_error, s[r]);
+
+    const __m256i is_zero = _mm256_cmpeq_epi8(syn_error, _mm256_setzero_si256());
+    return ~(uint32_t)_mm256_movemask_epi8(is_zero);
+}
+#endif
+
+struct syndrome_kernel_info_t {
+    syndrome_kernel_t kernel;
+    int width; // Number of packets checked per call
+};
+
+/* The wide kernel only pays off when there are enough packets to fill it,
+ * otherwise most of its loads go through the tail copy */
+struct syndrome_kernels_t {
+    syndrome_kernel_info_t narrow;
+    syndrome_kernel_info_t wide;
+
+    const syndrome_kernel_info_t& select(int subch_index) const {
+        return subch_index > narrow.width ? wide : narrow;
+    }
+};
+
+static syndrome_kernels_t detect_syndrome_kernels()
+{
+    syndrome_kernels_t k;
+    k.narrow = {erroneous_packets_scalar, 1};
+#if RSDEC_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3")) {
+        k.narrow = {erroneous_packets_ssse3, 16};
+    }
+    k.wide = k.narrow;
+    if (__builtin_cpu_supports("avx2")) {
+        k.wide = {erroneous_packets_avx2, 32};
+    }
+#else
+    k.wide = k.narrow;
+#endif
+    return k;
+}
+
+static const syndrome_kernels_t syndrome_kernels = detect_syndrome_kernels();
+
 RSDecoder::RSDecoder()
 {
     rs_handle = init_rs_char(8, 0x11D, 0, 1, 10, 135);
@@ -30,24 +255,61 @@ RSDecoder::RSDecoder()
 
 RSDecoder::~RSDecoder()
 {
-    free_rs_char(rs_handle);
+    if (rs_handle)
+        free_rs_char(rs_handle);
+}
+
+RSDecoder::RSDecoder(RSDecoder&& other)
+{
+    rs_handle = other.rs_handle;
+    other.rs_handle = nullptr;
+}
+
+RSDecoder& RSDecoder::operator=(RSDecoder&& other)
+{
+    std::swap(rs_handle, other.rs_handle);
+    return *this;
 }
 
 int RSDecoder::DecodeSuperframe(std::vector<uint8_t> &sf, int subch_index)
+{
+    return DecodeSuperframe(sf.data(), subch_index);
+}
+
+int RSDecoder::DecodeSuperframe(uint8_t *sf, int subch_index)
 {
     int total_corr_count = 0;
     bool uncorr_errors = false;
+    uint32_t erroneous = 0;
+    const auto& syndrome_kernel = syndrome_kernels.select(subch_index);
 
+#if RSDEC_DEBUG
     std::vector<int> errors_per_index(subch_index);
+#endif
 
     // process all RS packets
     for(int i = 0; i < subch_index; i++) {
+        // Almost all packets are error-free, and do not need to go
+        // through the full decoder
+        const int lane = i % syndrome_kernel.width;
+        if (lane == 0)
+            erroneous = syndrome_kernel.kernel(sf, subch_index, i);
+
+        if ((erroneous & (1u << lane)) == 0) {
+#if RSDEC_DEBUG
+            errors_per_index[i] = 0;
+#endif
+            continue;
+        }
+
         for(int pos = 0; pos < 120; pos++)
             rs_packet[pos] = sf[pos * subch_index + i];
 
         // detect errors
         int corr_count = decode_rs_char(rs_handle, rs_packet, corr_pos, 0);
+#if RSDEC_DEBUG
         errors_per_index[i] = corr_count;
+#endif
 
         if(corr_count == -1) {
             uncorr_errors = true;
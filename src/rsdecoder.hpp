@@ -17,6 +17,8 @@
    along with this program.  If not, see <http://www.gnu.org/licenses/>.
    */
 
+#pragma once
+
 #include <stdint.h>
 #include <vector>
 
@@ -29,15 +31,24 @@ class RSDecoder {
         void *rs_handle;
         uint8_t rs_packet[120];
         int corr_pos[10];
+
     public:
         RSDecoder();
         ~RSDecoder();
+        RSDecoder(RSDecoder&& other);
+        RSDecoder& operator=(RSDecoder&& other);
+
+        RSDecoder(const RSDecoder& other) = delete;
+        RSDecoder& operator=(const RSDecoder& other) = delete;
 
         /* Correct errors using reed-solomon decoder.
          * Returns number of errors corrected, or -1 if some errors could not
          * be corrected
          */
         int DecodeSuperframe(std::vector<uint8_t> &sf, int subch_index);
+
+        /* Same as above, correcting the 120 * subch_index bytes at sf in place */
+        int DecodeSuperframe(uint8_t *sf, int subch_index);
 };
 
 
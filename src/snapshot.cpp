@@ -0,0 +1,384 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    snapshot.cpp
+        Save and restore the ensemble database, so that a new run
+        can attribute subchannels and labels from the first frame.
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <vector>
+#include <map>
+#include "snapshot.hpp"
+#include "figs.hpp"
+#include "utils.hpp"
+
+extern "C" {
+#include "lib_crc.h"
+}
+
+using namespace std;
+using namespace ensemble_database;
+
+static const char snapshot_magic[4] = {'E', 'S', 'N', 'P'};
+static const uint8_t snapshot_version = 2;
+
+// Version 1 did not contain the packet mode components
+static const uint8_t snapshot_version_min = 1;
+
+class snapshot_writer {
+    public:
+        void u8(uint8_t v) { buf.push_back(v); }
+        void u16(uint16_t v) { u8(v >> 8); u8(v); }
+        void u32(uint32_t v) { u16(v >> 16); u16(v); }
+        void s32(int32_t v) { u32(v); }
+        void f64(double v) {
+            uint64_t bits;
+            memcpy(&bits, &v, sizeof(bits));
+            u32(bits >> 32);
+            u32(bits);
+        }
+        void bytes(const vector<uint8_t>& b) {
+            if (b.size() > 0xFF) {
+                throw runtime_error("snapshot: field too long");
+            }
+            u8(b.size());
+            buf.insert(buf.end(), b.begin(), b.end());
+        }
+
+        vector<uint8_t> buf;
+};
+
+class snapshot_reader {
+    public:
+        snapshot_reader(const uint8_t *data, size_t len) :
+            m_data(data), m_len(len) {}
+
+        uint8_t u8() { check(1); return m_data[m_pos++]; }
+        uint16_t u16() { uint16_t v = u8() << 8; return v | u8(); }
+        uint32_t u32() { uint32_t v = (uint32_t)u16() << 16; return v | u16(); }
+        int32_t s32() { return u32(); }
+        double f64() {
+            uint64_t bits = (uint64_t)u32() << 32;
+            bits |= u32();
+            double v;
+            memcpy(&v, &bits, sizeof(v));
+            return v;
+        }
+        vector<uint8_t> bytes() {
+            const size_t len = u8();
+            check(len);
+            vector<uint8_t> b(m_data + m_pos, m_data + m_pos + len);
+            m_pos += len;
+            return b;
+        }
+
+        bool at_end() const { return m_pos == m_len; }
+
+    private:
+        void check(size_t len) const {
+            if (m_pos + len > m_len) {
+                throw runtime_error("snapshot truncated");
+            }
+        }
+
+        const uint8_t *m_data;
+        size_t m_len;
+        size_t m_pos = 0;
+};
+
+static charset_e read_charset(snapshot_reader& r)
+{
+    const uint8_t c = r.u8();
+    switch (c) {
+        case (uint8_t)charset_e::COMPLETE_EBU_LATIN:
+        case (uint8_t)charset_e::UTF8:
+        case (uint8_t)charset_e::UCS2:
+        case (uint8_t)charset_e::UNDEFINED:
+            return static_cast<charset_e>(c);
+    }
+    throw runtime_error("snapshot contains invalid charset " + to_string(c));
+}
+
+static void write_label(snapshot_writer& w, const label_t& label)
+{
+    w.bytes(label.label_bytes());
+    w.u16(label.shortlabel_flag());
+    w.u8((uint8_t)label.charset());
+
+    w.u8(label.toggle_flag());
+    w.u8(label.segment_count());
+    w.u8((uint8_t)label.extended_label_charset());
+    w.u8(label.segments().size());
+    for (const auto& s : label.segments()) {
+        w.u8(s.first);
+        w.bytes(s.second);
+    }
+}
+
+static void read_label(snapshot_reader& r, label_t& label)
+{
+    const auto label_bytes = r.bytes();
+    const uint16_t shortlabel_flag = r.u16();
+    const auto charset = read_charset(r);
+    label.set_fig1_label(label_bytes, shortlabel_flag, charset);
+
+    label.set_toggle_flag(r.u8());
+    const size_t segment_count = r.u8();
+    label.set_extended_label_header(segment_count, read_charset(r));
+    const size_t num_segments = r.u8();
+    for (size_t i = 0; i < num_segments; i++) {
+        const int segment_index = r.u8();
+        const auto segment = r.bytes();
+        label.set_segment(segment_index, segment.data(), segment.size());
+    }
+}
+
+bool snapshot_save(const string& filename, const ensemble_t& ensemble)
+{
+    snapshot_writer w;
+
+    try {
+        for (const char c : snapshot_magic) {
+            w.u8(c);
+        }
+        w.u8(snapshot_version);
+
+        w.u16(ensemble.EId);
+        write_label(w, ensemble.label);
+
+        w.u16(ensemble.services.size());
+        for (const auto& service : ensemble.services) {
+            w.u32(service.id);
+            w.u8(service.programme_not_data);
+            write_label(w, service.label);
+
+            w.u16(service.components.size());
+            for (const auto& component : service.components) {
+                w.u32(component.service_id);
+                w.u8(component.subchId);
+                w.u8(component.scids);
+                w.u8(component.primary);
+                write_label(w, component.label);
+            }
+        }
+
+        w.u16(ensemble.subchannels.size());
+        for (const auto& subch : ensemble.subchannels) {
+            w.u8(subch.id);
+            w.u8(subch.start_addr);
+            w.u8((uint8_t)subch.protection_type);
+            w.u8((uint8_t)subch.protection_option);
+            w.s32(subch.protection_level);
+            w.s32(subch.size);
+            w.s32(subch.table_switch);
+            w.s32(subch.table_index);
+        }
+
+        w.u16(ensemble.packet_components.size());
+        for (const auto& pc : ensemble.packet_components) {
+            w.u16(pc.scid);
+            w.u8(pc.subchId);
+            w.u16(pc.packet_address);
+            w.u8(pc.dscty);
+            w.u8(pc.dg_flag);
+        }
+
+        const auto& fig0_6_db = fig0_6_getdb();
+        w.u16(fig0_6_db.size());
+        for (const auto& key_la : fig0_6_db) {
+            w.u16(key_la.first);
+            w.u8(key_la.second);
+        }
+
+        const auto& fig0_22_db = fig0_22_getdb();
+        w.u16(fig0_22_db.size());
+        for (const auto& key_lat_lng : fig0_22_db) {
+            w.u16(key_lat_lng.first);
+            w.f64(key_lat_lng.second.latitude);
+            w.f64(key_lat_lng.second.longitude);
+        }
+    }
+    catch (const runtime_error& e) {
+        fprintf(stderr, "Could not save snapshot: %s\n", e.what());
+        return false;
+    }
+
+    uint16_t crc = 0xffff;
+    for (const uint8_t b : w.buf) {
+        crc = update_crc_ccitt(crc, b);
+    }
+    crc =~ crc;
+    w.u16(crc);
+
+    FILE *fd = fopen(filename.c_str(), "wb");
+    if (fd == nullptr) {
+        fprintf(stderr, "Could not open snapshot file: %s\n", strerror(errno));
+        return false;
+    }
+
+    bool success = fwrite(w.buf.data(), w.buf.size(), 1, fd) == 1;
+    success &= (fclose(fd) == 0);
+    if (not success) {
+        fprintf(stderr, "Could not write snapshot file %s\n", filename.c_str());
+    }
+    return success;
+}
+
+bool snapshot_load(const string& filename, ensemble_t& ensemble)
+{
+    FILE *fd = fopen(filename.c_str(), "rb");
+    if (fd == nullptr) {
+        fprintf(stderr, "Could not open snapshot file: %s\n", strerror(errno));
+        return false;
+    }
+
+    vector<uint8_t> buf;
+    uint8_t chunk[4096];
+    size_t read_bytes = 0;
+    while ((read_bytes = fread(chunk, 1, sizeof(chunk), fd)) > 0) {
+        buf.insert(buf.end(), chunk, chunk + read_bytes);
+    }
+    const bool read_error = ferror(fd);
+    fclose(fd);
+
+    if (read_error) {
+        fprintf(stderr, "Could not read snapshot file %s\n", filename.c_str());
+        return false;
+    }
+
+    const size_t header_len = sizeof(snapshot_magic) + 1;
+    if (buf.size() < header_len + 2 or
+            memcmp(buf.data(), snapshot_magic, sizeof(snapshot_magic)) != 0) {
+        fprintf(stderr, "%s is not a snapshot file\n", filename.c_str());
+        return false;
+    }
+
+    const uint8_t version = buf[sizeof(snapshot_magic)];
+    if (version < snapshot_version_min or version > snapshot_version) {
+        fprintf(stderr, "Snapshot version %d not supported\n", version);
+        return false;
+    }
+
+    uint16_t crc = 0xffff;
+    for (size_t i = 0; i < buf.size() - 2; i++) {
+        crc = update_crc_ccitt(crc, buf[i]);
+    }
+    crc =~ crc;
+    if (crc != read_u16_from_buf(&buf[buf.size() - 2])) {
+        fprintf(stderr, "Snapshot CRC mismatch\n");
+        return false;
+    }
+
+    // Parse into temporaries, so that a corrupt snapshot leaves
+    // the databases untouched
+    ensemble_t ens;
+    map<uint16_t, bool> fig0_6_db;
+    map<uint16_t, Lat_Lng> fig0_22_db;
+
+    try {
+        snapshot_reader r(buf.data() + header_len, buf.size() - header_len - 2);
+
+        ens.EId = r.u16();
+        read_label(r, ens.label);
+
+        const size_t num_services = r.u16();
+        for (size_t i = 0; i < num_services; i++) {
+            service_t service;
+            service.id = r.u32();
+            service.programme_not_data = r.u8();
+            read_label(r, service.label);
+
+            const size_t num_components = r.u16();
+            for (size_t j = 0; j < num_components; j++) {
+                component_t component;
+                component.service_id = r.u32();
+                component.subchId = r.u8();
+                component.scids = r.u8();
+                component.primary = r.u8();
+                read_label(r, component.label);
+                service.components.push_back(component);
+            }
+            ens.services.push_back(service);
+        }
+
+        const size_t num_subchannels = r.u16();
+        for (size_t i = 0; i < num_subchannels; i++) {
+            subchannel_t subch;
+            subch.id = r.u8();
+            subch.start_addr = r.u8();
+            subch.protection_type = r.u8() ?
+                subchannel_t::protection_type_t::EEP :
+                subchannel_t::protection_type_t::UEP;
+            subch.protection_option = r.u8() ?
+                subchannel_t::protection_eep_option_t::EEP_B :
+                subchannel_t::protection_eep_option_t::EEP_A;
+            subch.protection_level = r.s32();
+            subch.size = r.s32();
+            subch.table_switch = r.s32();
+            subch.table_index = r.s32();
+            ens.subchannels.push_back(subch);
+        }
+
+        const size_t num_packet_components = version >= 2 ? r.u16() : 0;
+        for (size_t i = 0; i < num_packet_components; i++) {
+            packet_component_t pc;
+            pc.scid = r.u16();
+            pc.subchId = r.u8();
+            pc.packet_address = r.u16();
+            pc.dscty = r.u8();
+            pc.dg_flag = r.u8();
+            ens.packet_components.push_back(pc);
+        }
+
+        const size_t num_fig0_6 = r.u16();
+        for (size_t i = 0; i < num_fig0_6; i++) {
+            const uint16_t key = r.u16();
+            fig0_6_db[key] = r.u8();
+        }
+
+        const size_t num_fig0_22 = r.u16();
+        for (size_t i = 0; i < num_fig0_22; i++) {
+            const uint16_t key = r.u16();
+            Lat_Lng lat_lng;
+            lat_lng.latitude = r.f64();
+            lat_lng.longitude = r.f64();
+            fig0_22_db[key] = lat_lng;
+        }
+
+        if (not r.at_end()) {
+            throw runtime_error("trailing data in snapshot");
+        }
+    }
+    catch (const runtime_error& e) {
+        fprintf(stderr, "Could not load snapshot: %s\n", e.what());
+        return false;
+    }
+
+    ensemble = ens;
+    fig0_6_setdb(fig0_6_db);
+    fig0_22_setdb(fig0_22_db);
+
+    fprintf(stderr, "Loaded snapshot with %zu services and %zu subchannels\n",
+            ensemble.services.size(), ensemble.subchannels.size());
+    return true;
+}
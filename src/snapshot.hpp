@@ -0,0 +1,51 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    snapshot.hpp
+        Save and restore the ensemble database, so that a new run
+        can attribute subchannels and labels from the first frame.
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#pragma once
+
+#include <string>
+#include "ensembledatabase.hpp"
+
+/* The snapshot file is a compact binary file with the layout
+ *
+ *   magic "ESNP", format version (1 byte),
+ *   ensemble, services, subchannels, packet mode components (since
+ *   version 2), FIG 0/6 and FIG 0/22 databases,
+ *   CRC-CCITT over everything before it (2 bytes)
+ *
+ * All integers are big-endian. Labels are saved in raw form, including
+ * the FIG 2 segments received so far, so that incomplete extended labels
+ * can be completed during the next run.
+ *
+ * Both functions print an error and return false on failure.
+ */
+bool snapshot_save(const std::string& filename,
+        const ensemble_database::ensemble_t& ensemble);
+
+/* Replace the contents of ensemble and of the FIG 0/6 and 0/22
+ * databases by the contents of the snapshot. Nothing is modified if
+ * the snapshot cannot be read.
+ */
+bool snapshot_load(const std::string& filename,
+        ensemble_database::ensemble_t& ensemble);
@@ -0,0 +1,252 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    streamdump.cpp
+        Write the data of subchannels to files
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "streamdump.hpp"
+
+using namespace std;
+
+StreamDump::StreamDump(const stream_dump_config_t& config) :
+    m_config(config)
+{
+    if (m_config.filename_template.empty()) {
+        const bool rotate = config.rotate_size > 0 or config.rotate_frames > 0;
+        m_config.filename_template = rotate ?
+            "stream-{subchannel}-{index}.dab" : "stream-{subchannel}.dab";
+    }
+
+    m_writer = thread(&StreamDump::writer_loop, this);
+}
+
+StreamDump::~StreamDump()
+{
+    finish();
+}
+
+void StreamDump::push(int subchid, int fct, const uint8_t *data, size_t len)
+{
+    subchannel_t& sub = m_subchannels[subchid];
+
+    const bool rotate =
+        (m_config.rotate_size > 0 and sub.file_bytes >= m_config.rotate_size) or
+        (m_config.rotate_frames > 0 and sub.file_frames >= m_config.rotate_frames);
+
+    if (sub.file and rotate and fct % 5 == 0) {
+        submit(sub, true);
+        sub.file.reset();
+    }
+
+    if (not sub.file) {
+        sub.file = make_shared<file_t>();
+        sub.file->subchid = subchid;
+        sub.file->index = sub.next_index++;
+        sub.file->start = time(nullptr);
+        sub.file_bytes = 0;
+        sub.file_frames = 0;
+    }
+
+    sub.file_bytes += len;
+    sub.file_frames++;
+
+    while (len > 0) {
+        if (sub.buffer.capacity() == 0) {
+            acquire_buffer(sub);
+        }
+
+        const size_t n = min(len, buffer_size - sub.buffer.size());
+        sub.buffer.insert(sub.buffer.end(), data, data + n);
+        data += n;
+        len -= n;
+
+        if (sub.buffer.size() == buffer_size) {
+            submit(sub, false);
+        }
+    }
+}
+
+void StreamDump::finish()
+{
+    if (m_finished) {
+        return;
+    }
+    m_finished = true;
+
+    for (auto& el : m_subchannels) {
+        if (el.second.file) {
+            submit(el.second, true);
+        }
+    }
+
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    m_writer.join();
+}
+
+string StreamDump::filename(const file_t& file) const
+{
+    string name = m_config.filename_template;
+
+    char eid[8];
+    snprintf(eid, sizeof(eid), "%04x", m_eid);
+
+    const pair<string, string> fields[] = {
+        {"{subchannel}", to_string(file.subchid)},
+        {"{ensemble}", eid},
+        {"{index}", to_string(file.index)},
+    };
+
+    for (const auto& field : fields) {
+        size_t pos = 0;
+        while ((pos = name.find(field.first, pos)) != string::npos) {
+            name.replace(pos, field.first.size(), field.second);
+            pos += field.second.size();
+        }
+    }
+
+    struct tm t;
+    gmtime_r(&file.start, &t);
+
+    // strftime gives 0 for an empty result as well as on overflow
+    vector<char> buf(name.size() * 4 + 256);
+    const size_t len = strftime(buf.data(), buf.size(), name.c_str(), &t);
+    return len > 0 ? string(buf.data(), len) : name;
+}
+
+void StreamDump::submit(subchannel_t& sub, bool close)
+{
+    if (sub.file->filename.empty()) {
+        sub.file->filename = filename(*sub.file);
+    }
+
+    job_t job;
+    job.file = sub.file;
+    job.data = move(sub.buffer);
+    job.close = close;
+
+    sub.buffer = vector<uint8_t>();
+
+    lock_guard<mutex> lock(m_mutex);
+    m_jobs.push_back(move(job));
+    m_cv.notify_all();
+}
+
+void StreamDump::acquire_buffer(subchannel_t& sub)
+{
+    unique_lock<mutex> lock(m_mutex);
+
+    // Only blocks if the disk cannot keep up for several seconds
+    if (m_free.empty() and m_num_buffers >= m_subchannels.size() + spare_buffers) {
+        m_cv.wait(lock, [&]{ return not m_free.empty(); });
+    }
+
+    if (m_free.empty()) {
+        m_num_buffers++;
+        lock.unlock();
+        sub.buffer.reserve(buffer_size);
+    }
+    else {
+        sub.buffer = move(m_free.front());
+        m_free.pop_front();
+    }
+}
+
+// Create the directories leading to filename
+static void create_directories(const string& filename)
+{
+    size_t pos = 0;
+    while ((pos = filename.find('/', pos + 1)) != string::npos) {
+        const string dir = filename.substr(0, pos);
+        if (mkdir(dir.c_str(), 0777) != 0 and errno != EEXIST) {
+            return;
+        }
+    }
+}
+
+void StreamDump::write_job(job_t& job)
+{
+    file_t& file = *job.file;
+
+    if (file.fd == nullptr and not file.error_reported) {
+        create_directories(file.filename);
+        file.fd = fopen(file.filename.c_str(), "w");
+
+        if (file.fd == nullptr) {
+            fprintf(stderr, "Could not open %s: %s\n",
+                    file.filename.c_str(), strerror(errno));
+            file.error_reported = true;
+        }
+        else {
+            // The buffers are large enough, avoid copying them again
+            setvbuf(file.fd, nullptr, _IONBF, 0);
+        }
+    }
+
+    if (file.fd and not job.data.empty()) {
+        const size_t written = fwrite(job.data.data(), 1, job.data.size(), file.fd);
+        if (written != job.data.size() and not file.error_reported) {
+            fprintf(stderr, "Write error on %s: %s\n",
+                    file.filename.c_str(), strerror(errno));
+            file.error_reported = true;
+        }
+    }
+
+    if (job.close and file.fd) {
+        fclose(file.fd);
+        file.fd = nullptr;
+    }
+}
+
+void StreamDump::writer_loop()
+{
+    unique_lock<mutex> lock(m_mutex);
+    while (true) {
+        m_cv.wait(lock, [&]{ return m_stop or not m_jobs.empty(); });
+
+        if (m_jobs.empty()) {
+            // Stopped, and everything is written
+            break;
+        }
+
+        job_t job = move(m_jobs.front());
+        m_jobs.pop_front();
+
+        lock.unlock();
+        write_job(job);
+        job.data.clear();
+        lock.lock();
+
+        // The last job of a file can come without a buffer
+        if (job.data.capacity() > 0) {
+            m_free.push_back(move(job.data));
+        }
+        m_cv.notify_all();
+    }
+}
+
@@ -0,0 +1,133 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    streamdump.hpp
+        Write the data of subchannels to files
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct stream_dump_config_t {
+    /* Name of the files, which can contain directories. {subchannel},
+     * {ensemble} and {index} are replaced by the subchannel id, the
+     * ensemble id in hex and the number of the file, then the strftime
+     * conversions by the UTC time at which the file was started. If empty,
+     * stream-{subchannel}.dab, or stream-{subchannel}-{index}.dab if the
+     * files are rotated. */
+    std::string filename_template;
+
+    // Start a new file after this many bytes, 0 to never rotate by size
+    size_t rotate_size = 0;
+
+    // Start a new file after this many ETI frames, 0 to never rotate by time
+    size_t rotate_frames = 0;
+};
+
+/* StreamDump writes the data of the subchannels to files from a separate
+ * thread. The data of each subchannel is collected in large buffers, so
+ * that the ETI reader only copies it, and each file gets few large
+ * writes. When a file is due for rotation, the next one starts at the
+ * first frame whose FCT is a multiple of five, where DAB+ superframes
+ * start.
+ */
+class StreamDump {
+    public:
+        StreamDump(const stream_dump_config_t& config);
+        ~StreamDump();
+
+        StreamDump(const StreamDump& other) = delete;
+        StreamDump& operator=(const StreamDump& other) = delete;
+
+        // Used in the file names, files that have not been named yet get it
+        void set_ensemble_id(uint16_t eid) { m_eid = eid; }
+
+        // Append the data of subchannel subchid from the frame with count fct
+        void push(int subchid, int fct, const uint8_t *data, size_t len);
+
+        // Write all data, and close the files
+        void finish(void);
+
+    private:
+        // Each buffer holds 1MB, about 4s of the largest subchannel
+        static const size_t buffer_size = 1024 * 1024;
+
+        // Buffers that can wait to be written, on top of the current ones
+        static const size_t spare_buffers = 16;
+
+        struct file_t {
+            int subchid = -1;
+            size_t index = 0;
+            time_t start = 0;
+            std::string filename; // empty until the first write
+            FILE *fd = nullptr;
+            bool error_reported = false;
+        };
+
+        struct job_t {
+            std::shared_ptr<file_t> file;
+            std::vector<uint8_t> data;
+            bool close = false; // last data of the file
+        };
+
+        // Only used by the thread calling push()
+        struct subchannel_t {
+            std::shared_ptr<file_t> file;
+            size_t file_bytes = 0;
+            size_t file_frames = 0;
+            size_t next_index = 0;
+            std::vector<uint8_t> buffer; // no capacity if not acquired
+        };
+
+        std::string filename(const file_t& file) const;
+
+        // Hand the buffer of sub to the writer
+        void submit(subchannel_t& sub, bool close);
+
+        // Give sub an empty buffer, waiting if too many are in use
+        void acquire_buffer(subchannel_t& sub);
+        void writer_loop(void);
+        void write_job(job_t& job);
+
+        stream_dump_config_t m_config;
+        uint16_t m_eid = 0;
+        bool m_finished = false;
+        std::map<int, subchannel_t> m_subchannels;
+
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::deque<job_t> m_jobs;
+        std::deque<std::vector<uint8_t> > m_free;
+        size_t m_num_buffers = 0;
+        bool m_stop = false;
+
+        std::thread m_writer;
+};
+
@@ -0,0 +1,167 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    utilisation.cpp
+        Measure how the capacity of a subchannel is used
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#include <algorithm>
+#include "utilisation.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define UTILISATION_X86_SIMD 1
+#  include <immintrin.h>
+#else
+#  define UTILISATION_X86_SIMD 0
+#endif
+
+using namespace std;
+
+void utilisation_t::add(const utilisation_t& other)
+{
+    payload += other.payload;
+    pad += other.pad;
+    padding += other.padding;
+    overhead += other.overhead;
+    unknown += other.unknown;
+}
+
+double utilisation_t::percent(uint64_t bytes) const
+{
+    const uint64_t total = capacity();
+    return total ? 100.0 * bytes / total : 0;
+}
+
+void UtilisationTracker::add(const utilisation_t& bytes, size_t num_frames)
+{
+    m_stats.total.add(bytes);
+    m_stats.frames += num_frames;
+
+    m_interval.add(bytes);
+    m_interval_frames += num_frames;
+
+    if (m_interval_frames >= utilisation_interval_frames) {
+        const double payload = m_interval.percent(m_interval.payload);
+
+        if (m_stats.num_intervals == 0) {
+            m_stats.min_interval_payload_percent = payload;
+            m_stats.max_interval_payload_percent = payload;
+        }
+        else {
+            m_stats.min_interval_payload_percent =
+                min(m_stats.min_interval_payload_percent, payload);
+            m_stats.max_interval_payload_percent =
+                max(m_stats.max_interval_payload_percent, payload);
+        }
+        m_stats.num_intervals++;
+
+        m_interval = utilisation_t();
+        m_interval_frames = 0;
+    }
+}
+
+/* The kernels count the zero fill of data, continuing the run of zero
+ * bytes of length run that ended just before data. They return the
+ * length of the run at the end of data, which is not included in fill. */
+typedef size_t (*zero_fill_kernel_t)(const uint8_t *data, size_t len,
+        size_t run, size_t& fill);
+
+static size_t zero_fill_scalar(const uint8_t *data, size_t len,
+        size_t run, size_t& fill)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] == 0) {
+            run++;
+        }
+        else {
+            if (run >= zero_fill_min_run) {
+                fill += run;
+            }
+            run = 0;
+        }
+    }
+    return run;
+}
+
+#if UTILISATION_X86_SIMD
+/* Blocks of 16 bytes that are all zero or all non-zero only need one
+ * comparison. Only the others are handled byte by byte, using the mask
+ * of zero bytes. */
+__attribute__((target("sse2")))
+static size_t zero_fill_sse2(const uint8_t *data, size_t len,
+        size_t run, size_t& fill)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+        const unsigned zeros = _mm_movemask_epi8(_mm_cmpeq_epi8(v, zero));
+
+        if (zeros == 0xFFFF) {
+            run += 16;
+        }
+        else if (zeros == 0) {
+            if (run >= zero_fill_min_run) {
+                fill += run;
+            }
+            run = 0;
+        }
+        else {
+            for (int bit = 0; bit < 16; bit++) {
+                if (zeros & (1u << bit)) {
+                    run++;
+                }
+                else {
+                    if (run >= zero_fill_min_run) {
+                        fill += run;
+                    }
+                    run = 0;
+                }
+            }
+        }
+    }
+
+    return zero_fill_scalar(data + i, len - i, run, fill);
+}
+#endif
+
+static zero_fill_kernel_t select_zero_fill_kernel()
+{
+#if UTILISATION_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        return zero_fill_sse2;
+    }
+#endif
+    return zero_fill_scalar;
+}
+
+static const zero_fill_kernel_t zero_fill_kernel = select_zero_fill_kernel();
+
+size_t count_zero_fill(const uint8_t *data, size_t len)
+{
+    size_t fill = 0;
+    const size_t run = zero_fill_kernel(data, len, 0, fill);
+    if (run >= zero_fill_min_run) {
+        fill += run;
+    }
+    return fill;
+}
+
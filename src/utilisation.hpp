@@ -0,0 +1,87 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    utilisation.hpp
+        Measure how the capacity of a subchannel is used
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Bytes of a subchannel, by what they carry
+struct utilisation_t {
+    uint64_t payload = 0;  // Audio, or the useful data of packets
+    uint64_t pad = 0;      // PAD in the AUs of DAB+
+    uint64_t padding = 0;  // Zero fill, padding packets and unused packet data
+    uint64_t overhead = 0; // Headers, CRCs and RS parity
+    uint64_t unknown = 0;  // Not analysed, e.g. because of errors
+
+    void add(const utilisation_t& other);
+
+    uint64_t capacity(void) const {
+        return payload + pad + padding + overhead + unknown;
+    }
+
+    // Share of the capacity in percent, 0 without capacity
+    double percent(uint64_t bytes) const;
+};
+
+// Duration of the intervals, in 24ms logical frames
+const size_t utilisation_interval_frames = 2500; // 60s
+
+struct utilisation_statistics_t {
+    utilisation_t total;
+    size_t frames = 0;
+
+    /* The payload share of each complete interval of
+     * utilisation_interval_frames. Only the lowest and highest are kept. */
+    size_t num_intervals = 0;
+    double min_interval_payload_percent = 0;
+    double max_interval_payload_percent = 0;
+
+    // Capacity in kbit/s, 0 if nothing was received
+    double capacity_kbps(void) const {
+        return frames > 0 ? total.capacity() * 8.0 / (frames * 24) : 0;
+    }
+};
+
+class UtilisationTracker {
+    public:
+        // Account the bytes of num_frames logical frames
+        void add(const utilisation_t& bytes, size_t num_frames);
+
+        const utilisation_statistics_t& get_statistics(void) const {
+            return m_stats;
+        }
+
+    private:
+        utilisation_t m_interval;
+        size_t m_interval_frames = 0;
+        utilisation_statistics_t m_stats;
+};
+
+// Shortest run of zero bytes that is considered to be padding
+const size_t zero_fill_min_run = 8;
+
+/* Count the bytes in runs of at least zero_fill_min_run zero bytes. Uses
+ * SSE2 when the CPU supports it. */
+size_t count_zero_fill(const uint8_t *data, size_t len);
+
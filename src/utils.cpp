@@ -286,9 +286,14 @@ std::string pnum_to_str(uint16_t Programme_Number)
 }
 
 int absolute_to_dB(int16_t value)
+{
+    return absolute_to_dB((double)value);
+}
+
+int absolute_to_dB(double value)
 {
     const int16_t int16_max = std::numeric_limits<int16_t>::max();
-    return value ? round(20*log10((double)value / int16_max)) : -90;
+    return value > 0 ? round(20*log10(value / int16_max)) : -90;
 }
 
 uint32_t read_u32_from_buf(const uint8_t *buf)
@@ -102,5 +102,8 @@ std::string pnum_to_str(uint16_t Programme_Number);
 // -90dB
 int absolute_to_dB(int16_t value);
 
+// Same for mean or RMS levels on the 16-bit scale
+int absolute_to_dB(double value);
+
 uint32_t read_u32_from_buf(const uint8_t *buf);
 uint16_t read_u16_from_buf(const uint8_t *buf);
@@ -5,28 +5,49 @@ For complete documentation, see:
 http://www.nd.edu/~dthain/courses/cse20211/fall2013/wavfile
 */
 
+/* For fseeko and ftello with 64-bit offsets */
+#define _FILE_OFFSET_BITS 64
+#define _POSIX_C_SOURCE 200809L
+
 #include "wavfile.h"
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/types.h>
 
+/* The header reserves space for the ds64 chunk of RF64 (EBU Tech 3306) in
+ * a JUNK chunk. It is only used if the file grows beyond 4GB, readers skip
+ * the JUNK chunk otherwise. */
 struct wavfile_header {
-    char    riff_tag[4];
-    int     riff_length;
-    char    wave_tag[4];
-    char    fmt_tag[4];
-    int     fmt_length;
-    short   audio_format;
-    short   num_channels;
-    int     sample_rate;
-    int     byte_rate;
-    short   block_align;
-    short   bits_per_sample;
-    char    data_tag[4];
-    int     data_length;
+    char     riff_tag[4];
+    uint32_t riff_length;
+    char     wave_tag[4];
+    char     junk_tag[4];
+    uint32_t junk_length;
+    uint8_t  junk[28];
+    char     fmt_tag[4];
+    uint32_t fmt_length;
+    uint16_t audio_format;
+    uint16_t num_channels;
+    uint32_t sample_rate;
+    uint32_t byte_rate;
+    uint16_t block_align;
+    uint16_t bits_per_sample;
+    char     data_tag[4];
+    uint32_t data_length;
 };
 
+struct wavfile_ds64 {
+    char     ds64_tag[4];
+    uint32_t ds64_length;
+    uint64_t riff_length;
+    uint64_t data_length;
+    uint64_t sample_count;
+    uint32_t table_length;
+} __attribute__((packed));
+
 FILE * wavfile_open( const char *filename, int rate )
 {
     struct wavfile_header header;
@@ -34,14 +55,17 @@ FILE * wavfile_open( const char *filename, int rate )
     int samples_per_second = rate;
     int bits_per_sample = 16;
 
-    strncpy(header.riff_tag,"RIFF",4);
-    strncpy(header.wave_tag,"WAVE",4);
-    strncpy(header.fmt_tag,"fmt ",4);
-    strncpy(header.data_tag,"data",4);
+    memcpy(header.riff_tag,"RIFF",4);
+    memcpy(header.wave_tag,"WAVE",4);
+    memcpy(header.junk_tag,"JUNK",4);
+    memcpy(header.fmt_tag,"fmt ",4);
+    memcpy(header.data_tag,"data",4);
 
     int channels = 2;
 
     header.riff_length = 0;
+    header.junk_length = sizeof(header.junk);
+    memset(header.junk, 0, sizeof(header.junk));
     header.fmt_length = 16;
     header.audio_format = 1;
     header.num_channels = channels;
@@ -62,23 +86,48 @@ FILE * wavfile_open( const char *filename, int rate )
 
 }
 
-void wavfile_write( FILE *file, short data[], int length )
+void wavfile_write( FILE *file, const short data[], size_t length )
 {
     fwrite(data,sizeof(short),length,file);
 }
 
 void wavfile_close( FILE *file )
 {
-    int file_length = ftell(file);
-
-    int data_length = file_length - sizeof(struct wavfile_header);
-    fseek(file,sizeof(struct wavfile_header) - sizeof(int),SEEK_SET);
-    fwrite(&data_length,sizeof(data_length),1,file);
-
-    int riff_length = file_length - 8;
-    fseek(file,4,SEEK_SET);
-    fwrite(&riff_length,sizeof(riff_length),1,file);
+    const uint64_t file_length = ftello(file);
+    const uint64_t data_length = file_length - sizeof(struct wavfile_header);
+    const uint64_t riff_length = file_length - 8;
+
+    if (riff_length <= UINT32_MAX) {
+        uint32_t length = data_length;
+        fseeko(file,sizeof(struct wavfile_header) - sizeof(uint32_t),SEEK_SET);
+        fwrite(&length,sizeof(length),1,file);
+
+        length = riff_length;
+        fseeko(file,4,SEEK_SET);
+        fwrite(&length,sizeof(length),1,file);
+    }
+    else {
+        /* RF64: the 32-bit lengths are set to 0xFFFFFFFF, and the
+         * real ones are in the ds64 chunk that replaces the JUNK chunk */
+        const uint32_t unknown_length = UINT32_MAX;
+
+        fseeko(file,sizeof(struct wavfile_header) - sizeof(uint32_t),SEEK_SET);
+        fwrite(&unknown_length,sizeof(unknown_length),1,file);
+
+        fseeko(file,0,SEEK_SET);
+        fwrite("RF64",4,1,file);
+        fwrite(&unknown_length,sizeof(unknown_length),1,file);
+
+        struct wavfile_ds64 ds64;
+        memcpy(ds64.ds64_tag,"ds64",4);
+        ds64.ds64_length = 28;
+        ds64.riff_length = riff_length;
+        ds64.data_length = data_length;
+        ds64.sample_count = data_length / 4;
+        ds64.table_length = 0;
+        fseeko(file,12,SEEK_SET);
+        fwrite(&ds64,sizeof(ds64),1,file);
+    }
 
     fclose(file);
 }
-
@@ -8,10 +8,12 @@ http://www.nd.edu/~dthain/courses/cse20211/fall2013/wavfile
 #ifndef WAVFILE_H
 #define WAVFILE_H
 
+#include <stddef.h>
 #include <stdio.h>
 
+/* Writes 16-bit stereo. Files larger than 4GB are closed as RF64. */
 FILE * wavfile_open( const char *filename, int rate );
-void wavfile_write( FILE *file, short data[], int length );
+void wavfile_write( FILE *file, const short data[], size_t length );
 void wavfile_close( FILE * file );
 
 #endif
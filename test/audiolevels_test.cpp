@@ -0,0 +1,155 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    audiolevels_test.cpp
+        Compare the SIMD level kernels with the scalar one, for mono and
+        stereo audio of any length
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// The level kernels are private to audiolevels.cpp
+#include "../src/audiolevels.cpp"
+
+struct kernel_under_test_t {
+    const char *name;
+    levels_kernel_t kernel;
+};
+
+static vector<kernel_under_test_t> supported_kernels()
+{
+    vector<kernel_under_test_t> kernels;
+#if AUDIOLEVELS_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        kernels.push_back({"sse2", accumulate_sse2});
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.push_back({"avx2", accumulate_avx2});
+    }
+#endif
+    return kernels;
+}
+
+static int failures = 0;
+
+static bool same_levels(const channel_levels_t& a, const channel_levels_t& b)
+{
+    return a.num_samples == b.num_samples and a.sum_abs == b.sum_abs and
+        a.sum_squares == b.sum_squares and a.peak == b.peak and
+        a.num_clipped == b.num_clipped;
+}
+
+static void compare_kernels(const vector<kernel_under_test_t>& kernels,
+        const int16_t *samples, size_t num_samples, const char *what)
+{
+    channel_levels_t expected_even, expected_odd;
+    accumulate_scalar(expected_even, expected_odd, samples, num_samples);
+
+    for (const auto& k : kernels) {
+        channel_levels_t even, odd;
+        k.kernel(even, odd, samples, num_samples);
+
+        if (not same_levels(even, expected_even) or
+                not same_levels(odd, expected_odd)) {
+            fprintf(stderr, "FAIL: %s kernel, %s, %zu samples\n",
+                    k.name, what, num_samples);
+            failures++;
+        }
+    }
+}
+
+// The levels through audio_levels_accumulate, computed with the scalar kernel
+static audio_levels_t scalar_levels(const int16_t *samples, size_t num_samples,
+        int channels)
+{
+    audio_levels_t levels;
+    channel_levels_t odd;
+    accumulate_scalar(levels.left, channels == 2 ? levels.right : odd,
+            samples, num_samples);
+    if (channels == 2) {
+        levels.left.num_samples = (num_samples + 1) / 2;
+        levels.right.num_samples = num_samples / 2;
+    }
+    else {
+        levels.left.add(odd);
+        levels.left.num_samples = num_samples;
+    }
+    return levels;
+}
+
+int main()
+{
+    const auto kernels = supported_kernels();
+    mt19937 rng(1);
+
+    // Random audio with some samples at full scale
+    vector<int16_t> samples(1024);
+    for (auto& s : samples) {
+        const uint32_t r = rng();
+        s = (r % 16 == 0) ? ((r & 0x10) ? INT16_MAX : INT16_MIN) : (int16_t)(r >> 16);
+    }
+
+    // All lengths around the vector widths, at even and odd start positions
+    for (size_t offset = 0; offset < 4; offset++) {
+        for (size_t len = 0; len <= 100; len++) {
+            compare_kernels(kernels, samples.data() + offset, len,
+                    "random samples");
+        }
+    }
+    compare_kernels(kernels, samples.data() + 1, samples.size() - 1,
+            "random samples");
+
+    /* Enough full-scale samples to go through several blocks, which
+     * would overflow the 32-bit lanes if they were not flushed */
+    for (const int16_t full_scale : {INT16_MAX, INT16_MIN}) {
+        const vector<int16_t> loud(16 * block_iterations * 3 + 7, full_scale);
+        compare_kernels(kernels, loud.data(), loud.size(), "full scale");
+    }
+
+    // Mono and stereo through the public function
+    for (const int channels : {1, 2}) {
+        for (const size_t len : {0, 1, 7, 31, 1023}) {
+            audio_levels_t levels;
+            audio_levels_accumulate(levels, samples.data(), len, channels);
+            const audio_levels_t expected = scalar_levels(samples.data(), len, channels);
+
+            if (not same_levels(levels.left, expected.left) or
+                    not same_levels(levels.right, expected.right)) {
+                fprintf(stderr, "FAIL: audio_levels_accumulate, %d channels, "
+                        "%zu samples\n", channels, len);
+                failures++;
+            }
+        }
+    }
+
+    printf("Kernels: scalar");
+    for (const auto& k : kernels) {
+        printf(" %s", k.name);
+    }
+    printf("\n");
+
+    if (failures) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
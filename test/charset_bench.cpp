@@ -0,0 +1,95 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    charset_bench.cpp
+        Measure the labels per second of the previous and the current
+        EBU Latin and UCS-2 converters
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#include "charset_reference.hpp"
+
+// 16 character labels, like those of FIG 1
+static const size_t num_labels = 1000;
+static const size_t label_len = 16;
+static const int rounds = 200;
+
+static void bench(const char *name, function<size_t(size_t)> convert)
+{
+    // Warm up, and give the result a use
+    size_t bytes = 0;
+    for (size_t i = 0; i < num_labels; i++) {
+        bytes += convert(i);
+    }
+
+    const auto start = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < num_labels; i++) {
+            bytes += convert(i);
+        }
+    }
+    const double seconds = chrono::duration<double>(
+            chrono::steady_clock::now() - start).count();
+
+    printf("%-24s %12.0f labels/s (%zu bytes)\n", name,
+            rounds * num_labels / seconds, bytes);
+}
+
+int main()
+{
+    mt19937 rng(1);
+
+    // Half of the labels contain accented characters
+    vector<string> ebu(num_labels, string(label_len, ' '));
+    for (size_t i = 0; i < num_labels; i++) {
+        for (auto& c : ebu[i]) {
+            c = (i % 2 and rng() % 4 == 0) ? 0x80 + rng() % 0x80 : 0x20 + rng() % 0x5B;
+        }
+    }
+
+    vector<vector<uint8_t> > ucs2(num_labels);
+    for (size_t i = 0; i < num_labels; i++) {
+        for (size_t j = 0; j < label_len; j++) {
+            const uint16_t c = (i % 2 and rng() % 4 == 0) ?
+                0xA0 + rng() % 0x100 : 0x20 + rng() % 0x5F;
+            ucs2[i].push_back(c >> 8);
+            ucs2[i].push_back(c & 0xFF);
+        }
+    }
+
+    string utf8;
+
+    bench("EBU Latin, previous", [&](size_t i) {
+            return reference_ebu_to_utf8(ebu[i]).size(); });
+    bench("EBU Latin, current", [&](size_t i) {
+            convert_ebu_to_utf8((const uint8_t*)ebu[i].data(), ebu[i].size(), utf8);
+            return utf8.size(); });
+    bench("UCS-2, previous", [&](size_t i) {
+            return reference_ucs2_to_utf8(ucs2[i].data(), ucs2[i].size()).size(); });
+    bench("UCS-2, current", [&](size_t i) {
+            convert_ucs2_to_utf8(ucs2[i].data(), ucs2[i].size(), utf8);
+            return utf8.size(); });
+
+    return 0;
+}
@@ -0,0 +1,68 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    charset_reference.hpp
+        The character set converters as they were before the table-driven
+        ones, to compare the current ones against
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#pragma once
+
+#include <locale>
+#include <codecvt>
+#include <string>
+
+// The reference needs the EBU Latin table, which is private to charset.cpp
+#include "../src/charset.cpp"
+
+// One character at a time, appending the UTF-8 of each
+static std::string reference_ebu_to_utf8(const std::string& str)
+{
+    std::string utf8_str;
+    for (const uint8_t c : str) {
+        // Table offset because NUL is not represented
+        if (c >= CHARSET_TABLE_OFFSET) {
+            std::string utf8_char(utf8_encoded_EBU_Latin[c - CHARSET_TABLE_OFFSET]);
+            utf8_str += utf8_char;
+        }
+        else {
+            utf8_str += "⁇";
+        }
+    }
+
+    return utf8_str;
+}
+
+/* Only defined for an even len_bytes of at least 2, and throws range_error
+ * on surrogates */
+static std::string reference_ucs2_to_utf8(const uint8_t *ucs2, size_t len_bytes)
+{
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+    std::wstring_convert<std::codecvt_utf8<wchar_t>> ucsconv;
+#pragma GCC diagnostic pop
+
+    std::wstring ucs2label;
+
+    for (size_t i = 0; i < len_bytes-1; i+=2) {
+        ucs2label += (wchar_t)(ucs2[i] * 256uL + ucs2[i+1]);
+    }
+
+    return ucsconv.to_bytes(ucs2label);
+}
@@ -0,0 +1,140 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    charset_test.cpp
+        Compare the EBU Latin and UCS-2 converters with the previous ones,
+        and check the handling of invalid UCS-2 input
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "charset_reference.hpp"
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (not ok) {
+        fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static void check_ebu_code_points()
+{
+    string all;
+    for (int c = 0; c < 256; c++) {
+        const string one(1, (char)c);
+        if (convert_ebu_to_utf8(one) != reference_ebu_to_utf8(one)) {
+            fprintf(stderr, "FAIL: EBU Latin code point 0x%02x\n", c);
+            failures++;
+        }
+        all += one;
+    }
+
+    check(convert_ebu_to_utf8(all) == reference_ebu_to_utf8(all),
+            "EBU Latin string of all code points");
+
+    // The overload replaces the previous contents
+    string utf8 = "previous contents";
+    convert_ebu_to_utf8((const uint8_t*)all.data(), all.size(), utf8);
+    check(utf8 == reference_ebu_to_utf8(all), "EBU Latin into existing string");
+
+    convert_ebu_to_utf8(nullptr, 0, utf8);
+    check(utf8.empty(), "empty EBU Latin string");
+
+    // Labels with and without multi-byte characters
+    mt19937 rng(1);
+    for (int i = 0; i < 10000; i++) {
+        string label(rng() % 17, ' ');
+        const bool ascii_only = i % 2;
+        for (auto& c : label) {
+            c = ascii_only ? 0x20 + rng() % 0x5B : rng() % 256;
+        }
+        if (convert_ebu_to_utf8(label) != reference_ebu_to_utf8(label)) {
+            check(false, "random EBU Latin label");
+            break;
+        }
+    }
+}
+
+static string ucs2_to_utf8(const vector<uint8_t>& ucs2, bool& valid)
+{
+    string utf8;
+    valid = convert_ucs2_to_utf8(ucs2.data(), ucs2.size(), utf8);
+    return utf8;
+}
+
+static void check_ucs2()
+{
+    bool valid = false;
+
+    // All characters outside of the surrogates, in one string
+    vector<uint8_t> bmp;
+    for (uint32_t c = 1; c < 0x10000; c++) {
+        if (c < 0xD800 or c > 0xDFFF) {
+            bmp.push_back(c >> 8);
+            bmp.push_back(c & 0xFF);
+        }
+    }
+    check(ucs2_to_utf8(bmp, valid) == reference_ucs2_to_utf8(bmp.data(), bmp.size()) and
+            valid, "UCS-2 string of all valid characters");
+
+    const vector<uint8_t> ascii = {0x00, 'A', 0x00, 'b'};
+    check(ucs2_to_utf8(ascii, valid) == "Ab" and valid, "UCS-2 ASCII");
+
+    const vector<uint8_t> latin = {0x00, 0xE9, 0x20, 0xAC};
+    check(ucs2_to_utf8(latin, valid) == "é€" and valid, "UCS-2 non-ASCII");
+
+    // A trailing odd byte is ignored
+    check(ucs2_to_utf8({}, valid) == "" and valid, "UCS-2 empty");
+    check(ucs2_to_utf8({0x00}, valid) == "" and valid, "UCS-2 single byte");
+    check(ucs2_to_utf8({0x00, 'A', 0x00}, valid) == "A" and valid,
+            "UCS-2 odd length, ASCII");
+    check(ucs2_to_utf8({0x00, 0xE9, 0x20}, valid) == "é" and valid,
+            "UCS-2 odd length, non-ASCII");
+
+    // Surrogates are not UCS-2, even when they form a UTF-16 pair
+    check(ucs2_to_utf8({0xD8, 0x00}, valid) == "⁇" and not valid,
+            "UCS-2 lone high surrogate");
+    check(ucs2_to_utf8({0x00, 'A', 0xDC, 0x00}, valid) == "A⁇" and not valid,
+            "UCS-2 lone low surrogate");
+    check(ucs2_to_utf8({0xD8, 0x3D, 0xDE, 0x00, 0x00, 'x'}, valid) == "⁇⁇x" and
+            not valid, "UCS-2 surrogate pair");
+
+    // NUL is a character like any other
+    check(ucs2_to_utf8({0x00, 'A', 0x00, 0x00, 0x00, 'B'}, valid) ==
+            string("A\0B", 3) and valid, "UCS-2 embedded NUL, ASCII");
+    check(ucs2_to_utf8({0x00, 0x00, 0x00, 0xE9, 0x00, 0x00}, valid) ==
+            string("\0é\0", 4) and valid, "UCS-2 embedded NUL, non-ASCII");
+}
+
+int main()
+{
+    check_ebu_code_points();
+    check_ucs2();
+
+    if (failures) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
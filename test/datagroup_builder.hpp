@@ -0,0 +1,230 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    datagroup_builder.hpp
+        Build MSC data groups, MOT objects and directories, and the X-PAD
+        and packets that carry them, to feed synthetic data to the decoders
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+extern "C" {
+#include "../src/lib_crc.h"
+}
+
+typedef std::vector<uint8_t> bytes_t;
+
+inline bytes_t random_bytes(std::mt19937& rng, size_t len)
+{
+    bytes_t data(len);
+    for (auto& b : data) {
+        b = rng();
+    }
+    return data;
+}
+
+// Append the CRC-CCITT of all the bytes of data
+inline void append_crc(bytes_t& data)
+{
+    uint16_t crc = 0xFFFF;
+    for (const uint8_t b : data) {
+        crc = update_crc_ccitt(crc, b);
+    }
+    crc = ~crc;
+    data.push_back(crc >> 8);
+    data.push_back(crc & 0xFF);
+}
+
+/* MSC data group with CRC, segment field and a transport id, as used by
+ * MOT. The segmentation header has a repetition count of 0. */
+inline bytes_t msc_data_group(int dg_type, uint16_t transport_id,
+        int segment, bool last, const bytes_t& segment_data)
+{
+    bytes_t dg = {
+        (uint8_t)(0x40 | 0x20 | 0x10 | dg_type), 0x00,
+        (uint8_t)((last ? 0x80 : 0x00) | (segment >> 8)), (uint8_t)segment,
+        0x10 | 2, (uint8_t)(transport_id >> 8), (uint8_t)transport_id,
+        (uint8_t)(segment_data.size() >> 8), (uint8_t)segment_data.size()};
+    dg.insert(dg.end(), segment_data.begin(), segment_data.end());
+    append_crc(dg);
+    return dg;
+}
+
+// MOT header core and a UTF-8 ContentName
+inline bytes_t mot_header(size_t body_size, int content_type,
+        int content_subtype, const std::string& name)
+{
+    const size_t header_size = 7 + 3 + name.size();
+    bytes_t h = {
+        (uint8_t)(body_size >> 20), (uint8_t)(body_size >> 12),
+        (uint8_t)(body_size >> 4),
+        (uint8_t)(((body_size & 0x0F) << 4) | (header_size >> 9)),
+        (uint8_t)(header_size >> 1),
+        (uint8_t)(((header_size & 1) << 7) | (content_type << 1) |
+                (content_subtype >> 8)),
+        (uint8_t)content_subtype,
+        0xC0 | 0x0C, (uint8_t)(name.size() + 1), 0xF0};
+    for (const char c : name) {
+        h.push_back(c);
+    }
+    return h;
+}
+
+// The data groups of the body, in segments of at most segment_size bytes
+inline std::vector<bytes_t> mot_body(uint16_t transport_id,
+        const bytes_t& body, size_t segment_size)
+{
+    std::vector<bytes_t> dgs;
+    for (size_t pos = 0, segment = 0; pos < body.size();
+            pos += segment_size, segment++) {
+        const size_t len = std::min(segment_size, body.size() - pos);
+        const bytes_t data(body.begin() + pos, body.begin() + pos + len);
+        dgs.push_back(msc_data_group(4, transport_id, segment,
+                    pos + len == body.size(), data));
+    }
+    return dgs;
+}
+
+// Header mode: the header in one data group, followed by the body
+inline std::vector<bytes_t> mot_object(uint16_t transport_id,
+        const bytes_t& body, const std::string& name, size_t segment_size)
+{
+    std::vector<bytes_t> dgs = {msc_data_group(3, transport_id, 0, true,
+            mot_header(body.size(), 2, 1, name))};
+    for (const auto& dg : mot_body(transport_id, body, segment_size)) {
+        dgs.push_back(dg);
+    }
+    return dgs;
+}
+
+struct mot_directory_entry_t {
+    uint16_t transport_id;
+    size_t body_size;
+    std::string name;
+};
+
+// Uncompressed MOT directory without directory extension
+inline bytes_t mot_directory(const std::vector<mot_directory_entry_t>& entries)
+{
+    bytes_t d(13, 0);
+    d[4] = entries.size() >> 8;
+    d[5] = entries.size() & 0xFF;
+    for (const auto& e : entries) {
+        d.push_back(e.transport_id >> 8);
+        d.push_back(e.transport_id & 0xFF);
+        const bytes_t h = mot_header(e.body_size, 2, 3, e.name);
+        d.insert(d.end(), h.begin(), h.end());
+    }
+    d[0] = (d.size() >> 24) & 0x3F;
+    d[1] = d.size() >> 16;
+    d[2] = d.size() >> 8;
+    d[3] = d.size();
+    return d;
+}
+
+/* The X-PAD of one AU, in transmission order, and its two F-PAD bytes.
+ * In the AU, the X-PAD is reversed. */
+struct pad_t {
+    bytes_t xpad;
+    uint8_t fpad[2];
+};
+
+inline pad_t variable_xpad(const bytes_t& xpad, bool ci_flag)
+{
+    return {xpad, {0x20, (uint8_t)(ci_flag ? 0x02 : 0x00)}};
+}
+
+/* Variable size X-PADs with one data subfield of subfield_len bytes each.
+ * The first one has a CI of application type appty, the following ones
+ * continue it. */
+inline std::vector<pad_t> xpads_for(int appty, const bytes_t& data,
+        size_t subfield_len)
+{
+    const size_t lengths[8] = { 4, 6, 8, 12, 16, 24, 32, 48 };
+    const int length_index = std::find(lengths, lengths + 8, subfield_len) - lengths;
+
+    std::vector<pad_t> pads;
+    for (size_t pos = 0; pos < data.size(); pos += subfield_len) {
+        bytes_t xpad;
+        if (pos == 0) {
+            xpad = {(uint8_t)((length_index << 5) | appty), 0x00};
+        }
+        bytes_t subfield(data.begin() + pos,
+                data.begin() + std::min(pos + subfield_len, data.size()));
+        subfield.resize(subfield_len);
+        xpad.insert(xpad.end(), subfield.begin(), subfield.end());
+        pads.push_back(variable_xpad(xpad, pos == 0));
+    }
+    return pads;
+}
+
+// A MOT data group in X-PAD, preceded by its data group length indicator
+inline std::vector<pad_t> xpads_for_mot(const bytes_t& dg, bool corrupt_dgli = false)
+{
+    bytes_t dgli = {(uint8_t)(dg.size() >> 8), (uint8_t)dg.size()};
+    append_crc(dgli);
+    if (corrupt_dgli) {
+        dgli[1] ^= 1;
+    }
+
+    std::vector<pad_t> pads = xpads_for(1, dgli, 4);
+    for (const auto& pad : xpads_for(12, dg, 32)) {
+        pads.push_back(pad);
+    }
+    return pads;
+}
+
+/* Packet with a correct CRC. The useful data is padded to the packet
+ * length. */
+inline bytes_t packet(size_t length, int continuity_index, bool first,
+        bool last, int address, const bytes_t& data)
+{
+    const int length_index = length / 24 - 1;
+    bytes_t p = {
+        (uint8_t)((length_index << 6) | (continuity_index << 4) |
+                (first ? 0x08 : 0) | (last ? 0x04 : 0) | (address >> 8)),
+        (uint8_t)address, (uint8_t)data.size()};
+    p.insert(p.end(), data.begin(), data.end());
+    p.resize(length - 2);
+    append_crc(p);
+    return p;
+}
+
+/* Split a data group into packets of the given length for address,
+ * continuing the continuity index */
+inline std::vector<bytes_t> packets_for(const bytes_t& dg, size_t length,
+        int address, int& continuity_index)
+{
+    const size_t data_len = length - 5;
+    std::vector<bytes_t> packets;
+    for (size_t pos = 0; pos < dg.size(); pos += data_len) {
+        const size_t len = std::min(data_len, dg.size() - pos);
+        const bytes_t data(dg.begin() + pos, dg.begin() + pos + len);
+        packets.push_back(packet(length, continuity_index, pos == 0,
+                    pos + len == dg.size(), address, data));
+        continuity_index = (continuity_index + 1) & 0x03;
+    }
+    return packets;
+}
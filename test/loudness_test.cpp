@@ -0,0 +1,214 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    loudness_test.cpp
+        Compare the SIMD K-weighting and true peak kernels of the loudness
+        meter with the scalar ones, for mono and stereo audio of any length,
+        and check that the meter keeps its measurements when the audio
+        switches between mono and stereo
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// The kernels are private to loudness.cpp
+#include "../src/loudness.cpp"
+
+/* The vector kernels may sum in another order, and the AVX2 true peak
+ * kernel uses fused multiply-adds */
+static const double kweighting_tolerance = 1e-12;
+static const float true_peak_tolerance = 1e-5f;
+
+static int failures = 0;
+
+static bool close_to(double value, double expected, double tolerance)
+{
+    return fabs(value - expected) <= tolerance * max(1.0, fabs(expected));
+}
+
+struct kweighting_state_t {
+    double shelving[4] = {};
+    double highpass[4] = {};
+    double sums[2] = {};
+};
+
+static void check_kweighting(const char *name, kweighting_kernel_t kernel,
+        const loudness_biquad_t& shelving, const loudness_biquad_t& highpass,
+        const vector<int16_t>& samples, int channels)
+{
+    kweighting_state_t expected, state;
+
+    /* Filter in chunks of varying odd and even lengths, so that the state
+     * is carried over between calls */
+    const size_t num_frames = samples.size() / channels;
+    size_t pos = 0;
+    for (size_t len = 0; pos < num_frames; len++) {
+        len = min(len, num_frames - pos);
+        const int16_t *chunk = samples.data() + pos * channels;
+
+        kweighting_scalar(shelving, highpass, expected.shelving,
+                expected.highpass, chunk, len, channels, expected.sums);
+        kernel(shelving, highpass, state.shelving, state.highpass,
+                chunk, len, channels, state.sums);
+        pos += len;
+
+        bool same = true;
+        for (int k = 0; k < 4; k++) {
+            same &= close_to(state.shelving[k], expected.shelving[k], kweighting_tolerance);
+            same &= close_to(state.highpass[k], expected.highpass[k], kweighting_tolerance);
+        }
+        for (int ch = 0; ch < 2; ch++) {
+            same &= close_to(state.sums[ch], expected.sums[ch], kweighting_tolerance);
+        }
+
+        if (not same) {
+            fprintf(stderr, "FAIL: %s K-weighting, %d channels, "
+                    "chunk of %zu frames at %zu\n", name, channels, len, pos - len);
+            failures++;
+            return;
+        }
+    }
+}
+
+static void check_true_peak(const char *name, true_peak_kernel_t kernel,
+        const vector<float>& x)
+{
+    const true_peak_fir_t& fir = get_true_peak_fir();
+
+    for (size_t len = 0; true_peak_history + len <= x.size(); len++) {
+        for (size_t offset = 0; offset < 4; offset++) {
+            if (offset + true_peak_history + len > x.size()) {
+                break;
+            }
+
+            const float *xo = x.data() + offset;
+            const float expected = true_peak_scalar(fir, xo, len);
+            const float peak = kernel(fir, xo, len);
+
+            if (not close_to(peak, expected, true_peak_tolerance)) {
+                fprintf(stderr, "FAIL: %s true peak, %zu samples at %zu: "
+                        "%f, expected %f\n", name, len, offset, peak, expected);
+                failures++;
+            }
+        }
+    }
+}
+
+/* Switching between mono and stereo must keep the measurements, and only
+ * restart the sub-block in progress */
+static void check_channel_change(const vector<int16_t>& samples)
+{
+    LoudnessMeter meter;
+    meter.configure(48000, 2);
+
+    // 250ms of stereo, 250ms of mono, then stereo again for 1s
+    meter.process(samples.data(), 2 * 4800);
+    meter.process(samples.data(), 2 * 4800);
+    meter.process(samples.data(), 2 * 2400);
+    meter.set_channels(1);
+    meter.process(samples.data(), 9600);
+    meter.process(samples.data(), 2400);
+    meter.set_channels(2);
+    for (int i = 0; i < 10; i++) {
+        meter.process(samples.data(), 2 * 4800);
+    }
+
+    if (not close_to(meter.duration(), 1.4, 1e-9)) {
+        fprintf(stderr, "FAIL: %.1fs measured across channel changes, "
+                "expected 1.4s\n", meter.duration());
+        failures++;
+    }
+
+    if (not isfinite(meter.integrated()) or not isfinite(meter.true_peak())) {
+        fprintf(stderr, "FAIL: no loudness across channel changes\n");
+        failures++;
+    }
+}
+
+struct kernels_under_test_t {
+    const char *name;
+    kweighting_kernel_t kweighting;
+    true_peak_kernel_t true_peak;
+};
+
+static vector<kernels_under_test_t> supported_kernels()
+{
+    vector<kernels_under_test_t> kernels;
+#if LOUDNESS_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        kernels.push_back({"sse2", kweighting_sse2, true_peak_sse2});
+    }
+    if (__builtin_cpu_supports("avx2") and __builtin_cpu_supports("fma")) {
+        // There is no AVX2 K-weighting kernel
+        kernels.push_back({"avx2", nullptr, true_peak_avx2});
+    }
+#endif
+    return kernels;
+}
+
+int main()
+{
+    const auto kernels = supported_kernels();
+    mt19937 rng(1);
+
+    // The K-weighting filter of BS.1770 at 48 kHz
+    const loudness_biquad_t shelving = {1.53512485958697, -2.69169618940638,
+        1.19839281085285, -1.69065929318241, 0.73248077421585};
+    const loudness_biquad_t highpass = {1.0, -2.0, 1.0,
+        -1.99004745483398, 0.99007225036621};
+
+    vector<int16_t> samples(2 * 4800 + 1);
+    for (auto& s : samples) {
+        s = rng() >> 16;
+    }
+
+    // Samples between -1 and 1, with a step to get an overshoot
+    vector<float> x(true_peak_history + 200);
+    for (auto& v : x) {
+        v = (int16_t)(rng() >> 16) / 32768.0f;
+    }
+    x[true_peak_history + 50] = 1.0f;
+    x[true_peak_history + 51] = -1.0f;
+
+    for (const auto& k : kernels) {
+        for (const int channels : {1, 2}) {
+            if (k.kweighting) {
+                check_kweighting(k.name, k.kweighting, shelving, highpass,
+                        samples, channels);
+            }
+        }
+        check_true_peak(k.name, k.true_peak, x);
+    }
+
+    check_channel_change(samples);
+
+    printf("Kernels: scalar");
+    for (const auto& k : kernels) {
+        printf(" %s", k.name);
+    }
+    printf("\n");
+
+    if (failures) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,196 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    motdecoder_test.cpp
+        Feed synthetic MOT data groups to the MotDecoder, in header mode and
+        in directory mode, with errors, and beyond its memory limit
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "../src/motdecoder.hpp"
+#include "datagroup_builder.hpp"
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (not ok) {
+        fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static void process(MotDecoder& mot, const vector<bytes_t>& dgs)
+{
+    for (const auto& dg : dgs) {
+        mot.process_data_group(dg.data(), dg.size());
+    }
+}
+
+static void check_header_mode(mt19937& rng)
+{
+    MotDecoder mot;
+    const bytes_t body = random_bytes(rng, 3000);
+
+    mot.set_time(1);
+    process(mot, mot_object(1, body, "cover/a.jpg", 200));
+
+    auto stats = mot.get_statistics();
+    check(stats.objects_completed == 1 and stats.objects.size() == 1,
+            "header mode object completed");
+    if (stats.objects.size() == 1) {
+        const auto& o = stats.objects[0];
+        check(o.name == "cover/a.jpg" and o.body_size == body.size() and
+                mot_content_type_to_string(o.content_type, o.content_subtype) ==
+                "image/jpeg", "header mode object name, size and type");
+    }
+    check(stats.segments == 16 and stats.crc_errors == 0 and
+            stats.invalid_data_groups == 0, "header mode segments");
+
+    // The same body again, with a new transport id and the segments reversed
+    auto dgs = mot_object(2, body, "cover/a.jpg", 200);
+    mot.set_time(2);
+    process(mot, vector<bytes_t>(dgs.rbegin(), dgs.rend()));
+
+    stats = mot.get_statistics();
+    check(stats.objects_completed == 2 and stats.objects.size() == 1 and
+            stats.objects[0].times_completed == 2 and
+            stats.objects[0].first_completed == 1 and
+            stats.objects[0].last_completed == 2,
+            "repeated object counted once");
+
+    // A corrupt segment is dropped, and its repetition completes the object
+    const bytes_t other = random_bytes(rng, 1000);
+    dgs = mot_object(3, other, "logo.png", 200);
+    dgs[2][12] ^= 0xFF;
+    process(mot, dgs);
+    stats = mot.get_statistics();
+    check(stats.crc_errors == 1 and stats.objects_completed == 2,
+            "object with a CRC error not completed");
+
+    dgs = mot_object(3, other, "logo.png", 200);
+    process(mot, {dgs[2]});
+    stats = mot.get_statistics();
+    check(stats.objects_completed == 3 and stats.objects.size() == 2,
+            "object completed by the repeated segment");
+
+    // The header of another object with the same transport id
+    process(mot, {msc_data_group(3, 4, 0, true, mot_header(500, 2, 1, "x"))});
+    process(mot, mot_body(4, other, 200));
+    stats = mot.get_statistics();
+    check(stats.objects_completed == 3 and stats.objects_evicted == 1,
+            "body size different from the header");
+}
+
+static void check_directory_mode(mt19937& rng)
+{
+    MotDecoder mot;
+    const bytes_t c = random_bytes(rng, 4000);
+    const bytes_t d = random_bytes(rng, 2500);
+
+    // The body of c arrives before the directory and waits for it
+    process(mot, mot_body(900, c, 2000));
+    check(mot.get_statistics().objects_completed == 0,
+            "body without header not completed");
+
+    const bytes_t directory = mot_directory({
+            {900, c.size(), "dir/c.png"},
+            {901, d.size(), "dir/d.png"}});
+
+    // The directory in two segments
+    const size_t half = directory.size() / 2;
+    process(mot, {
+            msc_data_group(6, 5, 0, false,
+                    bytes_t(directory.begin(), directory.begin() + half)),
+            msc_data_group(6, 5, 1, true,
+                    bytes_t(directory.begin() + half, directory.end()))});
+
+    auto stats = mot.get_statistics();
+    check(stats.objects_completed == 1 and stats.objects.size() == 1 and
+            stats.objects[0].name == "dir/c.png" and
+            stats.objects[0].body_size == c.size(),
+            "waiting body completed by the directory");
+
+    // A body after the directory
+    process(mot, mot_body(901, d, 1000));
+    stats = mot.get_statistics();
+    check(stats.objects_completed == 2 and stats.objects.size() == 2 and
+            stats.objects[1].name == "dir/d.png" and
+            mot_content_type_to_string(stats.objects[1].content_type,
+                stats.objects[1].content_subtype) == "image/png",
+            "body completed with the header from the directory");
+}
+
+static void check_memory_limit(mt19937& rng)
+{
+    MotDecoder mot;
+
+    // Never complete bodies, more than the memory limit in total
+    const size_t segment_size = 8000;
+    const size_t num_objects = 700;
+    double t = 0;
+    for (size_t i = 0; i < num_objects; i++) {
+        mot.set_time(t += 0.1);
+        process(mot, {msc_data_group(4, 100 + i, 0, false,
+                    random_bytes(rng, segment_size))});
+    }
+
+    auto stats = mot.get_statistics();
+    const size_t kept = mot_memory_limit / segment_size;
+    check(stats.objects_evicted == num_objects - kept,
+            "least recently updated objects evicted");
+    check(stats.max_memory <= mot_memory_limit + segment_size,
+            "memory bounded by the limit");
+
+    // The most recent incomplete object was kept
+    process(mot, {msc_data_group(3, 100 + num_objects - 1, 0, true,
+                mot_header(2 * segment_size, 2, 1, "last")),
+            msc_data_group(4, 100 + num_objects - 1, 1, true,
+                    random_bytes(rng, segment_size))});
+    stats = mot.get_statistics();
+    check(stats.objects_completed == 1, "most recent object kept");
+
+    // Incomplete objects time out
+    const size_t evicted = stats.objects_evicted;
+    mot.set_time(t + mot_object_timeout_s + 1);
+    process(mot, {msc_data_group(4, 1000, 0, false, random_bytes(rng, 100))});
+    stats = mot.get_statistics();
+    check(stats.objects_evicted == evicted + kept - 1,
+            "incomplete objects timed out");
+}
+
+int main()
+{
+    mt19937 rng(1);
+
+    check_header_mode(rng);
+    check_directory_mode(rng);
+    check_memory_limit(rng);
+
+    if (failures) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,159 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    packetsnoop_test.cpp
+        Feed a synthetic packet mode subchannel to the PacketSnoop: MOT on
+        one address and other data groups on another, interleaved, with
+        padding packets, a CRC error and a lost packet
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <vector>
+#include "../src/packetsnoop.hpp"
+#include "datagroup_builder.hpp"
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (not ok) {
+        fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static const int mot_address = 0x101;
+static const int data_address = 0x102;
+
+// Data group of type 0 with CRC, without segment field and user access
+static bytes_t general_data_group(mt19937& rng, size_t len)
+{
+    bytes_t dg = {0x40, 0x00};
+    const bytes_t data = random_bytes(rng, len);
+    dg.insert(dg.end(), data.begin(), data.end());
+    append_crc(dg);
+    return dg;
+}
+
+int main()
+{
+    mt19937 rng(1);
+
+    // Three MOT objects on one address, three data groups on the other
+    deque<bytes_t> mot_packets;
+    int mot_ci = 0;
+    const bytes_t body = random_bytes(rng, 3000);
+    for (const uint16_t transport_id : {500, 501, 502}) {
+        for (const auto& dg : mot_object(transport_id, body, "slide.png", 1000)) {
+            for (const auto& p : packets_for(dg, 96, mot_address, mot_ci)) {
+                mot_packets.push_back(p);
+            }
+        }
+    }
+
+    deque<bytes_t> data_packets;
+    int data_ci = 0;
+    for (int i = 0; i < 3; i++) {
+        for (const auto& p : packets_for(general_data_group(rng, 300), 48,
+                    data_address, data_ci)) {
+            data_packets.push_back(p);
+        }
+    }
+
+    // Interleave the addresses, and add padding packets
+    vector<bytes_t> packets;
+    size_t num_padding = 0;
+    for (int n = 0; not mot_packets.empty() or not data_packets.empty(); n++) {
+        deque<bytes_t>& q = (n % 3 == 2 and not data_packets.empty()) or
+            mot_packets.empty() ? data_packets : mot_packets;
+        packets.push_back(q.front());
+        q.pop_front();
+        if (n % 5 == 4) {
+            packets.push_back(packet(24, 0, true, true, 0, bytes_t()));
+            num_padding++;
+        }
+    }
+    const size_t num_packets = packets.size();
+
+    /* A CRC error in the body of the first MOT object, and a lost packet in
+     * that of the second. Each object takes 37 packets. */
+    size_t num_mot = 0;
+    size_t lost = 0;
+    for (size_t i = 0; i < packets.size(); i++) {
+        const int address = ((packets[i][0] & 0x03) << 8) | packets[i][1];
+        if (address != mot_address) {
+            continue;
+        }
+        num_mot++;
+        if (num_mot == 3) {
+            packets[i][10] ^= 0xFF;
+        }
+        else if (num_mot == 60) {
+            lost = i;
+        }
+    }
+    packets.erase(packets.begin() + lost);
+
+    // Logical frames of up to 384 bytes, with whole packets
+    PacketSnoop snoop;
+    bytes_t frame;
+    for (const auto& p : packets) {
+        if (frame.size() + p.size() > 384) {
+            snoop.push(frame.data(), frame.size());
+            frame.clear();
+        }
+        frame.insert(frame.end(), p.begin(), p.end());
+    }
+    snoop.push(frame.data(), frame.size());
+
+    const auto stats = snoop.get_statistics();
+    check(stats.packets == num_packets - 1 and stats.crc_errors == 1 and
+            stats.truncated_packets == 0, "packets split from the frames");
+    check(stats.padding_packets == num_padding, "padding packets");
+
+    const auto data = stats.addresses.find(data_address);
+    check(data != stats.addresses.end() and
+            data->second.data_groups == 3 and
+            data->second.data_group_crc_errors == 0 and
+            data->second.continuity_errors == 0 and
+            not data->second.mot_found, "general data groups");
+
+    const auto mot = stats.addresses.find(mot_address);
+    check(mot != stats.addresses.end() and mot->second.mot_found,
+            "MOT found on its address");
+    if (mot != stats.addresses.end()) {
+        const auto& s = mot->second;
+        check(s.continuity_errors == 2 and s.incomplete_data_groups == 2,
+                "data groups with lost packets incomplete");
+        check(s.mot.objects_completed == 1 and s.mot.objects.size() == 1 and
+                s.mot.objects[0].transport_id == 502 and
+                s.mot.objects[0].body_size == body.size(),
+                "only the object without errors completed");
+    }
+
+    if (failures) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
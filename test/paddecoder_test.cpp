@@ -0,0 +1,199 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    paddecoder_test.cpp
+        Feed synthetic X-PAD to the PadDecoder: Dynamic Label segments,
+        DL Plus tags, and MOT data groups with their length indicators
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "../src/paddecoder.hpp"
+#include "datagroup_builder.hpp"
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (not ok) {
+        fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static void process(PadDecoder& decoder, const vector<pad_t>& pads)
+{
+    for (const auto& pad : pads) {
+        const bytes_t reversed(pad.xpad.rbegin(), pad.xpad.rend());
+        decoder.process(reversed.data(), reversed.size(), pad.fpad);
+    }
+}
+
+// A PAD without X-PAD, between the data groups
+static const vector<pad_t> no_xpad = {{bytes_t(), {0x00, 0x00}}};
+
+// Dynamic Label data groups of a UTF-8 label, 16 bytes per segment
+static vector<bytes_t> dl_segments(const string& text, int toggle)
+{
+    vector<bytes_t> dgs;
+    const size_t num_segments = (text.size() + 15) / 16;
+    for (size_t i = 0; i < num_segments; i++) {
+        const string chars = text.substr(16 * i, 16);
+        bytes_t dg = {
+            (uint8_t)((toggle << 7) | (i == 0 ? 0x40 : 0) |
+                    (i == num_segments - 1 ? 0x20 : 0) | (chars.size() - 1)),
+            (uint8_t)(i == 0 ? (15 << 4) : (i << 4))};
+        dg.insert(dg.end(), chars.begin(), chars.end());
+        append_crc(dg);
+        dgs.push_back(dg);
+    }
+    return dgs;
+}
+
+// DL Plus tags command: content type, start and length of each tag
+struct tag_t {
+    int content_type;
+    int start;
+    int length;
+};
+
+static bytes_t dl_plus(int toggle, const vector<tag_t>& tags)
+{
+    // Item running, item toggle 0
+    bytes_t cmd = {(uint8_t)(0x04 | (tags.size() - 1))};
+    for (const auto& t : tags) {
+        cmd.push_back(t.content_type);
+        cmd.push_back(t.start);
+        cmd.push_back(t.length - 1);
+    }
+
+    bytes_t dg = {(uint8_t)((toggle << 7) | 0x10 | 0x02),
+        (uint8_t)((toggle << 7) | (cmd.size() - 1))};
+    dg.insert(dg.end(), cmd.begin(), cmd.end());
+    append_crc(dg);
+    return dg;
+}
+
+static bytes_t remove_label_command(int toggle)
+{
+    bytes_t dg = {(uint8_t)((toggle << 7) | 0x10 | 0x01), 0x00};
+    append_crc(dg);
+    return dg;
+}
+
+static void check_dynamic_label()
+{
+    PadDecoder decoder;
+
+    const string label_a = "Daft Punk - Around the World (Radio Edit)";
+    const string label_b = "Now: Café Müller – News at ten";
+
+    // A carousel of the label and its tags, in subfields of 8 bytes
+    for (int rep = 0; rep < 3; rep++) {
+        for (const auto& dg : dl_segments(label_a, 0)) {
+            process(decoder, xpads_for(2, dg, 8));
+        }
+        process(decoder, xpads_for(2, dl_plus(0, {{4, 0, 9}, {1, 12, 29}}), 8));
+        process(decoder, no_xpad);
+    }
+
+    auto stats = decoder.get_statistics();
+    check(stats.label.text == label_a and stats.dl_changes == 1,
+            "DL label assembled once");
+    check(stats.label.tags.size() == 2 and stats.dl_plus_changes == 1,
+            "DL Plus tags applied once");
+    if (stats.label.tags.size() == 2) {
+        check(stats.label.tags[0].content_type == 4 and
+                stats.label.tags[0].text == "Daft Punk" and
+                stats.label.tags[1].content_type == 1 and
+                stats.label.tags[1].text == "Around the World (Radio Edit)",
+                "DL Plus tag texts");
+    }
+
+    // A corrupt segment of the next label, then the label in subfields of 16
+    auto dgs = dl_segments(label_b, 1);
+    bytes_t corrupt = dgs[0];
+    corrupt[3] ^= 1;
+    process(decoder, xpads_for(2, corrupt, 8));
+
+    stats = decoder.get_statistics();
+    check(stats.dl_crc_errors == 1 and stats.label.text == label_a,
+            "DL segment with CRC error ignored");
+
+    for (const auto& dg : dgs) {
+        process(decoder, xpads_for(2, dg, 16));
+    }
+    stats = decoder.get_statistics();
+    check(stats.label.text == label_b and stats.label.tags.empty() and
+            stats.dl_changes == 2, "new DL label with non-ASCII characters");
+
+    process(decoder, xpads_for(2, remove_label_command(0), 8));
+    stats = decoder.get_statistics();
+    check(stats.label.text.empty() and stats.dl_changes == 3, "DL label removed");
+}
+
+static void check_mot(mt19937& rng)
+{
+    PadDecoder decoder;
+
+    const bytes_t body = random_bytes(rng, 3000);
+    for (const auto& dg : mot_object(1, body, "slide.jpg", 200)) {
+        process(decoder, xpads_for_mot(dg));
+    }
+    process(decoder, no_xpad);
+
+    auto stats = decoder.get_statistics();
+    check(stats.mot.objects_completed == 1 and stats.mot.objects.size() == 1 and
+            stats.mot.crc_errors == 0 and stats.dgli_crc_errors == 0,
+            "MOT object in X-PAD");
+    if (stats.mot.objects.size() == 1) {
+        check(stats.mot.objects[0].name == "slide.jpg" and
+                stats.mot.objects[0].body_size == body.size(),
+                "MOT object in X-PAD name and size");
+    }
+
+    // Without a valid length indicator, the data group is skipped
+    const auto dgs = mot_object(2, random_bytes(rng, 500), "other.jpg", 200);
+    for (size_t i = 0; i < dgs.size(); i++) {
+        process(decoder, xpads_for_mot(dgs[i], i == 0));
+    }
+
+    stats = decoder.get_statistics();
+    check(stats.dgli_crc_errors == 1 and stats.mot.objects_completed == 1 and
+            stats.mot.data_groups == 16 + dgs.size() - 1,
+            "data group after a corrupt length indicator skipped");
+}
+
+int main()
+{
+    mt19937 rng(1);
+
+    check_dynamic_label();
+    check_mot(rng);
+
+    if (failures) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,198 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    rsdecoder_test.cpp
+        Compare the SIMD syndrome kernels of the RS decoder with the scalar
+        one, and the decoded superframes with decoding every codeword
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// The syndrome kernels are private to rsdecoder.cpp
+#include "../src/rsdecoder.cpp"
+
+using namespace std;
+
+static const int superframes_per_index = 40;
+static const int max_subch_index = 64;
+static const int max_errors = 6; // One more than the code can correct
+
+struct kernel_under_test_t {
+    const char *name;
+    syndrome_kernel_t kernel;
+    int width;
+};
+
+static vector<kernel_under_test_t> supported_kernels()
+{
+    vector<kernel_under_test_t> kernels;
+    kernels.push_back({"scalar", erroneous_packets_scalar, 1});
+#if RSDEC_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3")) {
+        kernels.push_back({"ssse3", erroneous_packets_ssse3, 16});
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.push_back({"avx2", erroneous_packets_avx2, 32});
+    }
+#endif
+    return kernels;
+}
+
+/* A superframe of random RS(120,110) packets, interleaved like in DAB+,
+ * with 0 to max_errors corrupted bytes in each packet. Returns the number
+ * of corrupted bytes of each packet. */
+static vector<int> make_superframe(void *rs, mt19937& rng, int subch_index,
+        vector<uint8_t>& sf)
+{
+    sf.resize(120 * subch_index);
+    vector<int> errors(subch_index);
+
+    for (int i = 0; i < subch_index; i++) {
+        uint8_t packet[120];
+        for (int pos = 0; pos < 110; pos++) {
+            packet[pos] = rng();
+        }
+        encode_rs_char(rs, packet, packet + 110);
+
+        // Most packets are received without errors
+        errors[i] = (rng() % 2) ? 0 : rng() % (max_errors + 1);
+
+        bool corrupted[120] = {false};
+        for (int e = 0; e < errors[i]; e++) {
+            int pos;
+            do {
+                pos = rng() % 120;
+            } while (corrupted[pos]);
+            corrupted[pos] = true;
+            packet[pos] ^= 1 + rng() % 255;
+        }
+
+        for (int pos = 0; pos < 120; pos++) {
+            sf[pos * subch_index + i] = packet[pos];
+        }
+    }
+
+    return errors;
+}
+
+// DecodeSuperframe before the syndrome check: every packet is decoded
+static int decode_every_codeword(void *rs, uint8_t *sf, int subch_index)
+{
+    int total_corr_count = 0;
+    bool uncorr_errors = false;
+
+    for (int i = 0; i < subch_index; i++) {
+        uint8_t rs_packet[120];
+        int corr_pos[10];
+
+        for (int pos = 0; pos < 120; pos++)
+            rs_packet[pos] = sf[pos * subch_index + i];
+
+        const int corr_count = decode_rs_char(rs, rs_packet, corr_pos, 0);
+
+        if (corr_count == -1) {
+            uncorr_errors = true;
+        }
+        else {
+            total_corr_count += corr_count;
+        }
+
+        for (int j = 0; j < corr_count; j++) {
+            const int pos = corr_pos[j] - 135;
+            if (pos < 0)
+                continue;
+            sf[pos * subch_index + i] = rs_packet[pos];
+        }
+    }
+
+    return uncorr_errors ? -1 : total_corr_count;
+}
+
+int main()
+{
+    const auto kernels = supported_kernels();
+    void *rs = init_rs_char(8, 0x11D, 0, 1, 10, 135);
+    RSDecoder decoder;
+    mt19937 rng(1);
+
+    int failures = 0;
+    size_t packets = 0;
+
+    for (int subch_index = 1; subch_index <= max_subch_index; subch_index++) {
+        for (int n = 0; n < superframes_per_index; n++) {
+            vector<uint8_t> sf;
+            const auto errors = make_superframe(rs, rng, subch_index, sf);
+            packets += subch_index;
+
+            // The scalar kernel must flag exactly the corrupted packets
+            vector<bool> expected(subch_index);
+            for (int i = 0; i < subch_index; i++) {
+                expected[i] = erroneous_packets_scalar(sf.data(), subch_index, i);
+                if (expected[i] != (errors[i] > 0)) {
+                    fprintf(stderr, "FAIL: scalar kernel, index %d packet %d "
+                            "with %d errors\n", subch_index, i, errors[i]);
+                    failures++;
+                }
+            }
+
+            // Lanes beyond the last packet are not compared
+            for (const auto& k : kernels) {
+                for (int i0 = 0; i0 < subch_index; i0 += k.width) {
+                    const uint32_t mask = k.kernel(sf.data(), subch_index, i0);
+                    for (int lane = 0; lane < k.width and i0 + lane < subch_index; lane++) {
+                        if (((mask >> lane) & 1) != expected[i0 + lane]) {
+                            fprintf(stderr, "FAIL: %s kernel, index %d packet %d\n",
+                                    k.name, subch_index, i0 + lane);
+                            failures++;
+                        }
+                    }
+                }
+            }
+
+            vector<uint8_t> reference = sf;
+            const int expected_corr = decode_every_codeword(
+                    rs, reference.data(), subch_index);
+            const int corr = decoder.DecodeSuperframe(sf, subch_index);
+
+            if (corr != expected_corr or sf != reference) {
+                fprintf(stderr, "FAIL: DecodeSuperframe, index %d: %d corrected, "
+                        "expected %d%s\n", subch_index, corr, expected_corr,
+                        sf != reference ? ", data differs" : "");
+                failures++;
+            }
+        }
+    }
+
+    free_rs_char(rs);
+
+    printf("Kernels:");
+    for (const auto& k : kernels) {
+        printf(" %s", k.name);
+    }
+    printf(", %zu packets\n", packets);
+
+    if (failures) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,113 @@
+/*
+    Copyright (C) 2026 Matthias P. Braendli (http://www.opendigitalradio.org)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    utilisation_test.cpp
+        Compare the SSE2 zero fill kernel with the scalar one, for runs of
+        zero bytes at every position and of every length
+
+    Authors:
+         Matthias P. Braendli <matthias@mpb.li>
+*/
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// The zero fill kernels are private to utilisation.cpp
+#include "../src/utilisation.cpp"
+
+static const size_t max_len = 72;
+
+static int failures = 0;
+
+static void compare_kernels(const uint8_t *data, size_t len, size_t run,
+        const char *what)
+{
+    size_t expected_fill = 0;
+    const size_t expected_run = zero_fill_scalar(data, len, run, expected_fill);
+
+#if UTILISATION_X86_SIMD
+    size_t fill = 0;
+    const size_t sse2_run = zero_fill_sse2(data, len, run, fill);
+
+    if (sse2_run != expected_run or fill != expected_fill) {
+        fprintf(stderr, "FAIL: sse2 kernel, %s, %zu bytes after a run of %zu: "
+                "fill %zu run %zu, expected fill %zu run %zu\n", what, len, run,
+                fill, sse2_run, expected_fill, expected_run);
+        failures++;
+    }
+#endif
+}
+
+int main()
+{
+#if UTILISATION_X86_SIMD
+    __builtin_cpu_init();
+    if (not __builtin_cpu_supports("sse2")) {
+        printf("SSE2 not supported\n");
+        return 0;
+    }
+#endif
+
+    /* One run of zero bytes in non-zero data, at every position and of
+     * every length, crossing the 16-byte blocks and reaching into the
+     * tail. The run before the data may continue into it. */
+    vector<uint8_t> data(max_len);
+    for (size_t len = 0; len <= max_len; len++) {
+        for (size_t start = 0; start <= len; start++) {
+            for (size_t run_len = 0; start + run_len <= len; run_len++) {
+                fill(data.begin(), data.end(), 0xA5);
+                fill(data.begin() + start, data.begin() + start + run_len, 0);
+
+                for (const size_t run : {0, 1, 7, 8, 100}) {
+                    compare_kernels(data.data(), len, run, "one run");
+                }
+            }
+        }
+    }
+
+    // Random data with many short and long runs, at every alignment
+    mt19937 rng(1);
+    vector<uint8_t> random_data(4096);
+    for (size_t i = 0; i < random_data.size();) {
+        const size_t run_len = rng() % 40;
+        const bool zeros = rng() % 2;
+        for (size_t j = 0; j < run_len and i < random_data.size(); j++, i++) {
+            random_data[i] = zeros ? 0 : 1 + rng() % 255;
+        }
+    }
+    for (size_t offset = 0; offset < 16; offset++) {
+        compare_kernels(random_data.data() + offset,
+                random_data.size() - offset, 0, "random runs");
+    }
+
+    // A run of zero bytes counts as fill if it reaches the minimum length
+    const vector<uint8_t> short_run = {1, 0, 0, 0, 0, 0, 0, 0, 1};
+    const vector<uint8_t> min_run = {1, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+    const vector<uint8_t> all_zero(100, 0);
+    if (count_zero_fill(short_run.data(), short_run.size()) != 0 or
+            count_zero_fill(min_run.data(), min_run.size()) != zero_fill_min_run or
+            count_zero_fill(all_zero.data(), all_zero.size()) != all_zero.size()) {
+        fprintf(stderr, "FAIL: count_zero_fill\n");
+        failures++;
+    }
+
+    if (failures) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}